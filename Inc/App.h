@@ -13,57 +13,169 @@
 #include <stdint.h>
 #include "can_types.h"
 #include "BatteryModel.h"
-
-// Forward declaration
-template<uint16_t CAPACITY> class CanQueue;
+#include "CanTxQueue.h"
+#include "Diagnostics.h"
+#include "CanMessage373.h"
+#include "CanMessage374.h"
+#include "TimerWheel.h"
+#include "CpuProfile.h"
 
 const float BATTERY_PACK_AH_CAPACITY = 93.0f; // Battery capacity in amp-hours
 
+// Standard IDs the App reads or rewrites. The CAN filters receive these
+// into FIFO1, ahead of passthrough traffic (see CanFilterTable.h).
+const uint16_t APP_HANDLED_IDS[] = {
+    CanMessage373::MESSAGE_ID,
+    CanMessage374::MESSAGE_ID,
+    Diagnostics::REQUEST_ID,
+};
+const uint8_t APP_HANDLED_ID_COUNT = sizeof(APP_HANDLED_IDS) / sizeof(APP_HANDLED_IDS[0]);
+
+/**
+ * @brief Check whether the App reads or rewrites frames with an ID
+ * @param id Frame ID
+ * @return true if id is in APP_HANDLED_IDS, false for passthrough frames
+ *
+ * Matches on the ID alone, as App::canMsgReceived() does.
+ */
+inline bool AppHandlesId(uint32_t id) {
+    for (uint8_t i = 0; i < APP_HANDLED_ID_COUNT; i++) {
+        if (APP_HANDLED_IDS[i] == id) {
+            return true;
+        }
+    }
+    return false;
+}
+
 /**
  * @class App
  * @brief Application logic
  * 
  * Implement this interface to create custom CAN message processing
  * applications. The main loop will:
- * - Call canMsgReceived() for each incoming CAN frame
+ * - Call canMsgReceived() (or canMsgsReceived() for a batch) for each
+ *   incoming CAN frame
  * - Call timeTickMs() periodically for time-based processing
  */
 class App {
 public:
-    App(CanQueue<QUEUE_CAPACITY>* txQueue, BatteryModel*batteryModel) :
+    App(CanTxQueue* txQueue, BatteryModel*batteryModel, Diagnostics* diagnostics = nullptr) :
      m_txQueue(txQueue),
      m_ticks(0), 
-     m_one_second(1000),
      m_seconds(0),
-     m_batteryModel(batteryModel) {} 
+     m_batteryModel(batteryModel),
+     m_diagnostics(diagnostics),
+     m_cpuProfile(nullptr) {
+        m_timers.add(1000, 1000, secondTask, this);
+        if (m_diagnostics != nullptr) {
+            m_diagnostics->setSchedulerStats(&m_timers.cost());
+#ifdef CAN_FRAME_TIMESTAMPS
+            m_diagnostics->setLatencyHistogram(Diagnostics::HISTOGRAM_DISPATCH_TO_ENQUEUE, &m_enqueueLatency);
+#endif
+        }
+#ifdef CAN_HW_TIMESTAMPS
+        m_373RxTime = 0;
+        m_373RxChannel = 0;
+        m_373RxTimeValid = false;
+        m_373CarryBits = 0;
+        if (m_diagnostics != nullptr) {
+            m_diagnostics->setRxIntervalStats(&m_373Interval);
+        }
+#endif
+    }
+
+    static const uint16_t TIMER_SLOTS = 256;   ///< Timer wheel size (ms), periods up to this cost nothing until due
+    static const uint8_t MAX_TIMER_TASKS = 8;   ///< Periodic tasks and timeouts the App can have at once
+
+#ifdef CAN_HW_TIMESTAMPS
+    /// Longest 0x373 interval integrated by the battery model; a longer gap counts as one nominal period
+    static const uint32_t MAX_373_INTERVAL_MS = 10 * CanMessage373::RECURRANCE_MS;
+#endif
+
     /**
      * @brief Called when a CAN message is received
      * @param frame The received CAN frame
      * 
      * This method is called from the main loop whenever a frame
      * is available in the RxQueue. Process the message and optionally
-     * queue responses to the TxQueue.
+     * queue responses to the TxQueue. A 0x374 frame is rewritten in place
+     * before it is forwarded.
      */
-    void canMsgReceived(const CAN_FRAME& frame);
+    void canMsgReceived(CAN_FRAME& frame);
+
+    /**
+     * @brief Called with a batch of received CAN messages
+     * @param frames The received CAN frames, in arrival order
+     * @param count Number of frames in the batch
+     *
+     * Equivalent to calling canMsgReceived() for each frame in turn, so
+     * the main loop can hand a whole RxQueue backlog over in one call.
+     */
+    void canMsgsReceived(CAN_FRAME* frames, uint16_t count);
     
     /**
      * @brief Called periodically for time-based processing
      * @param ms Time elapsed since last call in milliseconds
      * 
      * This method is called from the main loop, potentially every ms.
-     * Use it for periodic tasks, timeouts, and state management.
+     * It advances m_timers, which runs the periodic tasks and timeouts
+     * that fall due.
      */
     void timeTickMs(uint32_t ms);
+
+    /**
+     * @brief Report the CPU load in the heartbeat
+     * @param profile Profile kept by the main loop, or nullptr for none
+     */
+    void setCpuProfile(const CpuProfile* profile) {
+        m_cpuProfile = profile;
+    }
 protected:
-    CanQueue<QUEUE_CAPACITY>* m_txQueue; ///< Pointer to the TxQueue for sending messages
+    CanTxQueue* m_txQueue;   ///< Pointer to the TxQueue for sending messages
     uint32_t m_ticks;         ///< Internal tick counter
-    int32_t m_one_second;    ///< Counter for one second intervals
     uint32_t m_seconds;      ///< Elapsed seconds counter
     BatteryModel* m_batteryModel; ///< Pointer to the BatteryModel instance
+    Diagnostics* m_diagnostics;   ///< Diagnostic pages sent with the heartbeat, may be nullptr
+    TimerWheel<TIMER_SLOTS, MAX_TIMER_TASKS> m_timers; ///< Periodic tasks and timeouts, advanced by timeTickMs()
+    const CpuProfile* m_cpuProfile; ///< CPU load reported in the heartbeat, may be nullptr
+#ifdef CAN_FRAME_TIMESTAMPS
+    LatencyHistogram m_enqueueLatency; ///< Frames handed to the App until queued for transmission
+#endif
+#ifdef CAN_HW_TIMESTAMPS
+    uint32_t m_373RxTime;         ///< Hardware receive time of the last 0x373 (bit times)
+    uint8_t m_373RxChannel;       ///< Channel the last 0x373 was received on, whose clock m_373RxTime is
+    bool m_373RxTimeValid;        ///< m_373RxTime holds a received frame's time
+    uint32_t m_373CarryBits;      ///< Interval remainder below 1 ms, carried to the next update
+    LatencyStats m_373Interval;   ///< Intervals between 0x373 frames (bit times)
+
+    /**
+     * @brief Measure the time since the previous 0x373 from hardware timestamps
+     * @param frame The received 0x373 frame
+     * @return Whole milliseconds to integrate, CanMessage373::RECURRANCE_MS if unknown
+     */
+    uint32_t measure373IntervalMs(const CAN_FRAME& frame);
+#endif
+    /**
+     * @brief Answer a diagnostic request (ID Diagnostics::REQUEST_ID)
+     * @param frame The request, answered on the bus it was received on
+     */
+    void diagnosticRequestReceived(const CAN_FRAME& frame);
+
+    /**
+     * @brief Once a second task: count uptime, send the heartbeat and diagnostics
+     * @param app The App, as registered with m_timers
+     */
+    static void secondTask(void* app);
+
     /**
      * @brief Send a heartbeat CAN message
      */
     void sendHeartbeat();
+
+    /**
+     * @brief Send all 0x721 diagnostic pages
+     */
+    void sendDiagnostics();
 };
 
 
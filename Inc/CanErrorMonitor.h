@@ -0,0 +1,284 @@
+/**
+ * @file CanErrorMonitor.h
+ * @brief Error counters, error states and bus-off recovery of one bxCAN controller
+ *
+ * Fed with raw CAN_ESR values, and kept free of device headers, so it can
+ * be unit tested on the host.
+ */
+
+#ifndef CAN_ERROR_MONITOR_H
+#define CAN_ERROR_MONITOR_H
+
+#include <stdint.h>
+#include "can_types.h"
+
+// CAN_ESR bits, as CAN_ESR_EWGF, CAN_ESR_EPVF and CAN_ESR_BOFF
+const uint32_t CAN_ERROR_ESR_EWGF = 0x00000001UL;
+const uint32_t CAN_ERROR_ESR_EPVF = 0x00000002UL;
+const uint32_t CAN_ERROR_ESR_BOFF = 0x00000004UL;
+const uint8_t CAN_ERROR_ESR_TEC_SHIFT = 16;
+const uint8_t CAN_ERROR_ESR_REC_SHIFT = 24;
+
+// A bus-off recovery waits for 128 occurrences of 11 recessive bits; this is
+// the shortest time HAL_GetTick() can show between a bus-off and its end
+const uint32_t CAN_BUS_OFF_RECOVERY_MIN_MS = (128 * 11) / CAN_BITS_PER_MS;
+
+/**
+ * @class CanErrorMonitor
+ * @brief Counts a controller's bus errors and tracks its error state
+ *
+ * The controller's error interrupt reports every error through onError(),
+ * which counts it by its last error code, and a bus-off through
+ * onBusOff(), after it has aborted the TX mailboxes and started the
+ * recovery. bxCAN only interrupts when an error flag is set, not when it
+ * clears, so the error state, TEC and REC are polled by sample() every
+ * millisecond; the time in each state is counted there too. A warning or
+ * passive spell shorter than that can be missed, a bus-off cannot.
+ *
+ * From a bus-off until sample() sees the controller back on the bus,
+ * onBus() is false and frames queued for it are dropped with onDropped()
+ * rather than sent late, in a burst, after the recovery. A sample without
+ * BOFF only ends the bus-off once a sample has shown BOFF for it, or once
+ * CAN_BUS_OFF_RECOVERY_MIN_MS have passed, so a stale ESR cannot.
+ *
+ * Each counter has one writer: the error interrupt (error codes, bus-offs,
+ * aborted frames), the main loop (state, time and recovery) or the context
+ * that feeds the TX mailboxes (dropped frames). The getters can be read
+ * from any context.
+ */
+class CanErrorMonitor {
+public:
+    /**
+     * @brief Error state, from the ESR flags
+     */
+    enum State {
+        STATE_ACTIVE = 0,   ///< TEC and REC below 96
+        STATE_WARNING = 1,  ///< TEC or REC 96 or more (EWGF)
+        STATE_PASSIVE = 2,  ///< TEC or REC over 127 (EPVF)
+        STATE_BUS_OFF = 3,  ///< TEC over 255 (BOFF), off the bus until recovered
+        STATE_COUNT = 4
+    };
+
+    /**
+     * @brief Last error code, ESR LEC
+     */
+    enum ErrorCode {
+        ERROR_NONE = 0,
+        ERROR_STUFF = 1,
+        ERROR_FORM = 2,
+        ERROR_ACK = 3,
+        ERROR_BIT_RECESSIVE = 4,    ///< Sent recessive, read dominant
+        ERROR_BIT_DOMINANT = 5,     ///< Sent dominant, read recessive
+        ERROR_CRC = 6,
+        ERROR_SET_BY_SOFTWARE = 7,
+        ERROR_CODE_COUNT = 8
+    };
+
+    CanErrorMonitor() :
+        busOffs_(0),
+        busOffMs_(0),
+        aborted_(0),
+        dropped_(0),
+        recovered_(0),
+        seenOff_(0),
+        state_(STATE_ACTIVE),
+        tec_(0),
+        rec_(0),
+        lastRecoveryMs_(0),
+        maxRecoveryMs_(0) {
+        for (uint8_t i = 0; i < ERROR_CODE_COUNT; i++) {
+            errors_[i] = 0;
+        }
+        for (uint8_t i = 0; i < STATE_COUNT; i++) {
+            entries_[i] = 0;
+            timeMs_[i] = 0;
+        }
+    }
+
+    /**
+     * @brief Get the error state an ESR value shows
+     * @param esr Error status register (CAN_ESR)
+     */
+    static State stateOf(uint32_t esr) {
+        if ((esr & CAN_ERROR_ESR_BOFF) != 0) {
+            return STATE_BUS_OFF;
+        }
+        if ((esr & CAN_ERROR_ESR_EPVF) != 0) {
+            return STATE_PASSIVE;
+        }
+        if ((esr & CAN_ERROR_ESR_EWGF) != 0) {
+            return STATE_WARNING;
+        }
+        return STATE_ACTIVE;
+    }
+
+    /**
+     * @brief Count one bus error (error ISR)
+     * @param code Its last error code; ERROR_NONE and ERROR_SET_BY_SOFTWARE are not counted
+     */
+    void onError(ErrorCode code) {
+        if (code != ERROR_NONE && code != ERROR_SET_BY_SOFTWARE) {
+            errors_[code]++;
+        }
+    }
+
+    /**
+     * @brief Record a bus-off (error ISR)
+     * @param nowMs Current HAL tick
+     * @param abortedFrames Frames that were waiting in TX mailboxes and were aborted
+     */
+    void onBusOff(uint32_t nowMs, uint8_t abortedFrames) {
+        aborted_ += abortedFrames;
+        busOffMs_ = nowMs;
+        // Last, so sample() never pairs a new bus-off with an old time
+        busOffs_++;
+    }
+
+    /**
+     * @brief Poll the error state and counters (main loop, every millisecond)
+     * @param esr Error status register (&CAN->ESR), read here
+     * @param elapsedMs Time since the previous call, counted in the state the previous call saw
+     * @param nowMs Current HAL tick
+     */
+    void sample(const volatile uint32_t *esr, uint32_t elapsedMs, uint32_t nowMs) {
+        // Before the ESR: a bus-off landing between the two reads is left to
+        // the next sample, rather than ended by the ESR from before it
+        uint32_t busOffs = busOffs_;
+        uint32_t value = *esr;
+
+        timeMs_[state_] += elapsedMs;
+        State state = stateOf(value);
+        if (state != state_ && state != STATE_BUS_OFF) {
+            entries_[state]++;
+        }
+        state_ = state;
+        tec_ = (value >> CAN_ERROR_ESR_TEC_SHIFT) & 0xFF;
+        rec_ = (value >> CAN_ERROR_ESR_REC_SHIFT) & 0xFF;
+
+        if (busOffs == recovered_) {
+            return;
+        }
+        if (state == STATE_BUS_OFF) {
+            seenOff_ = busOffs;
+        } else if (seenOff_ == busOffs || nowMs - busOffMs_ >= CAN_BUS_OFF_RECOVERY_MIN_MS) {
+            lastRecoveryMs_ = nowMs - busOffMs_;
+            if (lastRecoveryMs_ > maxRecoveryMs_) {
+                maxRecoveryMs_ = lastRecoveryMs_;
+            }
+            recovered_ = busOffs;
+        }
+    }
+
+    /**
+     * @brief Count frames dropped because the controller was off the bus (TX context)
+     * @param frames Frames taken from the TX queue or stage without being sent
+     */
+    void onDropped(uint16_t frames) {
+        dropped_ += frames;
+    }
+
+    /**
+     * @brief Check whether frames may be loaded into the controller
+     * @return false from a bus-off until the controller is seen back on the bus
+     */
+    bool onBus() const {
+        return busOffs_ == recovered_;
+    }
+
+    /**
+     * @brief Get the error state at the last sample
+     */
+    State state() const {
+        return state_;
+    }
+
+    /**
+     * @brief Get the transmit error counter at the last sample
+     */
+    uint8_t tec() const {
+        return tec_;
+    }
+
+    /**
+     * @brief Get the receive error counter at the last sample
+     */
+    uint8_t rec() const {
+        return rec_;
+    }
+
+    /**
+     * @brief Get the number of errors seen with a last error code
+     * @param code ERROR_STUFF to ERROR_CRC
+     * @return Errors, wraps at 2^32
+     */
+    uint32_t errors(ErrorCode code) const {
+        return errors_[code];
+    }
+
+    /**
+     * @brief Get the number of bus-offs
+     * @return Bus-offs, wraps at 2^32
+     */
+    uint32_t busOffs() const {
+        return busOffs_;
+    }
+
+    /**
+     * @brief Get the number of times the warning or passive state was entered
+     * @param state STATE_ACTIVE to STATE_PASSIVE; see busOffs() for STATE_BUS_OFF
+     */
+    uint32_t entries(State state) const {
+        return entries_[state];
+    }
+
+    /**
+     * @brief Get the time spent in an error state
+     * @param state Error state
+     * @return Time in ms, wraps at 2^32
+     */
+    uint32_t timeInStateMs(State state) const {
+        return timeMs_[state];
+    }
+
+    /**
+     * @brief Get the number of frames lost to bus-offs
+     * @return Frames aborted in the TX mailboxes plus frames dropped from the queue, wraps at 2^32
+     */
+    uint32_t framesDropped() const {
+        return aborted_ + dropped_;
+    }
+
+    /**
+     * @brief Get the time from the last bus-off to being back on the bus
+     * @return Time in ms, 0 before the first recovery
+     */
+    uint32_t lastRecoveryMs() const {
+        return lastRecoveryMs_;
+    }
+
+    /**
+     * @brief Get the longest time from a bus-off to being back on the bus
+     * @return Time in ms, 0 before the first recovery
+     */
+    uint32_t maxRecoveryMs() const {
+        return maxRecoveryMs_;
+    }
+
+private:
+    volatile uint32_t errors_[ERROR_CODE_COUNT];    ///< Errors by last error code (ISR)
+    volatile uint32_t busOffs_;         ///< Bus-offs (ISR)
+    volatile uint32_t busOffMs_;        ///< HAL tick of the last bus-off (ISR)
+    volatile uint32_t aborted_;         ///< Frames aborted in the TX mailboxes (ISR)
+    volatile uint32_t dropped_;         ///< Frames dropped from the queue (TX context)
+    volatile uint32_t recovered_;       ///< busOffs_ the controller has recovered from (main loop)
+    uint32_t seenOff_;                  ///< busOffs_ a sample has seen BOFF for
+    volatile State state_;              ///< State at the last sample
+    volatile uint8_t tec_;              ///< TEC at the last sample
+    volatile uint8_t rec_;              ///< REC at the last sample
+    uint32_t entries_[STATE_COUNT];     ///< Entries into each state seen by sample()
+    uint32_t timeMs_[STATE_COUNT];      ///< Time in each state
+    uint32_t lastRecoveryMs_;           ///< Last bus-off to recovery
+    uint32_t maxRecoveryMs_;            ///< Longest bus-off to recovery
+};
+
+#endif // CAN_ERROR_MONITOR_H
@@ -0,0 +1,102 @@
+/**
+ * @file CanFilterTable.h
+ * @brief bxCAN filter banks that route the App's IDs to FIFO1, the rest to FIFO0
+ *
+ * The frames the App reads or rewrites go to their own hardware FIFO, so
+ * they never wait behind bulk passthrough traffic in the 3-deep FIFO0. The
+ * table is built from a compile-time list of standard IDs:
+ *
+ * - Banks 0 .. N-1 are 32-bit identifier list filters, two IDs each,
+ *   assigned to FIFO1. They match standard data frames only.
+ * - Bank N is a 32-bit mask filter that accepts everything, assigned to
+ *   FIFO0.
+ *
+ * bxCAN gives a list filter precedence over a mask filter of the same
+ * scale, so a frame matching both is stored in FIFO1. Bank numbers are
+ * relative to the first bank of the controller.
+ */
+
+#ifndef CAN_FILTER_TABLE_H
+#define CAN_FILTER_TABLE_H
+
+#include <stdint.h>
+
+const uint8_t CAN_FILTER_BANKS_PER_CHANNEL = 14;  // CAN2 banks start at 14 of the 28 shared banks
+
+/**
+ * @brief One filter bank, as written to the FR1/FR2 registers
+ */
+struct CanFilterBank {
+    uint32_t fr1;       ///< First ID (list mode) or ID (mask mode)
+    uint32_t fr2;       ///< Second ID (list mode) or mask (mask mode)
+    bool listMode;      ///< true for identifier list mode, false for mask mode
+    uint8_t fifo;       ///< FIFO the matching frames are stored in, 0 or 1
+};
+
+/**
+ * @class CanFilterTable
+ * @brief Filter banks for a fixed list of standard IDs
+ *
+ * @tparam ID_COUNT Number of IDs routed to FIFO1
+ */
+template<uint8_t ID_COUNT>
+class CanFilterTable {
+public:
+    static const uint8_t BANK_COUNT = (ID_COUNT + 1) / 2 + 1;  ///< List banks plus the accept-all bank
+
+    static_assert(ID_COUNT > 0, "CanFilterTable needs at least one ID");
+    static_assert(BANK_COUNT <= CAN_FILTER_BANKS_PER_CHANNEL, "Too many IDs for one controller's filter banks");
+
+    /**
+     * @brief Build the banks for a list of IDs
+     * @param ids Standard (11-bit) IDs to route to FIFO1
+     *
+     * An odd ID count fills the second slot of the last list bank with a
+     * repeat of the last ID.
+     */
+    explicit CanFilterTable(const uint16_t (&ids)[ID_COUNT]) {
+        for (uint8_t i = 0; i < BANK_COUNT - 1; i++) {
+            uint8_t second = (2 * i + 1 < ID_COUNT) ? 2 * i + 1 : 2 * i;
+            banks_[i].fr1 = stdIdRegister(ids[2 * i]);
+            banks_[i].fr2 = stdIdRegister(ids[second]);
+            banks_[i].listMode = true;
+            banks_[i].fifo = 1;
+        }
+
+        // Accept-all mask: no ID bit has to match
+        banks_[BANK_COUNT - 1].fr1 = 0;
+        banks_[BANK_COUNT - 1].fr2 = 0;
+        banks_[BANK_COUNT - 1].listMode = false;
+        banks_[BANK_COUNT - 1].fifo = 0;
+    }
+
+    /**
+     * @brief Get the number of banks used
+     * @return Number of banks, all of them below CAN_FILTER_BANKS_PER_CHANNEL
+     */
+    uint8_t bankCount() const {
+        return BANK_COUNT;
+    }
+
+    /**
+     * @brief Access one bank
+     * @param index Bank index relative to the controller's first bank, less than bankCount()
+     */
+    const CanFilterBank& bank(uint8_t index) const {
+        return banks_[index];
+    }
+
+    /**
+     * @brief 32-bit filter register value of a standard data frame ID
+     * @param id Standard (11-bit) ID
+     * @return STID in bits 31:21, EXID, IDE and RTR all zero
+     */
+    static uint32_t stdIdRegister(uint16_t id) {
+        return (uint32_t)(id & 0x7FF) << 21;
+    }
+
+private:
+    CanFilterBank banks_[BANK_COUNT];  ///< FIFO1 list banks, then the FIFO0 accept-all bank
+};
+
+#endif // CAN_FILTER_TABLE_H
@@ -0,0 +1,192 @@
+/**
+ * @file CanLaneQueue.h
+ * @brief Set of independent CAN frame queues, one per CAN channel
+ *
+ * Frames are routed to a lane by their tx_channel, so each CAN controller
+ * can be serviced from its own queue and congestion on one bus never
+ * holds up frames waiting for the other.
+ */
+
+#ifndef CAN_LANE_QUEUE_H
+#define CAN_LANE_QUEUE_H
+
+#include <stdint.h>
+#include "can_types.h"
+
+/**
+ * @class CanLaneQueue
+ * @brief Multi-lane queue for CAN frames, one lane per tx_channel
+ *
+ * Offers the usual queue interface (push, pop, peek, length...) over all
+ * lanes, for producers such as the App that do not care which lane a frame
+ * lands in, plus per-lane access for the transmit scheduler.
+ *
+ * The whole-queue pop() and peek() take frames from the lowest numbered
+ * non-empty lane first. Frame order is only preserved within a lane.
+ *
+ * Thread-safe operations require external synchronization.
+ *
+ * @tparam LANE_QUEUE Queue type used for each lane, e.g. CanQueue<64>
+ * @tparam LANES Number of lanes (CAN channels)
+ */
+template<class LANE_QUEUE, uint8_t LANES>
+class CanLaneQueue {
+public:
+    typedef LANE_QUEUE Lane; ///< Queue type of a single lane
+
+    /**
+     * @brief Push a CAN frame onto the lane selected by its tx_channel
+     * @param frame The CAN frame to add
+     * @return true if successful, false if the lane is full or tx_channel is invalid
+     */
+    bool push(const CAN_FRAME& frame) {
+        if (frame.tx_channel >= LANES) {
+            return false;
+        }
+
+        return lanes_[frame.tx_channel].push(frame);
+    }
+
+    /**
+     * @brief Reserve the next free slot of a lane so a frame can be built in place
+     * @param channel Lane (tx_channel) to reserve a slot in
+     * @return Pointer to the slot, or nullptr if the lane is full or channel is invalid
+     *
+     * The caller should set tx_channel of the frame to channel before commit().
+     */
+    CAN_FRAME* reserve(uint8_t channel) {
+        if (channel >= LANES) {
+            return nullptr;
+        }
+
+        return lanes_[channel].reserve();
+    }
+
+    /**
+     * @brief Add the slot returned by the last reserve(channel) to that lane
+     * @param channel Lane passed to reserve()
+     */
+    void commit(uint8_t channel) {
+        lanes_[channel].commit();
+    }
+
+    /**
+     * @brief Pop a CAN frame from the lowest numbered non-empty lane
+     * @param frame Pointer to store the popped frame
+     * @return true if successful, false if all lanes are empty
+     */
+    bool pop(CAN_FRAME* frame) {
+        for (uint8_t i = 0; i < LANES; i++) {
+            if (lanes_[i].pop(frame)) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief Peek at the frame pop() would return, without removing it
+     * @param frame Pointer to store the peeked frame
+     * @return true if successful, false if all lanes are empty
+     */
+    bool peek(CAN_FRAME* frame) const {
+        for (uint8_t i = 0; i < LANES; i++) {
+            if (lanes_[i].peek(frame)) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief Access a single lane
+     * @param channel Lane (tx_channel) index, must be less than LANES
+     * @return The queue holding frames for that channel
+     */
+    Lane& lane(uint8_t channel) {
+        return lanes_[channel];
+    }
+
+    /**
+     * @brief Access a single lane
+     * @param channel Lane (tx_channel) index, must be less than LANES
+     * @return The queue holding frames for that channel
+     */
+    const Lane& lane(uint8_t channel) const {
+        return lanes_[channel];
+    }
+
+    /**
+     * @brief Get number of lanes
+     * @return Number of lanes (CAN channels)
+     */
+    uint8_t laneCount() const {
+        return LANES;
+    }
+
+    /**
+     * @brief Check if all lanes are empty
+     * @return true if no lane contains any elements
+     */
+    bool isEmpty() const {
+        for (uint8_t i = 0; i < LANES; i++) {
+            if (!lanes_[i].isEmpty()) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Get number of elements in all lanes
+     * @return Number of CAN frames currently queued
+     */
+    uint16_t length() const {
+        uint16_t total = 0;
+        for (uint8_t i = 0; i < LANES; i++) {
+            total += lanes_[i].length();
+        }
+
+        return total;
+    }
+
+    /**
+     * @brief Get maximum capacity of all lanes together
+     * @return Maximum number of frames all lanes can hold
+     */
+    uint16_t capacity() const {
+        uint16_t total = 0;
+        for (uint8_t i = 0; i < LANES; i++) {
+            total += lanes_[i].capacity();
+        }
+
+        return total;
+    }
+
+    /**
+     * @brief Feed the current depth of every lane to its statistics policy
+     * @param elapsedMs Time since the previous call in milliseconds
+     */
+    void sampleStats(uint32_t elapsedMs) {
+        for (uint8_t i = 0; i < LANES; i++) {
+            lanes_[i].sampleStats(elapsedMs);
+        }
+    }
+
+    /**
+     * @brief Clear all elements from all lanes
+     */
+    void clear() {
+        for (uint8_t i = 0; i < LANES; i++) {
+            lanes_[i].clear();
+        }
+    }
+
+private:
+    LANE_QUEUE lanes_[LANES]; ///< One queue per CAN channel
+};
+
+#endif // CAN_LANE_QUEUE_H
@@ -32,9 +32,9 @@ public:
     
     /**
      * @brief Construct from CAN frame pointer
-     * @param frame Pointer to CAN_FRAME structure
+     * @param frame Pointer to CAN_FRAME structure, modified by the setters
      */
-    explicit CanMessage374(const CAN_FRAME* frame);
+    explicit CanMessage374(CAN_FRAME* frame);
     
     /**
      * @brief Get State of Charge 1 (coulomb counting based)
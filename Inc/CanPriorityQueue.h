@@ -0,0 +1,397 @@
+/**
+ * @file CanPriorityQueue.h
+ * @brief Fixed-size priority queue for CAN_FRAME items, ordered like bus arbitration
+ *
+ * Frames leave the queue in the order the CAN bus would arbitrate them
+ * (lowest identifier first), so a low-priority frame queued early can no
+ * longer hold back a high-priority frame queued behind it. Frames with the
+ * same arbitration field leave in the order they were queued.
+ */
+
+#ifndef CAN_PRIORITY_QUEUE_H
+#define CAN_PRIORITY_QUEUE_H
+
+#include <stdint.h>
+#include "can_types.h"
+#include "QueueStats.h"
+
+/**
+ * @class CanPriorityQueue
+ * @brief Binary min-heap of CAN frames keyed on their arbitration field
+ *
+ * Provides the same interface as CanQueue, except that pop(), peek() and
+ * front() always return the highest-priority frame rather than the oldest.
+ *
+ * Frames are stored in a fixed pool and never move once queued; the heap
+ * only holds small {key, sequence, slot} entries, so reserve()/commit() and
+ * front()/release() work in place just as they do for CanQueue. push(),
+ * commit(), pop() and release() are O(log CAPACITY).
+ *
+ * The frame returned by front() may be read in place, but its ID, ide and
+ * rtr must not be changed while it is queued.
+ *
+ * Overflow policies behave as for CanQueue: CAN_QUEUE_DROP_OLDEST evicts
+ * the frame queued longest ago, whatever its priority, and
+ * CAN_QUEUE_COALESCE overwrites the newest queued frame with the same
+ * arbitration field and channel, which leaves the heap order unchanged.
+ * Both scan the queue, so overflow costs O(CAPACITY).
+ *
+ * Thread-safe operations require external synchronization.
+ *
+ * @tparam CAPACITY Maximum number of CAN frames the queue can hold
+ * @tparam STATS Statistics policy, QueueStats or NoQueueStats (default)
+ * @tparam OVERFLOW_POLICY Full queue behaviour, CAN_QUEUE_DROP_NEWEST (default),
+ *         CAN_QUEUE_DROP_OLDEST or CAN_QUEUE_COALESCE
+ */
+template<uint16_t CAPACITY, class STATS = NoQueueStats, CanQueueOverflow OVERFLOW_POLICY = CAN_QUEUE_DROP_NEWEST>
+class CanPriorityQueue {
+public:
+    /**
+     * @brief Default constructor
+     * Initializes an empty queue
+     */
+    CanPriorityQueue() {
+        clear();
+    }
+
+    /**
+     * @brief Push a CAN frame onto the queue
+     * @param frame The CAN frame to add
+     * @return true if the frame was queued, false if it was rejected by a full queue
+     */
+    bool push(const CAN_FRAME& frame) {
+        if (count_ >= CAPACITY) {
+            return overflow(frame);
+        }
+
+        frames_[free_[CAPACITY - 1 - count_]] = frame;
+        commit();
+        return true;
+    }
+
+    /**
+     * @brief Pop the highest-priority CAN frame from the queue
+     * @param frame Pointer to store the popped frame
+     * @return true if successful, false if queue is empty
+     */
+    bool pop(CAN_FRAME* frame) {
+        if (count_ == 0) {
+            return false;
+        }
+
+        if (frame != nullptr) {
+            *frame = frames_[heap_[0].slot];
+        }
+        release();
+        return true;
+    }
+
+    /**
+     * @brief Peek at the highest-priority frame without removing it
+     * @param frame Pointer to store the peeked frame
+     * @return true if successful, false if queue is empty
+     */
+    bool peek(CAN_FRAME* frame) const {
+        if (count_ == 0) {
+            return false;
+        }
+
+        if (frame != nullptr) {
+            *frame = frames_[heap_[0].slot];
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Reserve a free slot so a frame can be written in place
+     * @return Pointer to the slot, or nullptr if queue is full
+     *
+     * The frame is not queued, and not ordered, until commit() is called.
+     * A reservation that is never committed is simply abandoned.
+     *
+     * With CAN_QUEUE_DROP_NEWEST a reserve() that fails on a full queue is
+     * counted as a dropped frame. With the other policies a full queue
+     * returns a spare slot instead and commit() applies the policy.
+     */
+    CAN_FRAME* reserve() {
+        if (count_ >= CAPACITY) {
+            if (OVERFLOW_POLICY == CAN_QUEUE_DROP_NEWEST) {
+                stats_.onDrop();
+                return nullptr;
+            }
+            return &spare_;
+        }
+
+        return &frames_[free_[CAPACITY - 1 - count_]];
+    }
+
+    /**
+     * @brief Queue the slot returned by the last reserve()
+     *
+     * Must only be called after reserve() returned a non-null slot. The
+     * frame's priority is taken from its ID, ide and rtr at this point.
+     */
+    void commit() {
+        if (count_ >= CAPACITY) {
+            // reserve() handed out the spare slot
+            overflow(spare_);
+            return;
+        }
+
+        uint16_t slot = free_[CAPACITY - 1 - count_];
+        Entry entry;
+        entry.key = arbitrationKey(frames_[slot]);
+        entry.seq = nextSeq_++;
+        entry.slot = slot;
+
+        // Sift the new entry up from the bottom of the heap
+        siftUp(count_++, entry);
+        stats_.onPush(count_);
+    }
+
+    /**
+     * @brief Access the highest-priority frame in place, without copying it
+     * @return Pointer to the front frame, or nullptr if queue is empty
+     *
+     * The slot is not reused until release() is called.
+     */
+    CAN_FRAME* front() {
+        if (count_ == 0) {
+            return nullptr;
+        }
+
+        return &frames_[heap_[0].slot];
+    }
+
+    /**
+     * @brief Remove frames returned by front() from the queue
+     * @param count Number of frames to release from the front (default 1)
+     *
+     * Must not release more frames than are queued. When releasing more
+     * than one frame, each is the highest-priority frame at that point.
+     */
+    void release(uint16_t count = 1) {
+        while (count-- > 0) {
+            removeAt(0);
+        }
+    }
+
+    /**
+     * @brief Check if queue is empty
+     * @return true if queue contains no elements
+     */
+    bool isEmpty() const {
+        return count_ == 0;
+    }
+
+    /**
+     * @brief Check if queue is full
+     * @return true if queue is at maximum capacity
+     */
+    bool isFull() const {
+        return count_ >= CAPACITY;
+    }
+
+    /**
+     * @brief Get number of elements in queue
+     * @return Number of CAN frames currently in the queue
+     */
+    uint16_t length() const {
+        return count_;
+    }
+
+    /**
+     * @brief Get maximum capacity of queue
+     * @return Maximum number of frames the queue can hold
+     */
+    uint16_t capacity() const {
+        return CAPACITY;
+    }
+
+    /**
+     * @brief Clear all elements from the queue
+     */
+    void clear() {
+        count_ = 0;
+        nextSeq_ = 0;
+        for (uint16_t i = 0; i < CAPACITY; i++) {
+            free_[i] = i;
+        }
+    }
+
+    /**
+     * @brief Get number of available slots
+     * @return Number of frames that can still be added
+     */
+    uint16_t available() const {
+        return CAPACITY - count_;
+    }
+
+    /**
+     * @brief Feed the current depth to the statistics policy
+     * @param elapsedMs Time since the previous call in milliseconds
+     */
+    void sampleStats(uint32_t elapsedMs) {
+        stats_.sample(count_, elapsedMs);
+    }
+
+    /**
+     * @brief Access the queue statistics
+     * @return The statistics policy instance
+     */
+    const STATS& stats() const {
+        return stats_;
+    }
+
+    /**
+     * @brief Arbitration field of a frame as an unsigned key, lower wins
+     * @param frame The CAN frame
+     * @return Key that orders frames the way bus arbitration does
+     *
+     * Bit layout, most significant first, mirroring the bits on the wire:
+     * base ID (11), RTR or SRR (1), IDE (1), extended ID (18), extended RTR (1).
+     * A standard data frame therefore beats a standard remote frame with the
+     * same ID, which beats any extended frame sharing its 11 base bits.
+     */
+    static uint32_t arbitrationKey(const CAN_FRAME& frame) {
+        if (frame.ide) {
+            uint32_t base = (frame.ID >> 18) & 0x7FF;
+            uint32_t ext = frame.ID & 0x3FFFF;
+            return (base << 21) | (1UL << 20) | (1UL << 19) | (ext << 1) | (frame.rtr ? 1 : 0);
+        }
+
+        return ((frame.ID & 0x7FF) << 21) | (frame.rtr ? (1UL << 20) : 0);
+    }
+
+private:
+    /**
+     * @brief Heap entry, kept small so sifting does not move whole frames
+     */
+    struct Entry {
+        uint32_t key;   ///< Arbitration key, see arbitrationKey()
+        uint16_t seq;   ///< Queue order, breaks ties between equal keys
+        uint16_t slot;  ///< Index of the frame in frames_
+    };
+
+    /**
+     * @brief true if entry a must leave the queue before entry b
+     */
+    static bool before(const Entry& a, const Entry& b) {
+        if (a.key != b.key) {
+            return a.key < b.key;
+        }
+
+        // Wrap-safe, as at most CAPACITY sequence numbers are live at once
+        return (int16_t)(a.seq - b.seq) < 0;
+    }
+
+    /**
+     * @brief Apply the OVERFLOW_POLICY to a frame that does not fit
+     * @return true if the frame was queued, false if it was rejected
+     */
+    bool overflow(const CAN_FRAME& frame) {
+        stats_.onDrop();
+
+        if (OVERFLOW_POLICY == CAN_QUEUE_DROP_OLDEST) {
+            uint16_t oldest = 0;
+            for (uint16_t i = 1; i < count_; i++) {
+                if ((int16_t)(heap_[i].seq - heap_[oldest].seq) < 0) {
+                    oldest = i;
+                }
+            }
+
+            // The evicted slot is back on top of the free list, reuse it
+            removeAt(oldest);
+            frames_[free_[CAPACITY - 1 - count_]] = frame;
+            commit();
+            return true;
+        }
+
+        if (OVERFLOW_POLICY == CAN_QUEUE_COALESCE) {
+            uint32_t key = arbitrationKey(frame);
+            int32_t newest = -1;
+            for (uint16_t i = 0; i < count_; i++) {
+                if (heap_[i].key == key && frames_[heap_[i].slot].tx_channel == frame.tx_channel &&
+                    (newest < 0 || (int16_t)(heap_[i].seq - heap_[newest].seq) > 0)) {
+                    newest = i;
+                }
+            }
+
+            if (newest >= 0) {
+                // Same key, so the heap order does not change
+                frames_[heap_[newest].slot] = frame;
+                stats_.onPush(count_);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief Remove the entry at a heap position and free its slot
+     */
+    void removeAt(uint16_t i) {
+        // The freed slot goes back on the free list, which grows downwards
+        free_[CAPACITY - count_] = heap_[i].slot;
+        count_--;
+        if (i >= count_) {
+            return;
+        }
+
+        // Move the last entry into the hole, then restore heap order
+        Entry last = heap_[count_];
+        if (i > 0 && before(last, heap_[(i - 1) / 2])) {
+            siftUp(i, last);
+        } else {
+            siftDown(i, last);
+        }
+    }
+
+    /**
+     * @brief Place entry at position i and sift it up to restore heap order
+     */
+    void siftUp(uint16_t i, const Entry& entry) {
+        while (i > 0) {
+            uint16_t parent = (i - 1) / 2;
+            if (!before(entry, heap_[parent])) {
+                break;
+            }
+            heap_[i] = heap_[parent];
+            i = parent;
+        }
+        heap_[i] = entry;
+    }
+
+    /**
+     * @brief Place entry at position i and sift it down to restore heap order
+     */
+    void siftDown(uint16_t i, const Entry& entry) {
+        for (;;) {
+            uint16_t child = 2 * i + 1;
+            if (child >= count_) {
+                break;
+            }
+            if (child + 1 < count_ && before(heap_[child + 1], heap_[child])) {
+                child++;
+            }
+            if (!before(heap_[child], entry)) {
+                break;
+            }
+            heap_[i] = heap_[child];
+            i = child;
+        }
+        heap_[i] = entry;
+    }
+
+    CAN_FRAME frames_[CAPACITY];  ///< Frame pool, frames stay put while queued
+    CAN_FRAME spare_;             ///< Slot reserve() hands out when full, unless dropping newest
+    Entry heap_[CAPACITY];        ///< Min-heap of queued frames
+    uint16_t free_[CAPACITY];     ///< Free slot indices, in free_[0 .. CAPACITY-count_-1]
+    uint16_t count_;              ///< Current number of elements
+    uint16_t nextSeq_;            ///< Sequence number for the next committed frame
+    STATS stats_;                 ///< Occupancy and overflow statistics
+};
+
+#endif // CAN_PRIORITY_QUEUE_H
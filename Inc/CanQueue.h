@@ -11,6 +11,7 @@
 
 #include <stdint.h>
 #include "can_types.h"
+#include "QueueStats.h"
 
 /**
  * @class CanQueue
@@ -19,10 +20,19 @@
  * Provides a simple FIFO queue implementation for CAN_FRAME objects.
  * The queue is implemented as a circular buffer with a fixed capacity
  * determined at compile time via template parameter.
+ *
+ * What happens to a frame pushed onto a full queue is set by OVERFLOW_POLICY.
+ * CAN_QUEUE_COALESCE suits periodic signals, where only the latest value
+ * matters: the new frame overwrites the newest queued frame with the same
+ * ID, ide, rtr and channel, in place, so it keeps that frame's position.
+ * Either way exactly one frame is lost, and counted as a drop.
  * 
  * @tparam CAPACITY Maximum number of CAN frames the queue can hold
+ * @tparam STATS Statistics policy, QueueStats or NoQueueStats (default)
+ * @tparam OVERFLOW_POLICY Full queue behaviour, CAN_QUEUE_DROP_NEWEST (default),
+ *         CAN_QUEUE_DROP_OLDEST or CAN_QUEUE_COALESCE
  */
-template<uint16_t CAPACITY>
+template<uint16_t CAPACITY, class STATS = NoQueueStats, CanQueueOverflow OVERFLOW_POLICY = CAN_QUEUE_DROP_NEWEST>
 class CanQueue {
 public:
     /**
@@ -35,16 +45,17 @@ public:
     /**
      * @brief Push a CAN frame onto the queue
      * @param frame The CAN frame to add
-     * @return true if successful, false if queue is full
+     * @return true if the frame was queued, false if it was rejected by a full queue
      */
     bool push(const CAN_FRAME& frame) {
         if (isFull()) {
-            return false;
+            return overflow(frame);
         }
         
         buffer_[head_] = frame;
         head_ = (head_ + 1) % CAPACITY;
         count_++;
+        stats_.onPush(count_);
         return true;
     }
     
@@ -84,6 +95,105 @@ public:
         return true;
     }
     
+    /**
+     * @brief Reserve the next free slot so a frame can be built in place
+     * @return Pointer to the slot, or nullptr if queue is full
+     *
+     * The slot only becomes part of the queue when commit() is called.
+     * A reservation that is never committed is simply abandoned, and the
+     * same slot is returned by the next call to reserve().
+     *
+     * With CAN_QUEUE_DROP_NEWEST a reserve() that fails on a full queue is
+     * counted as a dropped frame. With the other policies a full queue
+     * returns a spare slot instead and commit() applies the policy.
+     */
+    CAN_FRAME* reserve() {
+        if (isFull()) {
+            if (OVERFLOW_POLICY == CAN_QUEUE_DROP_NEWEST) {
+                stats_.onDrop();
+                return nullptr;
+            }
+            return &spare_;
+        }
+
+        return &buffer_[head_];
+    }
+
+    /**
+     * @brief Add the slot returned by the last reserve() to the queue
+     *
+     * Must only be called after reserve() returned a non-null slot.
+     */
+    void commit() {
+        if (isFull()) {
+            // reserve() handed out the spare slot
+            overflow(spare_);
+            return;
+        }
+
+        head_ = (head_ + 1) % CAPACITY;
+        count_++;
+        stats_.onPush(count_);
+    }
+
+    /**
+     * @brief Access the front element in place, without copying it
+     * @return Pointer to the front frame, or nullptr if queue is empty
+     *
+     * The frame stays in the queue, and may be modified in place,
+     * until release() is called.
+     */
+    CAN_FRAME* front() {
+        if (isEmpty()) {
+            return nullptr;
+        }
+
+        return &buffer_[tail_];
+    }
+
+    /**
+     * @brief Access the frames at the front of the queue in place, as one contiguous span
+     * @param frames Set to the first frame of the span, or nullptr if queue is empty
+     * @return Number of frames in the span
+     *
+     * The span stops at the end of the circular buffer, so a queue that has
+     * wrapped around is returned as two spans by consecutive calls. The
+     * frames stay in the queue until release(count) is called.
+     */
+    uint16_t frontSpan(CAN_FRAME** frames) {
+        uint16_t toEnd = CAPACITY - tail_;
+        uint16_t count = (count_ < toEnd) ? count_ : toEnd;
+        *frames = (count > 0) ? &buffer_[tail_] : nullptr;
+        return count;
+    }
+
+    /**
+     * @brief Remove frames returned by front() or frontSpan()
+     * @param count Number of frames to remove from the front (default 1)
+     *
+     * Must not remove more frames than front()/frontSpan() returned.
+     */
+    void release(uint16_t count = 1) {
+        tail_ = (tail_ + count) % CAPACITY;
+        count_ -= count;
+    }
+
+    /**
+     * @brief Pop several CAN frames from the queue in one call
+     * @param frames Array to store the popped frames, in queue order
+     * @param max Maximum number of frames to pop (size of the frames array)
+     * @return Number of frames popped, 0 if queue is empty
+     */
+    uint16_t popMany(CAN_FRAME* frames, uint16_t max) {
+        uint16_t count = (count_ < max) ? count_ : max;
+        for (uint16_t i = 0; i < count; i++) {
+            frames[i] = buffer_[tail_];
+            tail_ = (tail_ + 1) % CAPACITY;
+        }
+        count_ -= count;
+        return count;
+    }
+
     /**
      * @brief Check if queue is empty
      * @return true if queue contains no elements
@@ -132,12 +242,64 @@ public:
     uint16_t available() const {
         return CAPACITY - count_;
     }
+
+    /**
+     * @brief Feed the current depth to the statistics policy
+     * @param elapsedMs Time since the previous call in milliseconds
+     */
+    void sampleStats(uint32_t elapsedMs) {
+        stats_.sample(count_, elapsedMs);
+    }
+
+    /**
+     * @brief Access the queue statistics
+     * @return The statistics policy instance
+     */
+    const STATS& stats() const {
+        return stats_;
+    }
     
 private:
+    /**
+     * @brief Apply the OVERFLOW_POLICY policy to a frame that does not fit
+     * @return true if the frame was queued, false if it was rejected
+     */
+    bool overflow(const CAN_FRAME& frame) {
+        stats_.onDrop();
+
+        if (OVERFLOW_POLICY == CAN_QUEUE_DROP_OLDEST) {
+            // Overwrite the oldest frame, which is where head_ is when full
+            buffer_[head_] = frame;
+            head_ = (head_ + 1) % CAPACITY;
+            tail_ = head_;
+            stats_.onPush(count_);
+            return true;
+        }
+
+        if (OVERFLOW_POLICY == CAN_QUEUE_COALESCE) {
+            // Search from the newest frame back, so queued values stay in order
+            uint16_t index = head_;
+            for (uint16_t i = 0; i < count_; i++) {
+                index = (index == 0) ? (CAPACITY - 1) : (index - 1);
+                CAN_FRAME& queued = buffer_[index];
+                if (queued.ID == frame.ID && queued.ide == frame.ide && queued.rtr == frame.rtr &&
+                    queued.tx_channel == frame.tx_channel) {
+                    queued = frame;
+                    stats_.onPush(count_);
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
     CAN_FRAME buffer_[CAPACITY];  ///< Circular buffer storage
+    CAN_FRAME spare_;              ///< Slot reserve() hands out when full, unless dropping newest
     uint16_t head_;                ///< Write position
     uint16_t tail_;                ///< Read position
     uint16_t count_;               ///< Number of items in queue
+    STATS stats_;                  ///< Occupancy and overflow statistics
 };
 
 #endif // CAN_QUEUE_H
@@ -0,0 +1,51 @@
+/**
+ * @file CanRxMailbox.h
+ * @brief Decode a bxCAN receive FIFO mailbox straight from its registers
+ *
+ * Used by the register-level RX interrupt handler (CAN_RX_DIRECT builds),
+ * which reads the FIFO output mailbox without going through HAL. Kept free
+ * of device headers so the decoding can be unit tested on the host.
+ */
+
+#ifndef CAN_RX_MAILBOX_H
+#define CAN_RX_MAILBOX_H
+
+#include <stdint.h>
+#include <string.h>
+#include "can_types.h"
+
+// CAN_RIxR bits. IDE and RTR have the values of HAL's CAN_ID_EXT and
+// CAN_RTR_REMOTE, so frames match those received through HAL_CAN_GetRxMessage()
+const uint32_t CAN_RX_MAILBOX_RTR = 0x00000002UL;
+const uint32_t CAN_RX_MAILBOX_IDE = 0x00000004UL;
+const uint8_t CAN_RX_MAILBOX_EXID_SHIFT = 3;
+const uint8_t CAN_RX_MAILBOX_STID_SHIFT = 21;
+
+/**
+ * @brief Fill a frame from the four registers of a receive FIFO mailbox
+ * @param rir Identifier register (CAN_RIxR)
+ * @param rdtr Length and time stamp register (CAN_RDTxR)
+ * @param rdlr Data bytes 0-3 (CAN_RDLxR)
+ * @param rdhr Data bytes 4-7 (CAN_RDHxR)
+ * @param channel CAN channel index the frame was received on
+ * @param frame Frame to fill in; the timestamp is left unchanged
+ */
+inline void CanRxMailboxDecode(uint32_t rir, uint32_t rdtr, uint32_t rdlr, uint32_t rdhr,
+                               uint8_t channel, CAN_FRAME* frame) {
+    frame->ide = rir & CAN_RX_MAILBOX_IDE;
+    frame->rtr = rir & CAN_RX_MAILBOX_RTR;
+    if (frame->ide) {
+        frame->ID = rir >> CAN_RX_MAILBOX_EXID_SHIFT;
+    } else {
+        frame->ID = rir >> CAN_RX_MAILBOX_STID_SHIFT;
+    }
+    frame->dlc = rdtr & 0x0F;
+    frame->rx_channel = channel;
+
+    // Data bytes are stored lowest byte first, the CPU's own byte order, so
+    // each register is one word store into the word aligned data array
+    memcpy(&frame->data[0], &rdlr, sizeof(rdlr));
+    memcpy(&frame->data[4], &rdhr, sizeof(rdhr));
+}
+
+#endif // CAN_RX_MAILBOX_H
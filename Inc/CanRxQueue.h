@@ -0,0 +1,21 @@
+/**
+ * @file CanRxQueue.h
+ * @brief Receive queue type shared by the CAN RX ISRs and the main loop
+ */
+
+#ifndef CAN_RX_QUEUE_H
+#define CAN_RX_QUEUE_H
+
+#include "can_types.h"
+#include "QueueStats.h"
+#include "SpscCanQueue.h"
+
+/**
+ * @brief Frames received on either CAN bus, waiting for the main loop
+ *
+ * Written by the CAN RX ISRs, read by the main loop, lock-free. Keeps
+ * QueueStats, reported by Diagnostics.
+ */
+typedef SpscCanQueue<QUEUE_CAPACITY, QueueStats> CanRxQueue;
+
+#endif // CAN_RX_QUEUE_H
@@ -0,0 +1,70 @@
+/**
+ * @file CanTimestampExtender.h
+ * @brief Extend 16-bit bxCAN receive timestamps to 32 bits
+ *
+ * With time triggered communication mode enabled (CAN_HW_TIMESTAMPS builds)
+ * bxCAN captures its free running 16-bit timer at the start of frame of
+ * every received message. The timer counts bit times, so it wraps every
+ * 65536 bits, 131 ms at 500 kbit/s, which is too short to time messages
+ * that may be missing for a while.
+ */
+
+#ifndef CAN_TIMESTAMP_EXTENDER_H
+#define CAN_TIMESTAMP_EXTENDER_H
+
+#include <stdint.h>
+
+/**
+ * @class CanTimestampExtender
+ * @brief Accumulates successive 16-bit timestamps into a 32-bit bit time
+ *
+ * Gaps between samples shorter than one timer period are taken from the
+ * hardware timestamps alone. Whole timer periods are added back from a
+ * coarse clock in the same unit, the HAL tick converted to bit times, which
+ * only has to be accurate to half a timer period.
+ *
+ * The extended values count from the first sample, so only values from
+ * the same extender can be compared. Used by one interrupt handler only.
+ */
+class CanTimestampExtender {
+public:
+    CanTimestampExtender() :
+        time_(0),
+        lastCoarse_(0),
+        lastSample_(0),
+        started_(false) {
+    }
+
+    /**
+     * @brief Extend the timestamp of the next received frame (ISR)
+     * @param sample 16-bit hardware timestamp in bit times
+     * @param coarse Coarse time of receipt in bit times, wraps at 2^32
+     * @return Extended timestamp in bit times, wraps at 2^32
+     */
+    uint32_t extend(uint16_t sample, uint32_t coarse) {
+        if (!started_) {
+            started_ = true;
+            time_ = sample;
+        } else {
+            uint16_t delta = sample - lastSample_;
+            uint32_t elapsed = coarse - lastCoarse_;
+            uint32_t wraps = 0;
+            if (elapsed > delta) {
+                // Round to the nearest whole number of timer periods
+                wraps = (elapsed - delta + 0x8000) >> 16;
+            }
+            time_ += delta + (wraps << 16);
+        }
+        lastSample_ = sample;
+        lastCoarse_ = coarse;
+        return time_;
+    }
+
+private:
+    uint32_t time_;         ///< Extended timestamp of the last sample
+    uint32_t lastCoarse_;   ///< Coarse time of the last sample
+    uint16_t lastSample_;   ///< Last hardware timestamp
+    bool started_;          ///< A first sample has been taken
+};
+
+#endif // CAN_TIMESTAMP_EXTENDER_H
@@ -0,0 +1,93 @@
+/**
+ * @file CanTxMailbox.h
+ * @brief Load a bxCAN transmit mailbox straight from its registers
+ *
+ * Used by the register-level transmit path (CAN_TX_DIRECT builds), which
+ * writes a frame into the lowest free mailbox without going through
+ * HAL_CAN_AddTxMessage(). Kept free of device headers, and templated on
+ * the register block, so it can be unit tested against a host model of
+ * the registers.
+ */
+
+#ifndef CAN_TX_MAILBOX_H
+#define CAN_TX_MAILBOX_H
+
+#include <stdint.h>
+#include <string.h>
+#include "can_types.h"
+
+const uint8_t CAN_TX_MAILBOX_COUNT = 3;
+
+// CAN_TIxR bits. IDE and RTR have the values of HAL's CAN_ID_EXT and
+// CAN_RTR_REMOTE, which is what CAN_FRAME holds
+const uint32_t CAN_TX_MAILBOX_TXRQ = 0x00000001UL;
+const uint32_t CAN_TX_MAILBOX_RTR = 0x00000002UL;
+const uint32_t CAN_TX_MAILBOX_IDE = 0x00000004UL;
+const uint8_t CAN_TX_MAILBOX_EXID_SHIFT = 3;
+const uint8_t CAN_TX_MAILBOX_STID_SHIFT = 21;
+
+// CAN_TSR transmit mailbox empty bits, TME0 to TME2
+const uint32_t CAN_TX_MAILBOX_TME0 = 0x04000000UL;
+
+/**
+ * @brief Find the lowest numbered empty transmit mailbox
+ * @param tsr Transmit status register (CAN_TSR)
+ * @return Mailbox number 0-2, or -1 if all three are pending
+ */
+inline int8_t CanTxMailboxLowestFree(uint32_t tsr) {
+    for (uint8_t i = 0; i < CAN_TX_MAILBOX_COUNT; i++) {
+        if ((tsr & (CAN_TX_MAILBOX_TME0 << i)) != 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Identifier register value for a frame, without the transmit request
+ * @param frame Frame to send
+ * @return CAN_TIxR value with STID or EXID, IDE and RTR
+ */
+inline uint32_t CanTxMailboxIdentifier(const CAN_FRAME& frame) {
+    uint32_t tir = frame.ide ? (frame.ID << CAN_TX_MAILBOX_EXID_SHIFT) | CAN_TX_MAILBOX_IDE
+                             : (frame.ID << CAN_TX_MAILBOX_STID_SHIFT);
+    if (frame.rtr) {
+        tir |= CAN_TX_MAILBOX_RTR;
+    }
+    return tir;
+}
+
+/**
+ * @brief Write a frame into the lowest free transmit mailbox and request it be sent
+ * @tparam CAN_REGS Register block with TSR and sTxMailBox[3].TIR/TDTR/TDLR/TDHR,
+ *         CAN_TypeDef on the target
+ * @param can Controller registers
+ * @param frame Frame to send
+ * @return Mailbox number used, or -1 if none was free
+ *
+ * TDTR is written with TGT clear, so time triggered mode never replaces
+ * data bytes 6-7 with the timer. TIR is written last, with TXRQ, so the
+ * controller only sees a completely loaded mailbox.
+ */
+template<class CAN_REGS>
+int8_t CanTxMailboxLoad(CAN_REGS* can, const CAN_FRAME& frame) {
+    int8_t index = CanTxMailboxLowestFree(can->TSR);
+    if (index < 0) {
+        return -1;
+    }
+
+    // Data bytes are stored lowest byte first, the CPU's own byte order, so
+    // each register is one word load from the word aligned data array
+    uint32_t low;
+    uint32_t high;
+    memcpy(&low, &frame.data[0], sizeof(low));
+    memcpy(&high, &frame.data[4], sizeof(high));
+
+    can->sTxMailBox[index].TDTR = frame.dlc & 0x0F;
+    can->sTxMailBox[index].TDLR = low;
+    can->sTxMailBox[index].TDHR = high;
+    can->sTxMailBox[index].TIR = CanTxMailboxIdentifier(frame) | CAN_TX_MAILBOX_TXRQ;
+    return index;
+}
+
+#endif // CAN_TX_MAILBOX_H
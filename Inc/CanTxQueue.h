@@ -0,0 +1,36 @@
+/**
+ * @file CanTxQueue.h
+ * @brief Transmit queue type shared by the main loop and the App
+ */
+
+#ifndef CAN_TX_QUEUE_H
+#define CAN_TX_QUEUE_H
+
+#include "can_types.h"
+#include "CanPriorityQueue.h"
+#include "CanLaneQueue.h"
+#include "SpscCanQueue.h"
+
+/**
+ * @brief Frames waiting to be transmitted, in one lane per CAN channel
+ *
+ * Each lane holds up to QUEUE_CAPACITY frames for its controller and hands
+ * them out lowest CAN ID first, the order the bus itself would send them.
+ * Every lane keeps QueueStats, reported by Diagnostics.
+ *
+ * A full lane coalesces: a new frame replaces a queued frame with the same
+ * ID, so under a burst periodic signals such as 0x373/0x374 go out with
+ * their latest value rather than being dropped.
+ */
+typedef CanLaneQueue<CanPriorityQueue<QUEUE_CAPACITY, QueueStats, CAN_QUEUE_COALESCE>, CAN_CHANNEL_COUNT> CanTxQueue;
+
+/**
+ * @brief Frames taken from one TxQueue lane, next in line for its mailboxes
+ *
+ * Filled by the main loop, emptied by the TX mailbox empty interrupt, which
+ * reloads a mailbox the moment it frees up without touching the lane.
+ * Kept short, as staged frames no longer take part in priority ordering.
+ */
+typedef SpscCanQueue<CAN_TX_STAGE_DEPTH> CanTxStage;
+
+#endif // CAN_TX_QUEUE_H
@@ -0,0 +1,161 @@
+/**
+ * @file CpuProfile.h
+ * @brief Where the CPU time goes: load, worst main loop pass and time per section
+ */
+
+#ifndef CPU_PROFILE_H
+#define CPU_PROFILE_H
+
+#include <stdint.h>
+#include "CycleCounter.h"
+#include "IdleStats.h"
+
+/**
+ * @class CpuProfile
+ * @brief Attributes CycleCounter time to the bridge's work over one second windows
+ *
+ * The main loop reports each span it is awake, as for IdleStats (kept here
+ * and reported on its own), which gives the load and the worst single pass
+ * of the loop. Each profiled section adds its own running time, measured
+ * with CycleCounter::now() around it, to a free-running total; a window's
+ * share is the growth of that total.
+ *
+ * A section is written by one context only: the FIFO0 and the FIFO1 RX
+ * interrupts (one priority each), and whichever context runs the App and
+ * the TX lanes (the main loop, or PendSV). Times are inclusive of the
+ * interrupts that preempt a section, so the shares can add up to more
+ * than the load. update() and the getters are for the main loop only.
+ */
+class CpuProfile {
+public:
+    /**
+     * @brief Profiled work
+     */
+    enum Section {
+        SECTION_RX_ISR_FIFO0 = 0,   ///< RX interrupts draining FIFO0, both channels
+        SECTION_RX_ISR_FIFO1 = 1,   ///< RX interrupts draining FIFO1, both channels
+        SECTION_PROCESS_RX = 2,     ///< ProcessCanRx(), the App handling received frames
+        SECTION_PROCESS_TX = 3,     ///< ProcessCanTx(), TX lanes to the controllers
+        SECTION_PROCESS_TICK = 4,   ///< ProcessTick(), the App's timer wheel
+        SECTION_COUNT = 5
+    };
+
+    static const uint32_t WINDOW_MS = IdleStats::WINDOW_MS;
+
+    CpuProfile() :
+        windowStartMs_(0),
+        started_(false),
+        complete_(false),
+        windowMaxAwake_(0),
+        maxAwake_(0) {
+        for (uint8_t i = 0; i < SECTION_COUNT; i++) {
+            total_[i] = 0;
+            windowStart_[i] = 0;
+            permille_[i] = 0;
+        }
+    }
+
+    /**
+     * @brief Add the running time of one pass through a section
+     * @param section Work that ran, from the one context that runs it
+     * @param cycles Length in CycleCounter counts
+     */
+    void add(Section section, uint32_t cycles) {
+        total_[section] += cycles;
+    }
+
+    /**
+     * @brief Add one span the core was awake (main loop)
+     * @param cycles Length in CycleCounter counts
+     */
+    void addAwake(uint32_t cycles) {
+        idle_.addBusy(cycles);
+        if (cycles > windowMaxAwake_) {
+            windowMaxAwake_ = cycles;
+        }
+    }
+
+    /**
+     * @brief Close the window once it is WINDOW_MS long (main loop)
+     * @param nowMs Current HAL tick
+     */
+    void update(uint32_t nowMs) {
+        idle_.update(nowMs);
+
+        if (!started_) {
+            started_ = true;
+            startWindow(nowMs);
+            return;
+        }
+
+        uint32_t elapsedMs = nowMs - windowStartMs_;
+        if (elapsedMs < WINDOW_MS) {
+            return;
+        }
+
+        uint64_t windowCycles = (uint64_t)elapsedMs * (CycleCounter::frequencyHz() / 1000);
+        for (uint8_t i = 0; i < SECTION_COUNT; i++) {
+            uint64_t share = (uint64_t)(total_[i] - windowStart_[i]) * 1000 / windowCycles;
+            permille_[i] = (share > 1000) ? 1000 : (uint16_t)share;
+        }
+        maxAwake_ = windowMaxAwake_;
+        complete_ = true;
+        startWindow(nowMs);
+    }
+
+    /**
+     * @brief Get the load over the last complete window
+     * @return Time awake in 1/1000 of the window, 0 before the first window
+     */
+    uint16_t loadPermille() const {
+        return complete_ ? (uint16_t)(1000 - idle_.idlePermille()) : 0;
+    }
+
+    /**
+     * @brief Get the longest the main loop stayed awake in the last complete window
+     * @return Cycles in CycleCounter counts, 0 before the first window
+     */
+    uint32_t maxAwakeCycles() const {
+        return maxAwake_;
+    }
+
+    /**
+     * @brief Get a section's share of the last complete window
+     * @param section Profiled work
+     * @return Running time in 1/1000 of the window, 0 before the first window
+     */
+    uint16_t sectionPermille(Section section) const {
+        return permille_[section];
+    }
+
+    /**
+     * @brief Get the idle statistics, for the main loop page
+     */
+    const IdleStats& idle() const {
+        return idle_;
+    }
+
+private:
+    /**
+     * @brief Start a window at the current section totals
+     */
+    void startWindow(uint32_t nowMs) {
+        windowStartMs_ = nowMs;
+        windowMaxAwake_ = 0;
+        for (uint8_t i = 0; i < SECTION_COUNT; i++) {
+            windowStart_[i] = total_[i];
+        }
+    }
+
+    volatile uint32_t total_[SECTION_COUNT];    ///< Running time of each section, wraps at 2^32
+    uint32_t windowStart_[SECTION_COUNT];       ///< total_ at the start of the current window
+    uint16_t permille_[SECTION_COUNT];          ///< Shares of the last complete window
+    IdleStats idle_;                            ///< Time asleep, windows aligned with these
+    uint32_t windowStartMs_;    ///< HAL tick the current window started at
+    bool started_;              ///< The first window has started
+    bool complete_;             ///< A window has completed
+    uint32_t windowMaxAwake_;   ///< Longest awake span in the current window
+    uint32_t maxAwake_;         ///< Longest awake span in the last complete window
+};
+
+#endif // CPU_PROFILE_H
@@ -0,0 +1,72 @@
+/**
+ * @file CycleCounter.h
+ * @brief Free-running cycle counter for timing short intervals
+ *
+ * On the target this is the Cortex-M3 DWT cycle counter, which counts HCLK
+ * cycles and wraps every 2^32 cycles (about 119 s at 36 MHz). On the host
+ * it is backed by std::chrono, counting nanoseconds, so code using it can
+ * be unit tested. Intervals are taken as the unsigned difference of two
+ * readings, which is correct across a single wrap.
+ */
+
+#ifndef CYCLE_COUNTER_H
+#define CYCLE_COUNTER_H
+
+#include <stdint.h>
+
+#if defined(__arm__)
+#include "stm32f1xx.h"
+#else
+#include <chrono>
+#endif
+
+namespace CycleCounter {
+
+/**
+ * @brief Start the counter, once at start-up
+ */
+inline void init() {
+#if defined(__arm__)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+/**
+ * @brief Read the counter
+ * @return Current count, wraps at 2^32
+ */
+inline uint32_t now() {
+#if defined(__arm__)
+    return DWT->CYCCNT;
+#else
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/**
+ * @brief Get the counter frequency
+ * @return Counts per second
+ */
+inline uint32_t frequencyHz() {
+#if defined(__arm__)
+    return SystemCoreClock;
+#else
+    return 1000000000UL;
+#endif
+}
+
+/**
+ * @brief Convert a number of counts to microseconds
+ * @param cycles Interval in counts
+ * @return Interval in microseconds, rounded down
+ */
+inline uint32_t toMicros(uint32_t cycles) {
+    return cycles / (frequencyHz() / 1000000UL);
+}
+
+} // namespace CycleCounter
+
+#endif // CYCLE_COUNTER_H
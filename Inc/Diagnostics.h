@@ -0,0 +1,347 @@
+/**
+ * @file Diagnostics.h
+ * @brief Diagnostic CAN frame 0x721, sent alongside the 0x720 heartbeat
+ *
+ * 0x721 is multiplexed: byte 0 selects a page, bytes 1-7 carry the page
+ * data. Multi-byte values are big-endian, as in the heartbeat.
+ *
+ * Queue pages, one pair per queue, q = 0 RxQueue (FIFO0), 1 TxQueue CAN1
+ * lane, 2 TxQueue CAN2 lane, 3 priority RxQueue (FIFO1):
+ * Page 0x10 + q, occupancy:
+ *   D1: high-water mark (frames)
+ *   D2: depth at the last sample (frames)
+ *   D3: QUEUE_STATS_DEPTH_THRESHOLD (frames)
+ *   D4-D7: time spent at or above the threshold (ms)
+ * Page 0x20 + q, traffic:
+ *   D1-D3: frames dropped because the queue was full, saturates at 0xFFFFFF
+ *   D4-D7: frames pushed
+ *
+ * Forwarding latency pages, builds with CAN_FRAME_TIMESTAMPS only, one per
+ * channel c = 0 CAN1, 1 CAN2, for frames sent on that channel:
+ * Page 0x30 + c, receive to TX mailbox latency:
+ *   D1-D2: minimum (us), saturates at 0xFFFF
+ *   D3-D4: mean (us), saturates at 0xFFFF
+ *   D5-D7: maximum (us), saturates at 0xFFFFFF
+ *
+ * RX interrupt pages, one per channel and FIFO, p = 2 * c + FIFO number:
+ * Page 0x40 + p, frames drained per RX interrupt:
+ *   D1: most frames read by a single interrupt
+ *   D2-D4: interrupts handled, low 24 bits (wraps)
+ *   D5-D7: frames read, low 24 bits (wraps)
+ *
+ * Cut-through pages, builds with CAN_CUT_THROUGH only, one per channel
+ * c = 0 CAN1, 1 CAN2, for passthrough frames received on that channel:
+ * Page 0x50 + c, frames forwarded by the RX interrupt:
+ *   D1-D4: frames loaded straight into a TX mailbox of the other channel
+ *
+ * RX FIFO loss pages, one per channel and FIFO, p = 2 * c + FIFO number:
+ * Page 0x70 + p, hardware FIFO full and overrun:
+ *   D1-D2: overruns, each losing one or more frames, saturates at 0xFFFF
+ *   D3-D4: times the FIFO was found full, saturates at 0xFFFF
+ *   D5-D7: RxQueue depth at the last three overruns, most recent first
+ *          (frames, saturates at 0xFE), 0xFF where there was none
+ *
+ * Receive interval page, builds with CAN_HW_TIMESTAMPS only:
+ * Page 0x60, time between consecutive 0x373 frames by hardware timestamp:
+ *   D1-D2: minimum (us), saturates at 0xFFFF
+ *   D3-D4: mean (us), saturates at 0xFFFF
+ *   D5-D7: maximum (us), saturates at 0xFFFFFF
+ *
+ * Main loop page:
+ * Page 0x80, how the event-driven main loop keeps up:
+ *   D1-D2: time asleep over the last second (1/1000)
+ *   D3-D4: mean wait from an interrupt leaving work to the loop taking it
+ *          up (us), saturates at 0xFFFF
+ *   D5-D7: maximum of that wait (us), saturates at 0xFFFFFF
+ *
+ * Scheduler page:
+ * Page 0x90, cost of the App's timer wheel per timeTickMs() call:
+ *   D1-D3: mean (CycleCounter counts), saturates at 0xFFFFFF
+ *   D4-D7: maximum (CycleCounter counts)
+ *
+ * CPU profile pages, over the last complete second:
+ * Page 0xA0, load:
+ *   D1-D2: time awake (1/1000)
+ *   D3-D5: longest single main loop pass, wake to sleep, interrupts
+ *          included (us), saturates at 0xFFFFFF
+ * Page 0xA1, running time per section (1/1000), interrupts that preempt
+ * a section included:
+ *   D1-D2: RX interrupts, both FIFOs and channels
+ *   D3-D4: ProcessCanRx(), received frames through the App
+ *   D5-D6: ProcessCanTx(), TX lanes to the controllers
+ *   D7: ProcessTick(), the App's periodic tasks, saturates at 0xFF
+ *
+ * Main loop stall pages, stage numbers as LoopMonitor::Stage (0 RX, 1 TX,
+ * 2 tick, 0xFF none):
+ * Page 0xC0, the reset before this start-up:
+ *   D1: bit 0 stall record survived, bit 1 reset by the watchdog
+ *   D2: stage running at the reset
+ *   D3: stage of the worst overrun before the reset
+ *   D4-D7: length of that overrun (us)
+ * Page 0xC1, since start-up:
+ *   D1: stage of the worst overrun
+ *   D2-D4: length of that overrun (us), saturates at 0xFFFFFF
+ *   D5-D7: longest main loop iteration (us), saturates at 0xFFFFFF
+ *
+ * Bus error pages, four per channel c = 0 CAN1, 1 CAN2, error states as
+ * CanErrorMonitor::State (0 active, 1 warning, 2 passive, 3 bus-off):
+ * Page 0xD0 + c, error state:
+ *   D1: error state at the last sample
+ *   D2: transmit error counter (TEC)
+ *   D3: receive error counter (REC)
+ *   D4-D5: bus-offs, saturates at 0xFFFF
+ *   D6-D7: frames dropped for bus-offs, from the TX mailboxes and the
+ *          TxQueue lane, saturates at 0xFFFF
+ * Page 0xD2 + c, errors by last error code, each saturates at 0xFFFF:
+ *   D1-D2: stuff errors
+ *   D3-D4: form errors
+ *   D5-D6: acknowledgment errors
+ * Page 0xD4 + c, errors by last error code, each saturates at 0xFFFF:
+ *   D1-D2: bit recessive errors (sent recessive, read dominant)
+ *   D3-D4: bit dominant errors (sent dominant, read recessive)
+ *   D5-D6: CRC errors
+ * Page 0xD6 + c, time in the error states:
+ *   D1-D2: error warning (s), saturates at 0xFFFF
+ *   D3-D4: error passive (s), saturates at 0xFFFF
+ *   D5-D6: bus-off (s), saturates at 0xFFFF
+ *   D7: longest bus-off to back on the bus (ms), saturates at 0xFF
+ *
+ * Latency histogram dumps, builds with CAN_FRAME_TIMESTAMPS only, sent on
+ * request (REQUEST_ID) rather than with the heartbeat. One set per
+ * forwarding stage s = 0 RX interrupt to App, 1 App to TxQueue, 2 TxQueue
+ * to TX mailbox, all as page 0xB0 + s:
+ * Summary frame:
+ *   D1: 0xFF
+ *   D2-D4: p99 upper bound (us), saturates at 0xFFFFFF
+ *   D5-D7: p99.9 upper bound (us), saturates at 0xFFFFFF
+ * Bucket frames, from the lowest to the highest non-empty bucket, bucket
+ * b counting latencies of 2^(b-1) to 2^b - 1 CycleCounter counts (b = 0:
+ * 0 counts):
+ *   D1: b
+ *   D2-D4: samples in bucket b, saturates at 0xFFFFFF
+ *   D5-D7: samples in bucket b + 1, saturates at 0xFFFFFF
+ *
+ * Requests, ID 0x722, from a tester on either bus:
+ *   D0: 0xB0 + s for the dump of one stage, 0xBF for all of them
+ * The dump is sent on the bus the request came in on.
+ */
+
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <stdint.h>
+#include "can_types.h"
+#include "QueueStats.h"
+#include "LatencyStats.h"
+#include "RxFifoStats.h"
+#include "IdleStats.h"
+#include "CpuProfile.h"
+#include "LatencyHistogram.h"
+#include "LoopMonitor.h"
+#include "CanErrorMonitor.h"
+
+/**
+ * @class Diagnostics
+ * @brief Collects run-time statistics and formats them as 0x721 pages
+ *
+ * Sources are registered once at start-up; sources that are not
+ * registered (or compiled out) produce no pages.
+ */
+class Diagnostics {
+public:
+    static const uint16_t MESSAGE_ID = 0x721;
+    static const uint16_t REQUEST_ID = 0x722;
+
+    static const uint8_t PAGE_QUEUE_OCCUPANCY = 0x10;  ///< + queue index
+    static const uint8_t PAGE_QUEUE_TRAFFIC = 0x20;    ///< + queue index
+    static const uint8_t PAGE_LATENCY = 0x30;          ///< + channel index
+    static const uint8_t PAGE_RX_FIFO = 0x40;          ///< + 2 * channel index + FIFO
+    static const uint8_t PAGE_CUT_THROUGH = 0x50;      ///< + channel index
+    static const uint8_t PAGE_RX_INTERVAL = 0x60;
+    static const uint8_t PAGE_RX_LOSS = 0x70;          ///< + 2 * channel index + FIFO
+    static const uint8_t PAGE_MAIN_LOOP = 0x80;
+    static const uint8_t PAGE_SCHEDULER = 0x90;
+    static const uint8_t PAGE_CPU_LOAD = 0xA0;
+    static const uint8_t PAGE_CPU_SECTIONS = 0xA1;
+    static const uint8_t PAGE_HISTOGRAM = 0xB0;        ///< + forwarding stage
+    static const uint8_t REQUEST_ALL_HISTOGRAMS = 0xBF;
+    static const uint8_t HISTOGRAM_SUMMARY = 0xFF;     ///< Byte 1 of a histogram summary frame
+    static const uint8_t PAGE_STALL_PREVIOUS = 0xC0;
+    static const uint8_t PAGE_STALL_CURRENT = 0xC1;
+    static const uint8_t PAGE_BUS_STATE = 0xD0;        ///< + channel index
+    static const uint8_t PAGE_BUS_FRAME_ERRORS = 0xD2; ///< + channel index, stuff, form and ACK
+    static const uint8_t PAGE_BUS_BIT_ERRORS = 0xD4;   ///< + channel index, bit and CRC
+    static const uint8_t PAGE_BUS_TIME = 0xD6;         ///< + channel index
+
+    /**
+     * @brief Queues reported on the queue pages
+     */
+    enum QueueIndex {
+        QUEUE_RX = 0,           ///< RxQueue, passthrough frames from FIFO0
+        QUEUE_TX_CAN1 = 1,      ///< TxQueue lane for CAN1
+        QUEUE_TX_CAN2 = 2,      ///< TxQueue lane for CAN2
+        QUEUE_RX_PRIORITY = 3,  ///< RxQueue for the App handled IDs from FIFO1
+        QUEUE_COUNT = 4
+    };
+
+    /**
+     * @brief Forwarding stages with a latency histogram
+     */
+    enum HistogramStage {
+        HISTOGRAM_RX_TO_DISPATCH = 0,       ///< RX interrupt to the App being handed the frame
+        HISTOGRAM_DISPATCH_TO_ENQUEUE = 1,  ///< App handed the frame to its copy in the TxQueue
+        HISTOGRAM_ENQUEUE_TO_MAILBOX = 2,   ///< TxQueue to a TX mailbox
+        HISTOGRAM_COUNT = 3
+    };
+
+    Diagnostics();
+
+    /**
+     * @brief Register the statistics of a queue
+     * @param queue Queue the statistics belong to
+     * @param stats Statistics, or nullptr if the queue has none
+     */
+    void setQueueStats(QueueIndex queue, const QueueStats* stats);
+
+    /**
+     * @brief Register the forwarding latency of frames sent on a channel
+     * @param channel CAN channel index (0 for CAN1, 1 for CAN2)
+     * @param stats Latency in CycleCounter counts, or nullptr for none
+     */
+    void setLatencyStats(uint8_t channel, const LatencyStats* stats);
+
+    /**
+     * @brief Register the interrupt statistics of a receive FIFO
+     * @param channel CAN channel index (0 for CAN1, 1 for CAN2)
+     * @param fifo FIFO number (0 or 1)
+     * @param stats Statistics, or nullptr for none
+     */
+    void setRxFifoStats(uint8_t channel, uint8_t fifo, const RxFifoStats* stats);
+
+    /**
+     * @brief Register the cut-through count of frames received on a channel
+     * @param channel CAN channel index (0 for CAN1, 1 for CAN2)
+     * @param stats Statistics of the FIFO passthrough frames arrive in, or nullptr for none
+     */
+    void setCutThroughStats(uint8_t channel, const RxFifoStats* stats);
+
+    /**
+     * @brief Register the full and overrun counts of a receive FIFO
+     * @param channel CAN channel index (0 for CAN1, 1 for CAN2)
+     * @param fifo FIFO number (0 or 1)
+     * @param stats Statistics, or nullptr for none
+     */
+    void setRxLossStats(uint8_t channel, uint8_t fifo, const RxFifoStats* stats);
+
+    /**
+     * @brief Register the receive interval of 0x373
+     * @param stats Interval in CAN bit times, or nullptr for none
+     */
+    void setRxIntervalStats(const LatencyStats* stats);
+
+    /**
+     * @brief Register the main loop's idle fraction and wake latency
+     * @param idle Idle statistics, or nullptr for none
+     * @param wakeLatency Wait for the main loop in CycleCounter counts, may be nullptr
+     */
+    void setMainLoopStats(const IdleStats* idle, const LatencyStats* wakeLatency);
+
+    /**
+     * @brief Register the cost of advancing the App's timer wheel
+     * @param cost Cycles per advance in CycleCounter counts, or nullptr for none
+     */
+    void setSchedulerStats(const LatencyStats* cost);
+
+    /**
+     * @brief Register the CPU profile
+     * @param profile Profile, or nullptr for none
+     */
+    void setCpuProfile(const CpuProfile* profile);
+
+    /**
+     * @brief Register the latency histogram of a forwarding stage
+     * @param stage Stage the histogram measures
+     * @param histogram Latency in CycleCounter counts, or nullptr for none
+     */
+    void setLatencyHistogram(HistogramStage stage, const LatencyHistogram* histogram);
+
+    /**
+     * @brief Register the main loop stall monitor
+     * @param monitor Monitor, or nullptr for none
+     */
+    void setLoopMonitor(const LoopMonitor* monitor);
+
+    /**
+     * @brief Register the bus error monitor of a controller
+     * @param channel CAN channel index (0 for CAN1, 1 for CAN2)
+     * @param monitor Monitor, or nullptr for none
+     */
+    void setCanErrorMonitor(uint8_t channel, const CanErrorMonitor* monitor);
+
+    /**
+     * @brief Get the number of pages currently available
+     * @return Number of pages, build them with buildPage(0 .. count-1)
+     */
+    uint8_t pageCount() const;
+
+    /**
+     * @brief Build one 0x721 frame
+     * @param index Page index, less than pageCount()
+     * @param frame Frame to fill in; tx_channel is left unchanged
+     * @return true if the frame was built, false if index is out of range
+     */
+    bool buildPage(uint8_t index, CAN_FRAME* frame) const;
+
+    /**
+     * @brief Get the number of frames in the histogram dump of a stage
+     * @param stage Forwarding stage
+     * @return Number of frames, build them with buildHistogramFrame(stage, 0 .. count-1);
+     *         0 if the stage has no histogram
+     */
+    uint8_t histogramFrameCount(HistogramStage stage) const;
+
+    /**
+     * @brief Build one frame of the histogram dump of a stage
+     * @param stage Forwarding stage
+     * @param index Frame index, less than histogramFrameCount(stage)
+     * @param frame Frame to fill in; tx_channel is left unchanged
+     * @return true if the frame was built, false if index is out of range
+     */
+    bool buildHistogramFrame(HistogramStage stage, uint8_t index, CAN_FRAME* frame) const;
+
+private:
+    void buildQueueOccupancy(const QueueStats* stats, CAN_FRAME* frame) const;
+    void buildQueueTraffic(const QueueStats* stats, CAN_FRAME* frame) const;
+    void buildLatency(const LatencyStats* stats, CAN_FRAME* frame) const;
+    void buildRxFifo(const RxFifoStats* stats, CAN_FRAME* frame) const;
+    void buildCutThrough(const RxFifoStats* stats, CAN_FRAME* frame) const;
+    void buildRxInterval(const LatencyStats* stats, CAN_FRAME* frame) const;
+    void buildRxLoss(const RxFifoStats* stats, CAN_FRAME* frame) const;
+    void buildMainLoop(CAN_FRAME* frame) const;
+    void buildScheduler(CAN_FRAME* frame) const;
+    void buildCpuLoad(CAN_FRAME* frame) const;
+    void buildCpuSections(CAN_FRAME* frame) const;
+    void buildStallPrevious(CAN_FRAME* frame) const;
+    void buildStallCurrent(CAN_FRAME* frame) const;
+    void buildBusState(const CanErrorMonitor* monitor, CAN_FRAME* frame) const;
+    void buildBusErrors(const CanErrorMonitor* monitor, CanErrorMonitor::ErrorCode first, CAN_FRAME* frame) const;
+    void buildBusTime(const CanErrorMonitor* monitor, CAN_FRAME* frame) const;
+    void clearFrame(CAN_FRAME* frame) const;
+    bool histogramSpan(const LatencyHistogram* histogram, uint8_t* first, uint8_t* last) const;
+
+    const QueueStats* m_queueStats[QUEUE_COUNT]; ///< Registered queue statistics
+    const LatencyStats* m_latencyStats[CAN_CHANNEL_COUNT]; ///< Registered latency statistics
+    const RxFifoStats* m_rxFifoStats[CAN_CHANNEL_COUNT * CAN_RX_FIFO_COUNT]; ///< Registered RX FIFO statistics, by page offset
+    const RxFifoStats* m_cutThroughStats[CAN_CHANNEL_COUNT]; ///< Registered cut-through statistics
+    const LatencyStats* m_rxIntervalStats; ///< Registered receive interval statistics
+    const RxFifoStats* m_rxLossStats[CAN_CHANNEL_COUNT * CAN_RX_FIFO_COUNT]; ///< Registered RX FIFO loss statistics, by page offset
+    const IdleStats* m_idleStats; ///< Registered main loop idle statistics
+    const LatencyStats* m_wakeLatency; ///< Registered main loop wake latency
+    const LatencyStats* m_schedulerCost; ///< Registered timer wheel cost
+    const CpuProfile* m_cpuProfile; ///< Registered CPU profile
+    const LatencyHistogram* m_histograms[HISTOGRAM_COUNT]; ///< Registered latency histograms, by stage
+    const LoopMonitor* m_loopMonitor; ///< Registered main loop stall monitor
+    const CanErrorMonitor* m_canErrorMonitors[CAN_CHANNEL_COUNT]; ///< Registered bus error monitors
+};
+
+#endif // DIAGNOSTICS_H
@@ -0,0 +1,97 @@
+/**
+ * @file FrameTimestamp.h
+ * @brief Receive timestamps carried by CAN frames through the queues
+ *
+ * When built with CAN_FRAME_TIMESTAMPS, every received frame is stamped
+ * with CycleCounter::now() in the RX ISR. The stamp travels with the frame
+ * through the RxQueue, the App and the TxQueue, and the main loop measures
+ * the forwarding latency when the frame is handed to a TX mailbox.
+ * Frames the firmware creates itself carry no stamp.
+ *
+ * A second stamp marks where the frame entered its current forwarding
+ * stage: received, handed to the App, queued for transmission. Each stage
+ * boundary takes the time since the last one with FrameNextStage(), for
+ * the per-stage latency histograms.
+ *
+ * Without CAN_FRAME_TIMESTAMPS these functions compile to nothing and
+ * CAN_FRAME has no timestamp field.
+ */
+
+#ifndef FRAME_TIMESTAMP_H
+#define FRAME_TIMESTAMP_H
+
+#include <stdint.h>
+#include "can_types.h"
+#include "CycleCounter.h"
+
+/**
+ * @brief Stamp a frame with the current time (RX ISR)
+ *
+ * The lowest bit is forced on, so a valid stamp is never 0.
+ */
+inline void FrameStampReceived(CAN_FRAME* frame) {
+#ifdef CAN_FRAME_TIMESTAMPS
+    frame->timestamp = CycleCounter::now() | 1;
+    frame->stage_time = frame->timestamp;
+#else
+    (void)frame;
+#endif
+}
+
+/**
+ * @brief Mark a frame created by the firmware as having no stamp
+ */
+inline void FrameClearStamp(CAN_FRAME* frame) {
+#ifdef CAN_FRAME_TIMESTAMPS
+    frame->timestamp = 0;
+    frame->stage_time = 0;
+#else
+    (void)frame;
+#endif
+}
+
+/**
+ * @brief Get the time since a frame was stamped
+ * @param frame The frame
+ * @param cycles Set to the elapsed CycleCounter counts
+ * @return true if the frame has a stamp
+ */
+inline bool FrameLatency(const CAN_FRAME* frame, uint32_t* cycles) {
+#ifdef CAN_FRAME_TIMESTAMPS
+    if (frame->timestamp == 0) {
+        return false;
+    }
+
+    *cycles = CycleCounter::now() - frame->timestamp;
+    return true;
+#else
+    (void)frame;
+    (void)cycles;
+    return false;
+#endif
+}
+
+/**
+ * @brief Move a stamped frame on to its next forwarding stage
+ * @param frame The frame
+ * @param cycles Set to the CycleCounter counts spent in the stage it leaves
+ * @return true if the frame has a stamp
+ */
+inline bool FrameNextStage(CAN_FRAME* frame, uint32_t* cycles) {
+#ifdef CAN_FRAME_TIMESTAMPS
+    if (frame->timestamp == 0) {
+        return false;
+    }
+
+    uint32_t now = CycleCounter::now();
+    *cycles = now - frame->stage_time;
+    frame->stage_time = now;
+    return true;
+#else
+    (void)frame;
+    (void)cycles;
+    return false;
+#endif
+}
+
+#endif // FRAME_TIMESTAMP_H
@@ -0,0 +1,81 @@
+/**
+ * @file IdleStats.h
+ * @brief Fraction of time the main loop spends asleep
+ */
+
+#ifndef IDLE_STATS_H
+#define IDLE_STATS_H
+
+#include <stdint.h>
+#include "CycleCounter.h"
+
+/**
+ * @class IdleStats
+ * @brief Idle fraction over one second windows, from the time spent awake
+ *
+ * The DWT cycle counter stops while the core sleeps in WFI, so the time
+ * asleep cannot be read from it. Instead the main loop reports every awake
+ * span, from waking up to going back to sleep (interrupt handlers included),
+ * and the idle fraction is the rest of the window, timed by the HAL tick.
+ *
+ * Written and read by the main loop only.
+ */
+class IdleStats {
+public:
+    static const uint32_t WINDOW_MS = 1000;
+
+    IdleStats() :
+        busyCycles_(0),
+        windowStartMs_(0),
+        idlePermille_(0),
+        started_(false) {
+    }
+
+    /**
+     * @brief Add one span the core was awake
+     * @param cycles Length in CycleCounter counts
+     */
+    void addBusy(uint32_t cycles) {
+        busyCycles_ += cycles;
+    }
+
+    /**
+     * @brief Close the window once it is WINDOW_MS long
+     * @param nowMs Current HAL tick
+     */
+    void update(uint32_t nowMs) {
+        if (!started_) {
+            started_ = true;
+            windowStartMs_ = nowMs;
+            busyCycles_ = 0;
+            return;
+        }
+
+        uint32_t elapsedMs = nowMs - windowStartMs_;
+        if (elapsedMs < WINDOW_MS) {
+            return;
+        }
+
+        uint64_t windowCycles = (uint64_t)elapsedMs * (CycleCounter::frequencyHz() / 1000);
+        uint64_t busyPermille = busyCycles_ * 1000 / windowCycles;
+        idlePermille_ = (busyPermille >= 1000) ? 0 : (uint16_t)(1000 - busyPermille);
+        windowStartMs_ = nowMs;
+        busyCycles_ = 0;
+    }
+
+    /**
+     * @brief Get the idle fraction of the last complete window
+     * @return Time asleep in 1/1000 of the window, 0 before the first window
+     */
+    uint16_t idlePermille() const {
+        return idlePermille_;
+    }
+
+private:
+    uint64_t busyCycles_;       ///< Awake time in the current window
+    uint32_t windowStartMs_;    ///< HAL tick the current window started at
+    uint16_t idlePermille_;     ///< Result of the last complete window
+    bool started_;              ///< The first window has started
+};
+
+#endif // IDLE_STATS_H
@@ -0,0 +1,113 @@
+/**
+ * @file LatencyHistogram.h
+ * @brief Log2 bucket histogram of a latency, for its tail percentiles
+ */
+
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stdint.h>
+
+/**
+ * @class LatencyHistogram
+ * @brief Counts latency samples in power of two buckets
+ *
+ * Bucket 0 counts samples of 0, bucket b counts samples from 2^(b-1) to
+ * 2^b - 1, so 33 buckets cover every uint32_t. Recording a sample is a
+ * count-leading-zeros and an increment (CLZ on the Cortex-M3), the same
+ * few cycles for any value, so it can be done for every frame on the
+ * forwarding path.
+ *
+ * Written from one context at a time, like LatencyStats. Read by the main
+ * loop for reporting; a report that a writer preempts may be one sample out.
+ */
+class LatencyHistogram {
+public:
+    static const uint8_t BUCKET_COUNT = 33;
+
+    LatencyHistogram() {
+        reset();
+    }
+
+    /**
+     * @brief Add one sample
+     * @param cycles Latency in CycleCounter counts
+     */
+    void record(uint32_t cycles) {
+        buckets_[bucketOf(cycles)]++;
+    }
+
+    /**
+     * @brief Discard all samples
+     */
+    void reset() {
+        for (uint8_t i = 0; i < BUCKET_COUNT; i++) {
+            buckets_[i] = 0;
+        }
+    }
+
+    /**
+     * @brief Get the number of samples in a bucket
+     * @param bucket Bucket index, less than BUCKET_COUNT
+     */
+    uint32_t bucket(uint8_t bucket) const {
+        return buckets_[bucket];
+    }
+
+    /**
+     * @brief Get the number of samples
+     */
+    uint32_t count() const {
+        uint32_t total = 0;
+        for (uint8_t i = 0; i < BUCKET_COUNT; i++) {
+            total += buckets_[i];
+        }
+        return total;
+    }
+
+    /**
+     * @brief Get the bucket a sample is counted in
+     * @param cycles Sample
+     * @return 0 for 0, else the number of significant bits
+     */
+    static uint8_t bucketOf(uint32_t cycles) {
+        return (cycles == 0) ? 0 : (uint8_t)(32 - __builtin_clz(cycles));
+    }
+
+    /**
+     * @brief Get the largest sample a bucket counts
+     * @param bucket Bucket index, less than BUCKET_COUNT
+     */
+    static uint32_t bucketUpperBound(uint8_t bucket) {
+        return (bucket >= 32) ? 0xFFFFFFFFUL : (1UL << bucket) - 1;
+    }
+
+    /**
+     * @brief Get an upper bound of a percentile (main loop)
+     * @param perMille Fraction of samples at or below the result, in 1/1000
+     *        (990 for p99, 999 for p99.9)
+     * @return Upper bound of the bucket holding that percentile, 0 if there are no samples
+     */
+    uint32_t percentile(uint16_t perMille) const {
+        uint32_t total = count();
+        if (total == 0) {
+            return 0;
+        }
+
+        // Smallest rank that covers perMille of the samples, rounded up
+        uint64_t rank = ((uint64_t)total * perMille + 999) / 1000;
+        uint32_t seen = 0;
+        for (uint8_t i = 0; i < BUCKET_COUNT; i++) {
+            seen += buckets_[i];
+            if (seen >= rank && seen > 0) {
+                return bucketUpperBound(i);
+            }
+        }
+        return bucketUpperBound(BUCKET_COUNT - 1);
+    }
+
+private:
+    uint32_t buckets_[BUCKET_COUNT];  ///< Samples per bucket, wrap at 2^32
+};
+
+#endif // LATENCY_HISTOGRAM_H
@@ -0,0 +1,86 @@
+/**
+ * @file LatencyStats.h
+ * @brief Running minimum, mean and maximum of a latency measurement
+ */
+
+#ifndef LATENCY_STATS_H
+#define LATENCY_STATS_H
+
+#include <stdint.h>
+
+/**
+ * @class LatencyStats
+ * @brief Accumulates latency samples in CycleCounter counts
+ *
+ * Written from one context at a time: the TX mailbox empty interrupt, or
+ * the main loop with that interrupt masked. Read by the main loop for
+ * reporting; a report that the interrupt preempts may show a mean from
+ * before and after one sample.
+ */
+class LatencyStats {
+public:
+    LatencyStats() {
+        reset();
+    }
+
+    /**
+     * @brief Add one sample
+     * @param cycles Latency in CycleCounter counts
+     */
+    void record(uint32_t cycles) {
+        if (count_ == 0 || cycles < min_) {
+            min_ = cycles;
+        }
+        if (cycles > max_) {
+            max_ = cycles;
+        }
+        sum_ += cycles;
+        count_++;
+    }
+
+    /**
+     * @brief Discard all samples
+     */
+    void reset() {
+        count_ = 0;
+        min_ = 0;
+        max_ = 0;
+        sum_ = 0;
+    }
+
+    /**
+     * @brief Get the number of samples
+     */
+    uint32_t count() const {
+        return count_;
+    }
+
+    /**
+     * @brief Get the smallest sample, 0 if there are none
+     */
+    uint32_t min() const {
+        return min_;
+    }
+
+    /**
+     * @brief Get the largest sample, 0 if there are none
+     */
+    uint32_t max() const {
+        return max_;
+    }
+
+    /**
+     * @brief Get the mean of all samples, 0 if there are none
+     */
+    uint32_t mean() const {
+        return (count_ > 0) ? (uint32_t)(sum_ / count_) : 0;
+    }
+
+private:
+    uint32_t count_;  ///< Number of samples
+    uint32_t min_;    ///< Smallest sample
+    uint32_t max_;    ///< Largest sample
+    uint64_t sum_;    ///< Sum of all samples, for the mean
+};
+
+#endif // LATENCY_STATS_H
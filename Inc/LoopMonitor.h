@@ -0,0 +1,272 @@
+/**
+ * @file LoopMonitor.h
+ * @brief Main loop stall detection, feeding the independent watchdog
+ */
+
+#ifndef LOOP_MONITOR_H
+#define LOOP_MONITOR_H
+
+#include <stdint.h>
+#include "CycleCounter.h"
+
+/**
+ * @class LoopMonitor
+ * @brief Times the main loop's work against a budget and decides when the watchdog may be fed
+ *
+ * Each work item (stage) is bracketed by beginStage() and endStage(). A
+ * pass longer than STAGE_BUDGET_MS is an overrun: it is counted, the worst
+ * one is kept, and the current check interval becomes unhealthy. So does
+ * work that has waited longer than the budget for its stage to pick it up
+ * (stageWaiting()). feedDue() allows one watchdog refresh per healthy
+ * CHECK_INTERVAL_MS, so a hung stage, or one that keeps overrunning for
+ * the whole watchdog timeout, resets the device.
+ *
+ * The stage being run and the worst overrun are mirrored in a Record the
+ * caller keeps in RAM that start-up code does not clear, so after a reset
+ * start() can tell which stage was running, and what the worst stall
+ * before it was.
+ *
+ * Stages may run in the main loop or in PendSV, one context per stage.
+ * feedDue() is called with PendSV masked in builds that use it.
+ */
+class LoopMonitor {
+public:
+    /**
+     * @brief Monitored work
+     */
+    enum Stage {
+        STAGE_RX = 0,       ///< ProcessCanRx()
+        STAGE_TX = 1,       ///< ProcessCanTx()
+        STAGE_TICK = 2,     ///< ProcessTick()
+        STAGE_COUNT = 3,
+        STAGE_NONE = 0xFF   ///< Between stages, or no stage recorded
+    };
+
+    static const uint32_t STAGE_BUDGET_MS = 5;      ///< Longest healthy pass through one stage
+    static const uint32_t CHECK_INTERVAL_MS = 100;  ///< Time between watchdog refreshes, well inside its timeout
+
+    /**
+     * @brief Kept across resets, in RAM left alone by the start-up code
+     */
+    struct Record {
+        uint32_t magic;         ///< RECORD_MAGIC once written
+        uint8_t activeStage;    ///< Stage running, STAGE_NONE between stages
+        uint8_t worstStage;     ///< Stage of the worst overrun, STAGE_NONE if none
+        uint16_t reserved;
+        uint32_t worstCycles;   ///< Length of the worst overrun (CycleCounter counts)
+        uint32_t check;         ///< Check value of the fields above
+    };
+
+    /**
+     * @brief What the Record held at start-up
+     */
+    struct Previous {
+        bool valid;             ///< The Record survived a reset, the rest is meaningful
+        bool watchdogReset;     ///< The reset was caused by the watchdog
+        uint8_t activeStage;    ///< Stage running at the reset, STAGE_NONE if none or not valid
+        uint8_t worstStage;     ///< Stage of the worst overrun, STAGE_NONE if none
+        uint32_t worstCycles;   ///< Length of that overrun (CycleCounter counts)
+    };
+
+    static const uint32_t RECORD_MAGIC = 0x4C4F4F50UL;  // "LOOP"
+
+    LoopMonitor() :
+        record_(&ownRecord_),
+        budgetCycles_(0xFFFFFFFFUL),
+        lastCheckMs_(0),
+        unhealthy_(false),
+        missedFeeds_(0),
+        maxIteration_(0) {
+        previous_.valid = false;
+        previous_.watchdogReset = false;
+        previous_.activeStage = STAGE_NONE;
+        previous_.worstStage = STAGE_NONE;
+        previous_.worstCycles = 0;
+        for (uint8_t i = 0; i < STAGE_COUNT; i++) {
+            maxStage_[i] = 0;
+            overruns_[i] = 0;
+        }
+        clear(&ownRecord_);
+    }
+
+    /**
+     * @brief Take over the kept Record, once at start-up after the clock is set
+     * @param record Record in RAM that is not cleared at reset
+     * @param watchdogReset The reset was caused by the watchdog
+     * @param nowMs Current HAL tick
+     */
+    void start(Record* record, bool watchdogReset, uint32_t nowMs) {
+        previous_.valid = (record->magic == RECORD_MAGIC) && (record->check == checkOf(*record));
+        previous_.watchdogReset = watchdogReset;
+        if (previous_.valid) {
+            previous_.activeStage = record->activeStage;
+            previous_.worstStage = record->worstStage;
+            previous_.worstCycles = record->worstCycles;
+        }
+
+        record_ = record;
+        clear(record_);
+        budgetCycles_ = STAGE_BUDGET_MS * (CycleCounter::frequencyHz() / 1000);
+        lastCheckMs_ = nowMs;
+    }
+
+    /**
+     * @brief Note that a stage starts
+     */
+    void beginStage(Stage stage) {
+        record_->activeStage = stage;
+        seal();
+    }
+
+    /**
+     * @brief Note that a stage is done
+     * @param stage Stage that ran
+     * @param cycles Its running time in CycleCounter counts
+     */
+    void endStage(Stage stage, uint32_t cycles) {
+        record_->activeStage = STAGE_NONE;
+        if (cycles > maxStage_[stage]) {
+            maxStage_[stage] = cycles;
+        }
+        if (cycles > budgetCycles_) {
+            overruns_[stage]++;
+            unhealthy_ = true;
+            if (record_->worstStage == STAGE_NONE || cycles > record_->worstCycles) {
+                record_->worstStage = stage;
+                record_->worstCycles = cycles;
+            }
+        }
+        seal();
+    }
+
+    /**
+     * @brief Report how long work has been waiting for its stage (main loop)
+     * @param stage Stage the work is for
+     * @param cycles Wait in CycleCounter counts
+     */
+    void stageWaiting(Stage stage, uint32_t cycles) {
+        (void)stage;
+        if (cycles > budgetCycles_) {
+            unhealthy_ = true;
+        }
+    }
+
+    /**
+     * @brief Note the length of one main loop iteration (main loop)
+     * @param cycles Length in CycleCounter counts
+     */
+    void iterationDone(uint32_t cycles) {
+        if (cycles > maxIteration_) {
+            maxIteration_ = cycles;
+        }
+    }
+
+    /**
+     * @brief Close the check interval once it is CHECK_INTERVAL_MS long (main loop)
+     * @param nowMs Current HAL tick
+     * @return true if the watchdog should be refreshed now
+     */
+    bool feedDue(uint32_t nowMs) {
+        if (nowMs - lastCheckMs_ < CHECK_INTERVAL_MS) {
+            return false;
+        }
+        lastCheckMs_ = nowMs;
+
+        bool healthy = !unhealthy_;
+        unhealthy_ = false;
+        if (!healthy) {
+            missedFeeds_++;
+        }
+        return healthy;
+    }
+
+    /**
+     * @brief Get what the kept Record held at start-up
+     */
+    const Previous& previous() const {
+        return previous_;
+    }
+
+    /**
+     * @brief Get the stage of the worst overrun since start-up, STAGE_NONE if none
+     */
+    uint8_t worstStage() const {
+        return record_->worstStage;
+    }
+
+    /**
+     * @brief Get the length of the worst overrun since start-up, in CycleCounter counts
+     */
+    uint32_t worstCycles() const {
+        return record_->worstCycles;
+    }
+
+    /**
+     * @brief Get the longest pass through a stage, in CycleCounter counts
+     */
+    uint32_t maxStageCycles(Stage stage) const {
+        return maxStage_[stage];
+    }
+
+    /**
+     * @brief Get the number of passes through a stage over budget
+     */
+    uint32_t overruns(Stage stage) const {
+        return overruns_[stage];
+    }
+
+    /**
+     * @brief Get the longest main loop iteration, in CycleCounter counts
+     */
+    uint32_t maxIterationCycles() const {
+        return maxIteration_;
+    }
+
+    /**
+     * @brief Get the number of check intervals that withheld the watchdog refresh
+     */
+    uint32_t missedFeeds() const {
+        return missedFeeds_;
+    }
+
+private:
+    /**
+     * @brief Get the check value of a Record
+     */
+    static uint32_t checkOf(const Record& record) {
+        uint32_t stages = ((uint32_t)record.activeStage << 8) | record.worstStage;
+        return ~(record.magic ^ stages ^ record.worstCycles);
+    }
+
+    /**
+     * @brief Start a Record afresh
+     */
+    static void clear(Record* record) {
+        record->magic = RECORD_MAGIC;
+        record->activeStage = STAGE_NONE;
+        record->worstStage = STAGE_NONE;
+        record->reserved = 0;
+        record->worstCycles = 0;
+        record->check = checkOf(*record);
+    }
+
+    /**
+     * @brief Update the check value after changing the Record
+     */
+    void seal() {
+        record_->check = checkOf(*record_);
+    }
+
+    Record ownRecord_;              ///< Used until start(), so the stage calls are always safe
+    Record* record_;                ///< Kept Record
+    Previous previous_;             ///< Kept Record as found at start-up
+    uint32_t budgetCycles_;         ///< STAGE_BUDGET_MS in CycleCounter counts
+    uint32_t lastCheckMs_;          ///< HAL tick the current check interval started at
+    volatile bool unhealthy_;       ///< An overrun or a long wait in the current check interval
+    uint32_t missedFeeds_;          ///< Check intervals that were unhealthy
+    uint32_t maxIteration_;         ///< Longest main loop iteration
+    uint32_t maxStage_[STAGE_COUNT];    ///< Longest pass per stage
+    uint32_t overruns_[STAGE_COUNT];    ///< Passes over budget per stage
+};
+
+#endif // LOOP_MONITOR_H
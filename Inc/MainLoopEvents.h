@@ -0,0 +1,131 @@
+/**
+ * @file MainLoopEvents.h
+ * @brief Pending-work flags set by interrupts, for the event-driven main loop
+ */
+
+#ifndef MAIN_LOOP_EVENTS_H
+#define MAIN_LOOP_EVENTS_H
+
+#include <stdint.h>
+#include "CycleCounter.h"
+
+/**
+ * @class MainLoopEvents
+ * @brief Tells the main loop which work an interrupt has left for it
+ *
+ * Each event has its own flag byte, set with a single store, so interrupts
+ * of different priorities can signal without a read-modify-write race. The
+ * main loop sleeps while no flag is set, and take()s a flag before doing
+ * the work, so an event signalled during the work runs it again on the
+ * next pass instead of being lost.
+ *
+ * The time of the first signal of each pending event is kept, to measure
+ * how long work waited for the main loop (see waitedSince()).
+ */
+class MainLoopEvents {
+public:
+    /**
+     * @brief Work an interrupt can leave for the main loop
+     */
+    enum Event {
+        EVENT_CAN_RX = 0,   ///< Frames committed to an RxQueue
+        EVENT_CAN_TX = 1,   ///< TX mailboxes freed, the TX stage can take more frames
+        EVENT_TICK = 2,     ///< SysTick advanced the HAL tick
+        EVENT_COUNT = 3
+    };
+
+    MainLoopEvents() {
+        for (uint8_t i = 0; i < EVENT_COUNT; i++) {
+            pending_[i] = 0;
+            signalled_[i] = 0;
+        }
+    }
+
+    /**
+     * @brief Leave work for the main loop (ISR)
+     * @param event Kind of work
+     */
+    void signal(Event event) {
+        if (!pending_[event]) {
+            signalled_[event] = CycleCounter::now();
+            pending_[event] = 1;
+        }
+    }
+
+    /**
+     * @brief Clear an event before doing its work (main loop)
+     * @param event Kind of work
+     * @return true if the event was pending
+     */
+    bool take(Event event) {
+        if (!pending_[event]) {
+            return false;
+        }
+        pending_[event] = 0;
+        compilerBarrier();
+        return true;
+    }
+
+    /**
+     * @brief Check for work, with interrupts disabled before sleeping (main loop)
+     * @return true if any event is pending
+     */
+    bool anyPending() const {
+        for (uint8_t i = 0; i < EVENT_COUNT; i++) {
+            if (pending_[i]) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Get how long the oldest pending event has waited (main loop)
+     * @param now Current CycleCounter::now()
+     * @param waited Filled in with the wait in CycleCounter counts, 0 if none
+     * @return false if no event is pending
+     */
+    bool waitedSince(uint32_t now, uint32_t* waited) const {
+        bool any = false;
+        *waited = 0;
+        for (uint8_t i = 0; i < EVENT_COUNT; i++) {
+            if (pending_[i]) {
+                uint32_t age = now - signalled_[i];
+                if (age > *waited) {
+                    *waited = age;
+                }
+                any = true;
+            }
+        }
+        return any;
+    }
+
+    /**
+     * @brief Get how long one pending event has waited
+     * @param event Kind of work
+     * @param now Current CycleCounter::now()
+     * @param waited Filled in with the wait in CycleCounter counts, 0 if none
+     * @return false if the event is not pending
+     */
+    bool waitedSince(Event event, uint32_t now, uint32_t* waited) const {
+        *waited = 0;
+        if (!pending_[event]) {
+            return false;
+        }
+        *waited = now - signalled_[event];
+        return true;
+    }
+
+private:
+    /**
+     * @brief Keep the compiler from moving the work ahead of clearing its flag
+     */
+    static void compilerBarrier() {
+        __asm volatile ("" ::: "memory");
+    }
+
+    volatile uint8_t pending_[EVENT_COUNT];      ///< Non-zero while the work is outstanding
+    volatile uint32_t signalled_[EVENT_COUNT];   ///< CycleCounter::now() at the first signal
+};
+
+#endif // MAIN_LOOP_EVENTS_H
@@ -0,0 +1,139 @@
+/**
+ * @file QueueStats.h
+ * @brief Occupancy and overflow statistics policies for the CAN queues
+ *
+ * The queues take a STATS template parameter and call it on every push and
+ * on every frame they have to turn away. QueueStats records the counters,
+ * NoQueueStats has the same interface with empty inline bodies, so
+ * statistics compile out completely where they are not wanted.
+ */
+
+#ifndef QUEUE_STATS_H
+#define QUEUE_STATS_H
+
+#include <stdint.h>
+#include "can_types.h"
+
+/**
+ * @class NoQueueStats
+ * @brief Statistics policy that records nothing
+ */
+class NoQueueStats {
+public:
+    void onPush(uint16_t) {}
+    void onDrop() {}
+    void sample(uint16_t, uint32_t) {}
+};
+
+/**
+ * @class QueueStats
+ * @brief Statistics policy that records queue occupancy and overflow
+ *
+ * onPush() and onDrop() are called by the queue in the producer's context,
+ * which may be an ISR, and only do a compare and a couple of increments.
+ * sample() is called from the main loop with the time elapsed since the
+ * last call, and accumulates the time the queue spent at or above
+ * QUEUE_STATS_DEPTH_THRESHOLD. Each counter has a single writer, so the
+ * counters can be read from the main loop at any time.
+ */
+class QueueStats {
+public:
+    QueueStats() :
+        highWater_(0),
+        depth_(0),
+        pushes_(0),
+        drops_(0),
+        msAboveThreshold_(0) {
+    }
+
+    /**
+     * @brief Record a frame added to the queue (producer)
+     * @param depth Number of frames in the queue after the push
+     */
+    void onPush(uint16_t depth) {
+        pushes_++;
+        if (depth > highWater_) {
+            highWater_ = depth;
+        }
+    }
+
+    /**
+     * @brief Record a frame lost because the queue was full (producer)
+     */
+    void onDrop() {
+        drops_++;
+    }
+
+    /**
+     * @brief Sample the queue depth (main loop)
+     * @param depth Number of frames in the queue now
+     * @param elapsedMs Time since the previous sample in milliseconds
+     */
+    void sample(uint16_t depth, uint32_t elapsedMs) {
+        depth_ = depth;
+        if (depth >= QUEUE_STATS_DEPTH_THRESHOLD) {
+            msAboveThreshold_ += elapsedMs;
+        }
+    }
+
+    /**
+     * @brief Get the deepest the queue has ever been
+     * @return High-water mark in frames
+     */
+    uint16_t highWater() const {
+        return highWater_;
+    }
+
+    /**
+     * @brief Get the queue depth at the last sample()
+     * @return Depth in frames
+     */
+    uint16_t depth() const {
+        return depth_;
+    }
+
+    /**
+     * @brief Get the number of frames added to the queue
+     * @return Total pushes, wraps at 2^32
+     */
+    uint32_t pushes() const {
+        return pushes_;
+    }
+
+    /**
+     * @brief Get the number of frames lost to a full queue
+     * @return Total drops, wraps at 2^32
+     */
+    uint32_t drops() const {
+        return drops_;
+    }
+
+    /**
+     * @brief Get the sampled time spent at or above the depth threshold
+     * @return Time in milliseconds
+     */
+    uint32_t msAboveThreshold() const {
+        return msAboveThreshold_;
+    }
+
+private:
+    volatile uint16_t highWater_;           ///< Deepest queue seen, producer owned
+    uint16_t depth_;                        ///< Depth at last sample, main loop owned
+    volatile uint32_t pushes_;              ///< Frames added, producer owned
+    volatile uint32_t drops_;               ///< Frames lost, producer owned
+    uint32_t msAboveThreshold_;             ///< Time above threshold, main loop owned
+};
+
+/**
+ * @brief Get a queue's statistics for reporting
+ * @return Pointer to the statistics, or nullptr if they are compiled out
+ */
+inline const QueueStats* queueStatsOf(const QueueStats& stats) {
+    return &stats;
+}
+
+inline const QueueStats* queueStatsOf(const NoQueueStats&) {
+    return nullptr;
+}
+
+#endif // QUEUE_STATS_H
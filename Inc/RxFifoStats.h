@@ -0,0 +1,171 @@
+/**
+ * @file RxFifoStats.h
+ * @brief Per interrupt statistics of a bxCAN receive FIFO
+ */
+
+#ifndef RX_FIFO_STATS_H
+#define RX_FIFO_STATS_H
+
+#include <stdint.h>
+
+/**
+ * @class RxFifoStats
+ * @brief Counts RX interrupts and the frames each one moved to the RxQueue
+ *
+ * The RX interrupt handler drains every message pending in its FIFO before
+ * returning, and reports the number it read through onIrq(). The ratio of
+ * frames to interrupts shows how often bursts are serviced in one entry.
+ * In CAN_CUT_THROUGH builds it also counts the frames the handler loaded
+ * straight into a TX mailbox instead of the RxQueue.
+ *
+ * The handler also reports the FIFO's full and overrun flags. An overrun
+ * means at least one frame was lost in hardware: the flag is set by the
+ * first message that finds all three mailboxes in use and stays set for
+ * the ones after it, so the overrun count is a lower bound on the loss.
+ * The RxQueue depth seen at the last few overruns is kept, to tell a main
+ * loop that fell behind (a deep queue) from an interrupt that was held
+ * off (a shallow one).
+ *
+ * Written only by the interrupt handler of one FIFO, so counters of
+ * different FIFOs must not be shared. They can be read from the main loop
+ * at any time.
+ */
+class RxFifoStats {
+public:
+    static const uint8_t OVERRUN_HISTORY = 3;  ///< Overruns kept for post-mortem
+
+    /**
+     * @brief State at one overrun
+     */
+    struct Overrun {
+        uint32_t timeMs;      ///< HAL tick when the overrun was seen
+        uint16_t queueDepth;  ///< RxQueue depth when the overrun was seen (frames)
+    };
+
+    RxFifoStats() :
+        irqs_(0),
+        frames_(0),
+        cutThroughs_(0),
+        overruns_(0),
+        fulls_(0),
+        maxFramesPerIrq_(0) {
+        for (uint8_t i = 0; i < OVERRUN_HISTORY; i++) {
+            history_[i].timeMs = 0;
+            history_[i].queueDepth = 0;
+        }
+    }
+
+    /**
+     * @brief Record one interrupt (ISR)
+     * @param frames Number of messages read from the FIFO by this interrupt
+     */
+    void onIrq(uint8_t frames) {
+        irqs_++;
+        frames_ += frames;
+        if (frames > maxFramesPerIrq_) {
+            maxFramesPerIrq_ = frames;
+        }
+    }
+
+    /**
+     * @brief Record a frame sent straight to a TX mailbox by cut-through (ISR)
+     */
+    void onCutThrough() {
+        cutThroughs_++;
+    }
+
+    /**
+     * @brief Record the FIFO overrun flag (ISR)
+     * @param queueDepth Depth of the FIFO's RxQueue (frames)
+     * @param timeMs Current time (ms)
+     */
+    void onOverrun(uint16_t queueDepth, uint32_t timeMs) {
+        uint8_t slot = overruns_ % OVERRUN_HISTORY;
+        history_[slot].timeMs = timeMs;
+        history_[slot].queueDepth = queueDepth;
+        overruns_++;
+    }
+
+    /**
+     * @brief Record the FIFO full flag, all three mailboxes in use (ISR)
+     */
+    void onFull() {
+        fulls_++;
+    }
+
+    /**
+     * @brief Get the number of interrupts handled
+     * @return Total interrupts, wraps at 2^32
+     */
+    uint32_t irqs() const {
+        return irqs_;
+    }
+
+    /**
+     * @brief Get the number of messages read from the FIFO
+     * @return Total frames, wraps at 2^32
+     */
+    uint32_t frames() const {
+        return frames_;
+    }
+
+    /**
+     * @brief Get the number of frames forwarded by cut-through
+     * @return Frames that bypassed the queues, wraps at 2^32
+     */
+    uint32_t cutThroughs() const {
+        return cutThroughs_;
+    }
+
+    /**
+     * @brief Get the number of overruns, each losing one or more frames
+     * @return Total overruns, wraps at 2^32
+     */
+    uint32_t overruns() const {
+        return overruns_;
+    }
+
+    /**
+     * @brief Get the number of times the FIFO was found full
+     * @return Total full events, wraps at 2^32
+     */
+    uint32_t fulls() const {
+        return fulls_;
+    }
+
+    /**
+     * @brief Get the state at a recent overrun
+     * @param age 0 for the most recent overrun, up to OVERRUN_HISTORY - 1
+     * @param overrun Filled in with the state at that overrun
+     * @return false if there were not that many overruns
+     */
+    bool recentOverrun(uint8_t age, Overrun* overrun) const {
+        uint32_t count = overruns_;
+        if (age >= OVERRUN_HISTORY || age >= count) {
+            return false;
+        }
+        uint8_t slot = (count - 1 - age) % OVERRUN_HISTORY;
+        overrun->timeMs = history_[slot].timeMs;
+        overrun->queueDepth = history_[slot].queueDepth;
+        return true;
+    }
+
+    /**
+     * @brief Get the most messages read by a single interrupt
+     * @return Frames per interrupt
+     */
+    uint8_t maxFramesPerIrq() const {
+        return maxFramesPerIrq_;
+    }
+
+private:
+    volatile uint32_t irqs_;            ///< Interrupts handled
+    volatile uint32_t frames_;          ///< Messages read
+    volatile uint32_t cutThroughs_;     ///< Messages forwarded by cut-through
+    volatile uint32_t overruns_;        ///< Overrun flags seen
+    volatile uint32_t fulls_;           ///< Full flags seen
+    volatile Overrun history_[OVERRUN_HISTORY]; ///< Last overruns, indexed by count modulo OVERRUN_HISTORY
+    volatile uint8_t maxFramesPerIrq_;  ///< Largest single drain
+};
+
+#endif // RX_FIFO_STATS_H
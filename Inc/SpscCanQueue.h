@@ -0,0 +1,333 @@
+/**
+ * @file SpscCanQueue.h
+ * @brief Lock-free single-producer/single-consumer queue for CAN_FRAME items
+ *
+ * A circular buffer that can be shared between one interrupt handler
+ * (the producer) and the main loop (the consumer) without disabling
+ * interrupts. The producer only ever writes head_, the consumer only
+ * ever writes tail_, so there is no shared counter to protect.
+ */
+
+#ifndef SPSC_CAN_QUEUE_H
+#define SPSC_CAN_QUEUE_H
+
+#include <stdint.h>
+#include "can_types.h"
+#include "QueueStats.h"
+
+/**
+ * @class SpscCanQueue
+ * @brief Fixed-size lock-free circular queue for CAN frames
+ *
+ * Provides the same interface as CanQueue, with these rules:
+ * - push(), reserve() and commit() may only be called from a single producer
+ *   context (e.g. the CAN RX ISR)
+ * - pop(), popMany(), peek(), front(), frontSpan(), release() and clear() may
+ *   only be called from a single consumer context
+ * - isEmpty(), isFull(), length() and available() may be called from either
+ *   side, but are only a snapshot when the other side is active
+ *
+ * A full queue always rejects the new frame (CAN_QUEUE_DROP_NEWEST): dropping
+ * the oldest or coalescing would need the producer to touch frames the
+ * consumer owns.
+ *
+ * One extra slot is allocated so that head_ == tail_ always means empty and
+ * the full capacity of CAPACITY frames is usable.
+ *
+ * Memory barriers order the slot contents against the index that publishes
+ * them. On the single-core Cortex-M3 a DMB is sufficient (and is what ARM
+ * recommends for this pattern); on the host a full fence is used so the
+ * same code can be stress tested with real threads.
+ *
+ * Statistics are updated by the producer (pushes, drops, high-water mark)
+ * and by sampleStats() on the consumer side, so each counter keeps a
+ * single writer.
+ *
+ * @tparam CAPACITY Maximum number of CAN frames the queue can hold
+ * @tparam STATS Statistics policy, QueueStats or NoQueueStats (default)
+ */
+template<uint16_t CAPACITY, class STATS = NoQueueStats>
+class SpscCanQueue {
+public:
+    /**
+     * @brief Default constructor
+     * Initializes an empty queue
+     */
+    SpscCanQueue() : head_(0), tail_(0) {
+    }
+
+    /**
+     * @brief Push a CAN frame onto the queue (producer only)
+     * @param frame The CAN frame to add
+     * @return true if successful, false if queue is full
+     */
+    bool push(const CAN_FRAME& frame) {
+        uint16_t head = head_;
+        uint16_t tail = tail_;
+        uint16_t next = advance(head);
+        if (next == tail) {
+            stats_.onDrop();
+            return false;
+        }
+
+        buffer_[head] = frame;
+        // Slot contents must be complete before the consumer can see them
+        memoryBarrier();
+        head_ = next;
+        stats_.onPush(distance(tail, next));
+        return true;
+    }
+
+    /**
+     * @brief Pop a CAN frame from the queue (consumer only)
+     * @param frame Pointer to store the popped frame
+     * @return true if successful, false if queue is empty
+     */
+    bool pop(CAN_FRAME* frame) {
+        uint16_t tail = tail_;
+        if (tail == head_) {
+            return false;
+        }
+
+        // Do not read the slot before observing the head_ that published it
+        memoryBarrier();
+        if (frame != nullptr) {
+            *frame = buffer_[tail];
+        }
+        // Finish reading the slot before handing it back to the producer
+        memoryBarrier();
+        tail_ = advance(tail);
+        return true;
+    }
+
+    /**
+     * @brief Peek at the front element without removing it (consumer only)
+     * @param frame Pointer to store the peeked frame
+     * @return true if successful, false if queue is empty
+     */
+    bool peek(CAN_FRAME* frame) const {
+        uint16_t tail = tail_;
+        if (tail == head_) {
+            return false;
+        }
+
+        memoryBarrier();
+        if (frame != nullptr) {
+            *frame = buffer_[tail];
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Reserve the next free slot so a frame can be written in place (producer only)
+     * @return Pointer to the slot, or nullptr if queue is full
+     *
+     * The consumer cannot see the slot until commit() is called. A
+     * reservation that is never committed is simply abandoned. A reserve()
+     * that fails on a full queue is counted as a dropped frame.
+     */
+    CAN_FRAME* reserve() {
+        uint16_t head = head_;
+        if (advance(head) == tail_) {
+            stats_.onDrop();
+            return nullptr;
+        }
+
+        return &buffer_[head];
+    }
+
+    /**
+     * @brief Publish the slot returned by the last reserve() (producer only)
+     *
+     * Must only be called after reserve() returned a non-null slot.
+     */
+    void commit() {
+        uint16_t next = advance(head_);
+        // Slot contents must be complete before the consumer can see them
+        memoryBarrier();
+        head_ = next;
+        stats_.onPush(distance(tail_, next));
+    }
+
+    /**
+     * @brief Access the front element in place, without copying it (consumer only)
+     * @return Pointer to the front frame, or nullptr if queue is empty
+     *
+     * The producer will not reuse the slot until release() is called, so
+     * the frame may be read, or modified, in place until then.
+     */
+    CAN_FRAME* front() {
+        uint16_t tail = tail_;
+        if (tail == head_) {
+            return nullptr;
+        }
+
+        memoryBarrier();
+        return &buffer_[tail];
+    }
+
+    /**
+     * @brief Access the frames at the front of the queue in place, as one contiguous span (consumer only)
+     * @param frames Set to the first frame of the span, or nullptr if queue is empty
+     * @return Number of frames in the span
+     *
+     * The span stops at the end of the circular buffer, so a queue that has
+     * wrapped around is returned as two spans by consecutive calls. Frames
+     * the producer adds after this call are picked up by the next call.
+     */
+    uint16_t frontSpan(CAN_FRAME** frames) {
+        uint16_t head = head_;
+        uint16_t tail = tail_;
+        uint16_t count = (head >= tail) ? (head - tail) : (SLOTS - tail);
+
+        memoryBarrier();
+        *frames = (count > 0) ? &buffer_[tail] : nullptr;
+        return count;
+    }
+
+    /**
+     * @brief Hand slots returned by front() or frontSpan() back to the producer (consumer only)
+     * @param count Number of frames to release from the front (default 1)
+     *
+     * Must not release more frames than front()/frontSpan() returned.
+     */
+    void release(uint16_t count = 1) {
+        // Finish using the slots before handing them back to the producer
+        memoryBarrier();
+        tail_ = wrap(tail_ + count);
+    }
+
+    /**
+     * @brief Pop several CAN frames from the queue in one call (consumer only)
+     * @param frames Array to store the popped frames, in queue order
+     * @param max Maximum number of frames to pop (size of the frames array)
+     * @return Number of frames popped, 0 if queue is empty
+     *
+     * Only one pair of barriers is needed for the whole batch.
+     */
+    uint16_t popMany(CAN_FRAME* frames, uint16_t max) {
+        uint16_t tail = tail_;
+        uint16_t count = length();
+        if (count > max) {
+            count = max;
+        }
+
+        memoryBarrier();
+        for (uint16_t i = 0; i < count; i++) {
+            frames[i] = buffer_[tail];
+            tail = advance(tail);
+        }
+        memoryBarrier();
+        tail_ = tail;
+        return count;
+    }
+
+    /**
+     * @brief Check if queue is empty
+     * @return true if queue contains no elements
+     */
+    bool isEmpty() const {
+        return head_ == tail_;
+    }
+
+    /**
+     * @brief Check if queue is full
+     * @return true if queue is at maximum capacity
+     */
+    bool isFull() const {
+        return advance(head_) == tail_;
+    }
+
+    /**
+     * @brief Get number of elements in queue
+     * @return Number of CAN frames currently in the queue
+     */
+    uint16_t length() const {
+        return distance(tail_, head_);
+    }
+
+    /**
+     * @brief Get maximum capacity of queue
+     * @return Maximum number of frames the queue can hold
+     */
+    uint16_t capacity() const {
+        return CAPACITY;
+    }
+
+    /**
+     * @brief Discard all elements in the queue (consumer only)
+     *
+     * Implemented by moving tail_ up to head_, so it is safe to call
+     * while the producer is active.
+     */
+    void clear() {
+        tail_ = head_;
+    }
+
+    /**
+     * @brief Get number of available slots
+     * @return Number of frames that can still be added
+     */
+    uint16_t available() const {
+        return CAPACITY - length();
+    }
+
+    /**
+     * @brief Feed the current depth to the statistics policy (consumer only)
+     * @param elapsedMs Time since the previous call in milliseconds
+     */
+    void sampleStats(uint32_t elapsedMs) {
+        stats_.sample(length(), elapsedMs);
+    }
+
+    /**
+     * @brief Access the queue statistics
+     * @return The statistics policy instance
+     */
+    const STATS& stats() const {
+        return stats_;
+    }
+
+private:
+    static const uint16_t SLOTS = CAPACITY + 1; ///< One slot is kept free to tell full from empty
+
+    /**
+     * @brief Advance a buffer index by one, wrapping at the end
+     */
+    static uint16_t advance(uint16_t index) {
+        return (index + 1 >= SLOTS) ? 0 : (index + 1);
+    }
+
+    /**
+     * @brief Number of frames between a read and a write position
+     */
+    static uint16_t distance(uint16_t tail, uint16_t head) {
+        return (head >= tail) ? (head - tail) : (SLOTS - tail + head);
+    }
+
+    /**
+     * @brief Wrap an index that has been advanced by at most SLOTS
+     */
+    static uint16_t wrap(uint32_t index) {
+        return (index >= SLOTS) ? (index - SLOTS) : index;
+    }
+
+    /**
+     * @brief Data memory barrier between slot access and index update
+     */
+    static void memoryBarrier() {
+#if defined(__arm__)
+        __asm volatile ("dmb" ::: "memory");
+#else
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#endif
+    }
+
+    CAN_FRAME buffer_[SLOTS];   ///< Circular buffer storage
+    volatile uint16_t head_;     ///< Write position, owned by the producer
+    volatile uint16_t tail_;     ///< Read position, owned by the consumer
+    STATS stats_;                ///< Occupancy and overflow statistics
+};
+
+#endif // SPSC_CAN_QUEUE_H
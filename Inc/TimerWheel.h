@@ -0,0 +1,222 @@
+/**
+ * @file TimerWheel.h
+ * @brief Millisecond timer wheel for the App's periodic tasks and timeouts
+ */
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>
+#include "CycleCounter.h"
+#include "LatencyStats.h"
+
+/**
+ * @class TimerWheel
+ * @brief Statically allocated hashed timer wheel, one slot per millisecond
+ *
+ * Each task waits in the slot of its next deadline, modulo SLOTS, in a
+ * list linked through the task table. A tick visits only the slot the
+ * current millisecond falls in, so it costs the tasks expiring now plus
+ * any whose deadline is a whole number of wheel turns away; a task with a
+ * period up to SLOTS ms is only ever visited when it expires.
+ *
+ * Tasks run from advance(), in the context that calls it, after all tasks
+ * of that tick have been taken off the wheel. Tasks due in the same tick
+ * run in the order they were put in their slot. A task may cancel or add
+ * tasks, itself included; one cancelled before its turn in the tick does
+ * not run. The cost of each advance() call is kept in CycleCounter counts.
+ *
+ * @tparam SLOTS Wheel size in ms, a power of two up to 256
+ * @tparam MAX_TASKS Task table size, up to 255
+ */
+template<uint16_t SLOTS, uint8_t MAX_TASKS>
+class TimerWheel {
+public:
+    static_assert(SLOTS > 0 && SLOTS <= 256 && (SLOTS & (SLOTS - 1)) == 0, "SLOTS must be a power of two up to 256");
+    static_assert(MAX_TASKS > 0 && MAX_TASKS < 255, "MAX_TASKS must fit an 8-bit index");
+
+    typedef void (*Callback)(void* context);
+
+    static const uint8_t NO_TASK = 0xFF;
+
+    TimerWheel() :
+        now_(0),
+        due_(NO_TASK),
+        taskCount_(0) {
+        for (uint16_t i = 0; i < SLOTS; i++) {
+            head_[i] = NO_TASK;
+        }
+        for (uint8_t i = 0; i < MAX_TASKS; i++) {
+            tasks_[i].callback = nullptr;
+        }
+    }
+
+    /**
+     * @brief Register a task
+     * @param periodMs Time between runs, 0 for a task that runs once
+     * @param phaseMs Delay from now to the first run, 0 for one period
+     * @param callback Function to run
+     * @param context Passed to callback
+     * @return Task index, or NO_TASK if the table is full or the task never runs
+     */
+    uint8_t add(uint32_t periodMs, uint32_t phaseMs, Callback callback, void* context) {
+        uint32_t delay = (phaseMs > 0) ? phaseMs : periodMs;
+        if (callback == nullptr || delay == 0) {
+            return NO_TASK;
+        }
+
+        for (uint8_t i = 0; i < MAX_TASKS; i++) {
+            if (tasks_[i].callback == nullptr) {
+                tasks_[i].callback = callback;
+                tasks_[i].context = context;
+                tasks_[i].periodMs = periodMs;
+                tasks_[i].deadline = now_ + delay;
+                insert(i);
+                taskCount_++;
+                return i;
+            }
+        }
+        return NO_TASK;
+    }
+
+    /**
+     * @brief Remove a task before it runs again
+     * @param task Index returned by add()
+     */
+    void cancel(uint8_t task) {
+        if (task >= MAX_TASKS || tasks_[task].callback == nullptr) {
+            return;
+        }
+
+        // Waiting in its slot, or already taken off it to run this tick
+        if (!unlink(&head_[tasks_[task].deadline & (SLOTS - 1)], task)) {
+            unlink(&due_, task);
+        }
+        tasks_[task].callback = nullptr;
+        taskCount_--;
+    }
+
+    /**
+     * @brief Move time on, running every task that falls due
+     * @param ms Milliseconds elapsed since the last call
+     */
+    void advance(uint32_t ms) {
+        uint32_t start = CycleCounter::now();
+        for (uint32_t i = 0; i < ms; i++) {
+            tick();
+        }
+        cost_.record(CycleCounter::now() - start);
+    }
+
+    /**
+     * @brief Get the number of registered tasks
+     */
+    uint8_t taskCount() const {
+        return taskCount_;
+    }
+
+    /**
+     * @brief Get the time advanced so far
+     * @return Milliseconds, wraps at 2^32
+     */
+    uint32_t nowMs() const {
+        return now_;
+    }
+
+    /**
+     * @brief Get the cost of advance()
+     * @return Cycles per call
+     */
+    const LatencyStats& cost() const {
+        return cost_;
+    }
+
+private:
+    /**
+     * @brief One registered task
+     */
+    struct Task {
+        Callback callback;  ///< nullptr for a free table entry
+        void* context;      ///< Passed to callback
+        uint32_t periodMs;  ///< 0 for a task that runs once
+        uint32_t deadline;  ///< Time of the next run
+        uint8_t next;       ///< Next task in the same slot, or NO_TASK
+    };
+
+    /**
+     * @brief Put a task at the end of the slot of its deadline
+     */
+    void insert(uint8_t task) {
+        uint8_t* link = &head_[tasks_[task].deadline & (SLOTS - 1)];
+        while (*link != NO_TASK) {
+            link = &tasks_[*link].next;
+        }
+        tasks_[task].next = NO_TASK;
+        *link = task;
+    }
+
+    /**
+     * @brief Take a task out of a list
+     * @param link Head of the list
+     * @return false if the task was not in it
+     */
+    bool unlink(uint8_t* link, uint8_t task) {
+        while (*link != NO_TASK) {
+            if (*link == task) {
+                *link = tasks_[task].next;
+                return true;
+            }
+            link = &tasks_[*link].next;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Advance one millisecond
+     */
+    void tick() {
+        now_++;
+
+        // Take the tasks due now off the slot first, in order, so a task
+        // that lands in the same slot again is not seen twice. cancel()
+        // takes a task off this list too, so it is never run once freed.
+        uint8_t* tail = &due_;
+        uint8_t* link = &head_[now_ & (SLOTS - 1)];
+        while (*link != NO_TASK) {
+            uint8_t task = *link;
+            if (tasks_[task].deadline == now_) {
+                *link = tasks_[task].next;
+                tasks_[task].next = NO_TASK;
+                *tail = task;
+                tail = &tasks_[task].next;
+            } else {
+                link = &tasks_[task].next;
+            }
+        }
+
+        while (due_ != NO_TASK) {
+            uint8_t task = due_;
+            due_ = tasks_[task].next;
+
+            Callback callback = tasks_[task].callback;
+            void* context = tasks_[task].context;
+            if (tasks_[task].periodMs > 0) {
+                tasks_[task].deadline += tasks_[task].periodMs;
+                insert(task);
+            } else {
+                tasks_[task].callback = nullptr;
+                taskCount_--;
+            }
+            callback(context);
+        }
+    }
+
+    Task tasks_[MAX_TASKS];     ///< Task table
+    uint8_t head_[SLOTS];       ///< First task of each slot, or NO_TASK
+    uint32_t now_;              ///< Milliseconds advanced
+    uint8_t due_;               ///< Tasks of the current tick still to run, or NO_TASK
+    uint8_t taskCount_;         ///< Registered tasks
+    LatencyStats cost_;         ///< Cycles per advance() call
+};
+
+#endif // TIMER_WHEEL_H
@@ -40,6 +40,28 @@ extern CAN_HandleTypeDef hcan2;
 
 /* USER CODE BEGIN Private defines */
 
+/* NVIC preemption priorities (lower is more urgent). FIFO1 holds the frames
+   the App handles and may preempt the FIFO0, TX and error (SCE) interrupts.
+   The RX interrupts of one FIFO share a priority, so each RxQueue has one
+   producer. Only the vectors at CAN_IRQ_PRIORITY call HAL_CAN_IRQHandler();
+   the RX1 vectors drain FIFO1 alone, see CanRxFifo1IRQHandler(). */
+#define CAN_RX_FIFO1_IRQ_PRIORITY   0
+#define CAN_IRQ_PRIORITY            1
+
+/* CAN_PENDSV_PROCESSING builds hand the received frames to the App in
+   PendSV at the lowest priority, so every CAN interrupt preempts it. */
+#define CAN_DEFERRED_IRQ_PRIORITY   15
+
+/* Time triggered communication mode makes bxCAN capture its bit time
+   counter in every received message, see CanTimestampExtender.h. Its other
+   effect, sending the counter in the last two data bytes, stays off because
+   no mailbox sets TransmitGlobalTime. */
+#ifdef CAN_HW_TIMESTAMPS
+#define CAN_TIME_TRIGGERED_MODE     ENABLE
+#else
+#define CAN_TIME_TRIGGERED_MODE     DISABLE
+#endif
+
 /* USER CODE END Private defines */
 
 void MX_CAN1_Init(void);
@@ -63,6 +85,31 @@ void MX_CAN2_Init(void);
  */
 void AddCANFilters(CAN_HandleTypeDef* canHandle);
 
+/**
+ * @brief Program the acceptance filter banks for the specified CAN handle
+ * @param canHandle Pointer to the CAN handle (hcan1 or hcan2)
+ *
+ * Implemented in can_filters.cpp, called by AddCANFilters().
+ */
+void ConfigureCanFilters(CAN_HandleTypeDef* canHandle);
+
+/**
+ * @brief FIFO1 RX interrupt handler (can_callbacks.cpp)
+ * @param channel CAN channel index (0 for CAN1, 1 for CAN2)
+ * @param canChan CAN handle (hcan1 or hcan2)
+ */
+void CanRxFifo1IRQHandler(uint8_t channel, CAN_HandleTypeDef* canChan);
+
+#ifdef CAN_RX_DIRECT
+/**
+ * @brief Register-level RX FIFO interrupt handler (can_callbacks.cpp)
+ * @param channel CAN channel index (0 for CAN1, 1 for CAN2)
+ * @param can Controller registers (CAN1 or CAN2)
+ * @param fifo FIFO number (0 or 1)
+ */
+void CanRxDirectIRQHandler(uint8_t channel, CAN_TypeDef* can, uint8_t fifo);
+#endif
+
 
 /* USER CODE END Prototypes */
 
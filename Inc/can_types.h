@@ -4,6 +4,20 @@
 
 
 const int QUEUE_CAPACITY = 64;
+const int CAN_CHANNEL_COUNT = 2;    // CAN1 and CAN2
+const int CAN_RX_FIFO_COUNT = 2;    // bxCAN FIFO0 and FIFO1
+const uint32_t CAN_BIT_RATE = 500000;  // Both buses, see MX_CAN1_Init()/MX_CAN2_Init()
+const uint32_t CAN_BITS_PER_MS = CAN_BIT_RATE / 1000;
+const int CAN_TX_STAGE_DEPTH = 2;   // Frames ready for each controller's TX mailbox empty interrupt
+const int QUEUE_STATS_DEPTH_THRESHOLD = QUEUE_CAPACITY * 3 / 4;    // Queue depth counted as "nearly full"
+
+// What a full CAN queue does with one more frame
+enum CanQueueOverflow
+{
+    CAN_QUEUE_DROP_NEWEST,  // Reject the new frame
+    CAN_QUEUE_DROP_OLDEST,  // Discard the oldest queued frame to make room
+    CAN_QUEUE_COALESCE,     // Replace the newest queued frame with the same ID and channel, else reject
+};
 
 
 typedef struct
@@ -17,8 +31,32 @@ typedef struct
         uint8_t     tx_channel; // Used to store CAN channel index
     };
     uint8_t     data[8];
+#ifdef CAN_FRAME_TIMESTAMPS
+    uint32_t    timestamp;  // CycleCounter::now() on receipt, 0 if none, see FrameTimestamp.h
+    uint32_t    stage_time; // CycleCounter::now() entering the current forwarding stage, see FrameTimestamp.h
+#endif
+#ifdef CAN_HW_TIMESTAMPS
+    uint32_t    rx_time;    // bxCAN start-of-frame time in bit times, extended to 32 bits, see CanTimestampExtender.h
+#endif
 }CAN_FRAME;
 
+// CAN_FRAME is copied by value through every queue. At 16 bytes and 4-byte
+// aligned, a copy is four word loads and stores (LDM/STM on the Cortex-M3).
+// The header cannot be packed into one 32-bit word: a 29-bit ID, IDE, RTR,
+// a 4-bit DLC and the channel need 36 bits, so a smaller frame must either
+// pad back to 16 bytes or be packed and copied with unaligned accesses.
+// test/bench_can_frame.cpp compares the layouts.
+#if defined(CAN_FRAME_TIMESTAMPS) && defined(CAN_HW_TIMESTAMPS)
+static_assert(sizeof(CAN_FRAME) == 28, "CAN_FRAME must stay 28 bytes with both timestamps");
+#elif defined(CAN_FRAME_TIMESTAMPS)
+static_assert(sizeof(CAN_FRAME) == 24, "CAN_FRAME must stay 24 bytes with forwarding timestamps");
+#elif defined(CAN_HW_TIMESTAMPS)
+static_assert(sizeof(CAN_FRAME) == 20, "CAN_FRAME must stay 20 bytes with hardware timestamps");
+#else
+static_assert(sizeof(CAN_FRAME) == 16, "CAN_FRAME must stay 16 bytes, see test/bench_can_frame.cpp");
+#endif
+static_assert(alignof(CAN_FRAME) == 4, "CAN_FRAME must stay word aligned for LDM/STM copies");
+
 #define CAN_TYPES_H
 
 #endif
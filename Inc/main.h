@@ -60,6 +60,18 @@ void Error_Handler(void);
 
 /* USER CODE BEGIN EFP */
 
+/**
+ * @brief Tell the main loop the HAL tick has advanced (main.cpp, for SysTick_Handler())
+ */
+void SignalMainLoopTick(void);
+
+#ifdef CAN_PENDSV_PROCESSING
+/**
+ * @brief Receive and transmit processing (main.cpp, for PendSV_Handler())
+ */
+void ProcessDeferredWork(void);
+#endif
+
 /* USER CODE END EFP */
 
 /* Private defines -----------------------------------------------------------*/
@@ -62,6 +62,8 @@ void CAN2_TX_IRQHandler(void);
 void CAN2_RX0_IRQHandler(void);
 void CAN2_RX1_IRQHandler(void);
 /* USER CODE BEGIN EFP */
+void CAN1_SCE_IRQHandler(void);
+void CAN2_SCE_IRQHandler(void);
 
 /* USER CODE END EFP */
 
@@ -6,31 +6,34 @@
  */
 
 #include "App.h"
-#include "CanQueue.h"
 #include <CanMessage373.h>
 #include <stdio.h>
 #include <CanMessage374.h>
 #include "version.h"
+#include "FrameTimestamp.h"
 /**
  * @brief Process received CAN messages
  */
-void App::canMsgReceived(const CAN_FRAME &frame)
+void App::canMsgReceived(CAN_FRAME &frame)
 {
     bool sendResponse = true;
-    // copy the frame to modify if needed
-    CAN_FRAME response = frame;
 
     // Update the battery model with data from message 0x373, received every 100ms
-    if (frame.ID == 0x373)
+    if (frame.ID == CanMessage373::MESSAGE_ID)
     {
         CanMessage373 rxMsg(&frame);
         VoltageByte cellMin = rxMsg.getCellMinVoltage();
         float packCurrent = rxMsg.getPackCurrent();
+#ifdef CAN_HW_TIMESTAMPS
+        m_batteryModel->update(cellMin, packCurrent, measure373IntervalMs(frame));
+#else
         m_batteryModel->update(cellMin, packCurrent, CanMessage373::RECURRANCE_MS);
+#endif
     }
 
-    // Modify message 0x374 with updated SoC values
-    else if (frame.ID == 0x374)
+    // Modify message 0x374 with updated SoC values.
+    // The received frame is rewritten in place, in its RxQueue slot.
+    else if (frame.ID == CanMessage374::MESSAGE_ID)
     {
         CanMessage374 rxMsg(&frame);
         // Modify some fields before sending back
@@ -38,17 +41,130 @@ void App::canMsgReceived(const CAN_FRAME &frame)
         rxMsg.setSoC1(m_batteryModel->getSoC1());
         rxMsg.setSoC2(m_batteryModel->getSoC2());
         // Leave temperatures unchanged
-        response = *(rxMsg.getFrame());
         // Only send response if battery model is initialized
         sendResponse = m_batteryModel->isInitialized();
     }
 
+    // Requests to this bridge are answered, not forwarded
+    else if (frame.ID == Diagnostics::REQUEST_ID)
+    {
+        diagnosticRequestReceived(frame);
+        sendResponse = false;
+    }
+
+    if (!sendResponse)
+    {
+        return;
+    }
+
+    // Copy the frame straight into the next TxQueue slot, the only copy
+    // made on the forwarding path. Its receive timestamp goes with it. If
+    // the TxQueue is full the frame is dropped, as a failed push() would.
     // Send responses back on opposite channel they were received from
-    response.tx_channel = frame.rx_channel ? 0 : 1;
-    // Push the response to the TxQueue, if sending this frame
-    if (sendResponse)
+    uint8_t txChannel = frame.rx_channel ? 0 : 1;
+    CAN_FRAME *response = m_txQueue->reserve(txChannel);
+    if (response != nullptr)
+    {
+        *response = frame;
+        response->tx_channel = txChannel;
+#ifdef CAN_FRAME_TIMESTAMPS
+        uint32_t latency;
+        if (FrameNextStage(response, &latency))
+        {
+            m_enqueueLatency.record(latency);
+        }
+#endif
+        m_txQueue->commit(txChannel);
+    }
+}
+
+#ifdef CAN_HW_TIMESTAMPS
+/**
+ * @brief Measure the time since the previous 0x373 from hardware timestamps
+ *
+ * The interval is converted to whole milliseconds and the remainder is
+ * carried over, so the time integrated by the battery model follows the
+ * sender's clock without rounding drift. The first frame, a zero interval
+ * and gaps longer than MAX_373_INTERVAL_MS (frames lost, or a sender
+ * restart) fall back to the nominal period. So does the first frame after
+ * a change of channel, as each controller keeps its own receive time.
+ */
+uint32_t App::measure373IntervalMs(const CAN_FRAME &frame)
+{
+    uint32_t interval = frame.rx_time - m_373RxTime;
+    bool known = m_373RxTimeValid && frame.rx_channel == m_373RxChannel && interval > 0;
+    m_373RxTime = frame.rx_time;
+    m_373RxChannel = frame.rx_channel;
+    m_373RxTimeValid = true;
+
+    if (known)
+    {
+        m_373Interval.record(interval);
+    }
+    if (!known || interval > MAX_373_INTERVAL_MS * CAN_BITS_PER_MS)
+    {
+        m_373CarryBits = 0;
+        return CanMessage373::RECURRANCE_MS;
+    }
+
+    interval += m_373CarryBits;
+    m_373CarryBits = interval % CAN_BITS_PER_MS;
+    return interval / CAN_BITS_PER_MS;
+}
+#endif
+
+/**
+ * @brief Answer a diagnostic request
+ *
+ * Byte 0 names the latency histogram dump wanted, one stage or all. The
+ * frames go out on the requesting bus only. A stage whose frames do not all
+ * fit in that TxQueue lane is left out: every dump frame shares the 0x721
+ * ID, so a push to a full, coalescing lane would overwrite another queued
+ * page. A dump of a busy bridge may therefore need a repeat.
+ */
+void App::diagnosticRequestReceived(const CAN_FRAME &frame)
+{
+    if (m_diagnostics == nullptr || frame.dlc < 1)
+    {
+        return;
+    }
+
+    uint8_t request = frame.data[0];
+    CanTxQueue::Lane &lane = m_txQueue->lane(frame.rx_channel);
+    CAN_FRAME reply;
+    for (uint8_t i = 0; i < Diagnostics::HISTOGRAM_COUNT; i++)
+    {
+        if (request != Diagnostics::REQUEST_ALL_HISTOGRAMS && request != Diagnostics::PAGE_HISTOGRAM + i)
+        {
+            continue;
+        }
+
+        Diagnostics::HistogramStage stage = (Diagnostics::HistogramStage)i;
+        uint8_t count = m_diagnostics->histogramFrameCount(stage);
+        if (lane.capacity() - lane.length() < count)
+        {
+            continue;
+        }
+        for (uint8_t index = 0; index < count; index++)
+        {
+            if (!m_diagnostics->buildHistogramFrame(stage, index, &reply))
+            {
+                break;
+            }
+            reply.tx_channel = frame.rx_channel;
+            m_txQueue->push(reply);
+        }
+    }
+}
+
+/**
+ * @brief Process a batch of received CAN messages
+ */
+void App::canMsgsReceived(CAN_FRAME *frames, uint16_t count)
+{
+    for (uint16_t i = 0; i < count; i++)
     {
-        m_txQueue->push(response);
+        canMsgReceived(frames[i]);
     }
 }
 
@@ -59,19 +175,21 @@ void App::timeTickMs(uint32_t ms)
 {
     m_ticks += ms;
 
-    m_one_second -= ms;
-    if (m_one_second <= 0)
-    {
-        m_one_second += 1000;
-        m_seconds++;
-        sendHeartbeat();
-    }
+    // Periodic tasks, timeouts and state machine deadlines are registered
+    // with m_timers, so each millisecond costs the tasks falling due rather
+    // than a check of every one
+    m_timers.advance(ms);
+}
 
-    // Add your periodic tasks here:
-    // - Check timeouts
-    // - Update state machines
-    // - Send periodic messages
-    // - Monitor system health
+/**
+ * @brief Once a second task: count uptime, send the heartbeat and diagnostics
+ */
+void App::secondTask(void *app)
+{
+    App *self = static_cast<App *>(app);
+    self->m_seconds++;
+    self->sendHeartbeat();
+    self->sendDiagnostics();
 }
 
 /**
@@ -85,15 +203,24 @@ void App::sendHeartbeat()
     heartbeat.ide = 0;
     heartbeat.rtr = 0;
     heartbeat.tx_channel = 0;
+    FrameClearStamp(&heartbeat);
 
     // Hearbeat data for ID 0x720
     // Bytes 0-1 = major/minor version of the software (e.g., 1.0)
     heartbeat.data[0] = ProjectVersion::MAJOR;
     heartbeat.data[1] = ProjectVersion::MINOR;
-    // Byte 2 = reserved
+    // Byte 2 = CPU load over the last second (%)
+    // Byte 3 = longest main loop pass over the last second (0.1 ms, rounded
+    // up, saturates at 0xFF). Both 0 without a CPU profile.
     heartbeat.data[2] = 0;
-    // Byte 3 = reserved
     heartbeat.data[3] = 0;
+    if (m_cpuProfile != nullptr)
+    {
+        uint32_t loopUs = CycleCounter::toMicros(m_cpuProfile->maxAwakeCycles());
+        uint32_t loopTenthsMs = (loopUs + 99) / 100;
+        heartbeat.data[2] = (m_cpuProfile->loadPermille() + 5) / 10;
+        heartbeat.data[3] = (loopTenthsMs > 0xFF) ? 0xFF : loopTenthsMs;
+    }
     // Bytes 4-7 = uptime in seconds (uint32_t)
     heartbeat.data[4] = (m_seconds >> 24) & 0xFF;
     heartbeat.data[5] = (m_seconds >> 16) & 0xFF;
@@ -105,3 +232,30 @@ void App::sendHeartbeat()
     heartbeat.tx_channel = 1;
     m_txQueue->push(heartbeat);
 }
+
+/**
+ * @brief Send all 0x721 diagnostic pages
+ */
+void App::sendDiagnostics()
+{
+    if (m_diagnostics == nullptr)
+    {
+        return;
+    }
+
+    CAN_FRAME page;
+    uint8_t count = m_diagnostics->pageCount();
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (!m_diagnostics->buildPage(i, &page))
+        {
+            break;
+        }
+
+        // Queue for transmission on both channels, like the heartbeat
+        page.tx_channel = 0;
+        m_txQueue->push(page);
+        page.tx_channel = 1;
+        m_txQueue->push(page);
+    }
+}
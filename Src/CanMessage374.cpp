@@ -9,8 +9,8 @@
  * @brief Construct from CAN frame pointer
  * @param frame Pointer to CAN_FRAME structure
  */
-CanMessage374::CanMessage374(const CAN_FRAME *frame)
-    : frame_(const_cast<CAN_FRAME *>(frame))
+CanMessage374::CanMessage374(CAN_FRAME *frame)
+    : frame_(frame)
 {
 }
 
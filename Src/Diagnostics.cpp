@@ -0,0 +1,787 @@
+/**
+ * @file Diagnostics.cpp
+ * @brief Implementation of the Diagnostics class
+ */
+
+#include "Diagnostics.h"
+#include "CycleCounter.h"
+#include "FrameTimestamp.h"
+#include <string.h>
+
+/**
+ * @brief Write a 32-bit value big-endian into frame data
+ */
+static void PutU32(uint8_t *data, uint32_t value)
+{
+    data[0] = (value >> 24) & 0xFF;
+    data[1] = (value >> 16) & 0xFF;
+    data[2] = (value >> 8) & 0xFF;
+    data[3] = value & 0xFF;
+}
+
+/**
+ * @brief Write the low 24 bits of a value big-endian into frame data
+ */
+static void PutU24(uint8_t *data, uint32_t value)
+{
+    data[0] = (value >> 16) & 0xFF;
+    data[1] = (value >> 8) & 0xFF;
+    data[2] = value & 0xFF;
+}
+
+/**
+ * @brief Write a 16-bit value big-endian into frame data, saturating
+ */
+static void PutU16Saturated(uint8_t *data, uint32_t value)
+{
+    if (value > 0xFFFF)
+    {
+        value = 0xFFFF;
+    }
+    data[0] = (value >> 8) & 0xFF;
+    data[1] = value & 0xFF;
+}
+
+/**
+ * @brief Write a 24-bit value big-endian into frame data, saturating
+ */
+static void PutU24Saturated(uint8_t *data, uint32_t value)
+{
+    if (value > 0xFFFFFF)
+    {
+        value = 0xFFFFFF;
+    }
+    PutU24(data, value);
+}
+
+/**
+ * @brief Convert CAN bit times to microseconds
+ */
+static uint32_t BitTimesToMicros(uint32_t bits)
+{
+    return (uint32_t)((uint64_t)bits * 1000000 / CAN_BIT_RATE);
+}
+
+Diagnostics::Diagnostics() :
+    m_rxIntervalStats(nullptr),
+    m_idleStats(nullptr),
+    m_wakeLatency(nullptr),
+    m_schedulerCost(nullptr),
+    m_cpuProfile(nullptr),
+    m_loopMonitor(nullptr)
+{
+    for (uint8_t i = 0; i < QUEUE_COUNT; i++)
+    {
+        m_queueStats[i] = nullptr;
+    }
+    for (uint8_t i = 0; i < CAN_CHANNEL_COUNT; i++)
+    {
+        m_latencyStats[i] = nullptr;
+    }
+    for (uint8_t i = 0; i < CAN_CHANNEL_COUNT * CAN_RX_FIFO_COUNT; i++)
+    {
+        m_rxFifoStats[i] = nullptr;
+    }
+    for (uint8_t i = 0; i < CAN_CHANNEL_COUNT; i++)
+    {
+        m_cutThroughStats[i] = nullptr;
+    }
+    for (uint8_t i = 0; i < CAN_CHANNEL_COUNT * CAN_RX_FIFO_COUNT; i++)
+    {
+        m_rxLossStats[i] = nullptr;
+    }
+    for (uint8_t i = 0; i < HISTOGRAM_COUNT; i++)
+    {
+        m_histograms[i] = nullptr;
+    }
+    for (uint8_t i = 0; i < CAN_CHANNEL_COUNT; i++)
+    {
+        m_canErrorMonitors[i] = nullptr;
+    }
+}
+
+/**
+ * @brief Register the statistics of a queue
+ */
+void Diagnostics::setQueueStats(QueueIndex queue, const QueueStats *stats)
+{
+    if (queue < QUEUE_COUNT)
+    {
+        m_queueStats[queue] = stats;
+    }
+}
+
+/**
+ * @brief Register the forwarding latency of frames sent on a channel
+ */
+void Diagnostics::setLatencyStats(uint8_t channel, const LatencyStats *stats)
+{
+    if (channel < CAN_CHANNEL_COUNT)
+    {
+        m_latencyStats[channel] = stats;
+    }
+}
+
+/**
+ * @brief Register the interrupt statistics of a receive FIFO
+ */
+void Diagnostics::setRxFifoStats(uint8_t channel, uint8_t fifo, const RxFifoStats *stats)
+{
+    if (channel < CAN_CHANNEL_COUNT && fifo < CAN_RX_FIFO_COUNT)
+    {
+        m_rxFifoStats[channel * CAN_RX_FIFO_COUNT + fifo] = stats;
+    }
+}
+
+/**
+ * @brief Register the cut-through count of frames received on a channel
+ */
+void Diagnostics::setCutThroughStats(uint8_t channel, const RxFifoStats *stats)
+{
+    if (channel < CAN_CHANNEL_COUNT)
+    {
+        m_cutThroughStats[channel] = stats;
+    }
+}
+
+/**
+ * @brief Register the receive interval of 0x373
+ */
+void Diagnostics::setRxIntervalStats(const LatencyStats *stats)
+{
+    m_rxIntervalStats = stats;
+}
+
+/**
+ * @brief Register the full and overrun counts of a receive FIFO
+ */
+void Diagnostics::setRxLossStats(uint8_t channel, uint8_t fifo, const RxFifoStats *stats)
+{
+    if (channel < CAN_CHANNEL_COUNT && fifo < CAN_RX_FIFO_COUNT)
+    {
+        m_rxLossStats[channel * CAN_RX_FIFO_COUNT + fifo] = stats;
+    }
+}
+
+/**
+ * @brief Register the main loop's idle fraction and wake latency
+ */
+void Diagnostics::setMainLoopStats(const IdleStats *idle, const LatencyStats *wakeLatency)
+{
+    m_idleStats = idle;
+    m_wakeLatency = wakeLatency;
+}
+
+/**
+ * @brief Register the cost of advancing the App's timer wheel
+ */
+void Diagnostics::setSchedulerStats(const LatencyStats *cost)
+{
+    m_schedulerCost = cost;
+}
+
+/**
+ * @brief Register the CPU profile
+ */
+void Diagnostics::setCpuProfile(const CpuProfile *profile)
+{
+    m_cpuProfile = profile;
+}
+
+/**
+ * @brief Register the latency histogram of a forwarding stage
+ */
+void Diagnostics::setLatencyHistogram(HistogramStage stage, const LatencyHistogram *histogram)
+{
+    if (stage < HISTOGRAM_COUNT)
+    {
+        m_histograms[stage] = histogram;
+    }
+}
+
+/**
+ * @brief Register the main loop stall monitor
+ */
+void Diagnostics::setLoopMonitor(const LoopMonitor *monitor)
+{
+    m_loopMonitor = monitor;
+}
+
+/**
+ * @brief Register the bus error monitor of a controller
+ */
+void Diagnostics::setCanErrorMonitor(uint8_t channel, const CanErrorMonitor *monitor)
+{
+    if (channel < CAN_CHANNEL_COUNT)
+    {
+        m_canErrorMonitors[channel] = monitor;
+    }
+}
+
+/**
+ * @brief Get the number of pages currently available
+ *
+ * Each queue with statistics contributes an occupancy and a traffic page,
+ * each channel with latency statistics one latency page, each receive
+ * FIFO with statistics one RX interrupt page, each channel with
+ * cut-through statistics one cut-through page, receive interval
+ * statistics one more page, each receive FIFO with loss statistics
+ * one RX FIFO loss page, main loop statistics one more page,
+ * scheduler statistics one more page, a CPU profile two more pages, a
+ * loop monitor two more pages, and each channel with a bus error monitor
+ * four last pages.
+ */
+uint8_t Diagnostics::pageCount() const
+{
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < QUEUE_COUNT; i++)
+    {
+        if (m_queueStats[i] != nullptr)
+        {
+            count += 2;
+        }
+    }
+    for (uint8_t i = 0; i < CAN_CHANNEL_COUNT; i++)
+    {
+        if (m_latencyStats[i] != nullptr)
+        {
+            count++;
+        }
+    }
+    for (uint8_t i = 0; i < CAN_CHANNEL_COUNT * CAN_RX_FIFO_COUNT; i++)
+    {
+        if (m_rxFifoStats[i] != nullptr)
+        {
+            count++;
+        }
+    }
+    for (uint8_t i = 0; i < CAN_CHANNEL_COUNT; i++)
+    {
+        if (m_cutThroughStats[i] != nullptr)
+        {
+            count++;
+        }
+    }
+    if (m_rxIntervalStats != nullptr)
+    {
+        count++;
+    }
+    for (uint8_t i = 0; i < CAN_CHANNEL_COUNT * CAN_RX_FIFO_COUNT; i++)
+    {
+        if (m_rxLossStats[i] != nullptr)
+        {
+            count++;
+        }
+    }
+    if (m_idleStats != nullptr)
+    {
+        count++;
+    }
+    if (m_schedulerCost != nullptr)
+    {
+        count++;
+    }
+    if (m_cpuProfile != nullptr)
+    {
+        count += 2;
+    }
+    if (m_loopMonitor != nullptr)
+    {
+        count += 2;
+    }
+    for (uint8_t i = 0; i < CAN_CHANNEL_COUNT; i++)
+    {
+        if (m_canErrorMonitors[i] != nullptr)
+        {
+            count += 4;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * @brief Build one 0x721 frame
+ */
+bool Diagnostics::buildPage(uint8_t index, CAN_FRAME *frame) const
+{
+    clearFrame(frame);
+
+    for (uint8_t i = 0; i < QUEUE_COUNT; i++)
+    {
+        if (m_queueStats[i] == nullptr)
+        {
+            continue;
+        }
+
+        if (index == 0)
+        {
+            frame->data[0] = PAGE_QUEUE_OCCUPANCY + i;
+            buildQueueOccupancy(m_queueStats[i], frame);
+            return true;
+        }
+        if (index == 1)
+        {
+            frame->data[0] = PAGE_QUEUE_TRAFFIC + i;
+            buildQueueTraffic(m_queueStats[i], frame);
+            return true;
+        }
+        index -= 2;
+    }
+
+    for (uint8_t i = 0; i < CAN_CHANNEL_COUNT; i++)
+    {
+        if (m_latencyStats[i] == nullptr)
+        {
+            continue;
+        }
+
+        if (index == 0)
+        {
+            frame->data[0] = PAGE_LATENCY + i;
+            buildLatency(m_latencyStats[i], frame);
+            return true;
+        }
+        index--;
+    }
+
+    for (uint8_t i = 0; i < CAN_CHANNEL_COUNT * CAN_RX_FIFO_COUNT; i++)
+    {
+        if (m_rxFifoStats[i] == nullptr)
+        {
+            continue;
+        }
+
+        if (index == 0)
+        {
+            frame->data[0] = PAGE_RX_FIFO + i;
+            buildRxFifo(m_rxFifoStats[i], frame);
+            return true;
+        }
+        index--;
+    }
+
+    for (uint8_t i = 0; i < CAN_CHANNEL_COUNT; i++)
+    {
+        if (m_cutThroughStats[i] == nullptr)
+        {
+            continue;
+        }
+
+        if (index == 0)
+        {
+            frame->data[0] = PAGE_CUT_THROUGH + i;
+            buildCutThrough(m_cutThroughStats[i], frame);
+            return true;
+        }
+        index--;
+    }
+
+    if (m_rxIntervalStats != nullptr)
+    {
+        if (index == 0)
+        {
+            frame->data[0] = PAGE_RX_INTERVAL;
+            buildRxInterval(m_rxIntervalStats, frame);
+            return true;
+        }
+        index--;
+    }
+
+    for (uint8_t i = 0; i < CAN_CHANNEL_COUNT * CAN_RX_FIFO_COUNT; i++)
+    {
+        if (m_rxLossStats[i] == nullptr)
+        {
+            continue;
+        }
+
+        if (index == 0)
+        {
+            frame->data[0] = PAGE_RX_LOSS + i;
+            buildRxLoss(m_rxLossStats[i], frame);
+            return true;
+        }
+        index--;
+    }
+
+    if (m_idleStats != nullptr)
+    {
+        if (index == 0)
+        {
+            frame->data[0] = PAGE_MAIN_LOOP;
+            buildMainLoop(frame);
+            return true;
+        }
+        index--;
+    }
+
+    if (m_schedulerCost != nullptr)
+    {
+        if (index == 0)
+        {
+            frame->data[0] = PAGE_SCHEDULER;
+            buildScheduler(frame);
+            return true;
+        }
+        index--;
+    }
+
+    if (m_cpuProfile != nullptr)
+    {
+        if (index == 0)
+        {
+            frame->data[0] = PAGE_CPU_LOAD;
+            buildCpuLoad(frame);
+            return true;
+        }
+        if (index == 1)
+        {
+            frame->data[0] = PAGE_CPU_SECTIONS;
+            buildCpuSections(frame);
+            return true;
+        }
+        index -= 2;
+    }
+
+    if (m_loopMonitor != nullptr)
+    {
+        if (index == 0)
+        {
+            frame->data[0] = PAGE_STALL_PREVIOUS;
+            buildStallPrevious(frame);
+            return true;
+        }
+        if (index == 1)
+        {
+            frame->data[0] = PAGE_STALL_CURRENT;
+            buildStallCurrent(frame);
+            return true;
+        }
+        index -= 2;
+    }
+
+    for (uint8_t i = 0; i < CAN_CHANNEL_COUNT; i++)
+    {
+        const CanErrorMonitor *monitor = m_canErrorMonitors[i];
+        if (monitor == nullptr)
+        {
+            continue;
+        }
+
+        if (index == 0)
+        {
+            frame->data[0] = PAGE_BUS_STATE + i;
+            buildBusState(monitor, frame);
+            return true;
+        }
+        if (index == 1)
+        {
+            frame->data[0] = PAGE_BUS_FRAME_ERRORS + i;
+            buildBusErrors(monitor, CanErrorMonitor::ERROR_STUFF, frame);
+            return true;
+        }
+        if (index == 2)
+        {
+            frame->data[0] = PAGE_BUS_BIT_ERRORS + i;
+            buildBusErrors(monitor, CanErrorMonitor::ERROR_BIT_RECESSIVE, frame);
+            return true;
+        }
+        if (index == 3)
+        {
+            frame->data[0] = PAGE_BUS_TIME + i;
+            buildBusTime(monitor, frame);
+            return true;
+        }
+        index -= 4;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Get the number of frames in the histogram dump of a stage
+ *
+ * A summary frame, then one frame per two buckets over the span of
+ * non-empty buckets.
+ */
+uint8_t Diagnostics::histogramFrameCount(HistogramStage stage) const
+{
+    if (stage >= HISTOGRAM_COUNT || m_histograms[stage] == nullptr)
+    {
+        return 0;
+    }
+
+    uint8_t first;
+    uint8_t last;
+    if (!histogramSpan(m_histograms[stage], &first, &last))
+    {
+        return 1;
+    }
+    return 1 + (last - first + 2) / 2;
+}
+
+/**
+ * @brief Build one frame of the histogram dump of a stage
+ */
+bool Diagnostics::buildHistogramFrame(HistogramStage stage, uint8_t index, CAN_FRAME *frame) const
+{
+    if (index >= histogramFrameCount(stage))
+    {
+        return false;
+    }
+
+    const LatencyHistogram *histogram = m_histograms[stage];
+    clearFrame(frame);
+    frame->data[0] = PAGE_HISTOGRAM + stage;
+
+    if (index == 0)
+    {
+        frame->data[1] = HISTOGRAM_SUMMARY;
+        PutU24Saturated(&frame->data[2], CycleCounter::toMicros(histogram->percentile(990)));
+        PutU24Saturated(&frame->data[5], CycleCounter::toMicros(histogram->percentile(999)));
+        return true;
+    }
+
+    uint8_t first;
+    uint8_t last;
+    if (!histogramSpan(histogram, &first, &last))
+    {
+        return false;
+    }
+    uint8_t bucket = first + 2 * (index - 1);
+    frame->data[1] = bucket;
+    PutU24Saturated(&frame->data[2], histogram->bucket(bucket));
+    if (bucket + 1 < LatencyHistogram::BUCKET_COUNT)
+    {
+        PutU24Saturated(&frame->data[5], histogram->bucket(bucket + 1));
+    }
+    return true;
+}
+
+/**
+ * @brief Fill in the header of a 0x721 frame and clear its data
+ */
+void Diagnostics::clearFrame(CAN_FRAME *frame) const
+{
+    frame->ID = MESSAGE_ID;
+    frame->dlc = 8;
+    frame->ide = 0;
+    frame->rtr = 0;
+    memset(frame->data, 0, sizeof(frame->data));
+    FrameClearStamp(frame);
+}
+
+/**
+ * @brief Find the lowest and highest non-empty bucket of a histogram
+ * @return false if the histogram has no samples, with both buckets set to 0
+ */
+bool Diagnostics::histogramSpan(const LatencyHistogram *histogram, uint8_t *first, uint8_t *last) const
+{
+    bool any = false;
+    *first = 0;
+    *last = 0;
+    for (uint8_t i = 0; i < LatencyHistogram::BUCKET_COUNT; i++)
+    {
+        if (histogram->bucket(i) != 0)
+        {
+            if (!any)
+            {
+                *first = i;
+            }
+            *last = i;
+            any = true;
+        }
+    }
+    return any;
+}
+
+/**
+ * @brief Fill bytes 1-7 of a queue occupancy page
+ */
+void Diagnostics::buildQueueOccupancy(const QueueStats *stats, CAN_FRAME *frame) const
+{
+    uint16_t highWater = stats->highWater();
+    uint16_t depth = stats->depth();
+    frame->data[1] = (highWater > 0xFF) ? 0xFF : highWater;
+    frame->data[2] = (depth > 0xFF) ? 0xFF : depth;
+    frame->data[3] = QUEUE_STATS_DEPTH_THRESHOLD;
+    PutU32(&frame->data[4], stats->msAboveThreshold());
+}
+
+/**
+ * @brief Fill bytes 1-7 of a queue traffic page
+ */
+void Diagnostics::buildQueueTraffic(const QueueStats *stats, CAN_FRAME *frame) const
+{
+    PutU24Saturated(&frame->data[1], stats->drops());
+    PutU32(&frame->data[4], stats->pushes());
+}
+
+/**
+ * @brief Fill bytes 1-7 of a forwarding latency page
+ */
+void Diagnostics::buildLatency(const LatencyStats *stats, CAN_FRAME *frame) const
+{
+    PutU16Saturated(&frame->data[1], CycleCounter::toMicros(stats->min()));
+    PutU16Saturated(&frame->data[3], CycleCounter::toMicros(stats->mean()));
+    PutU24Saturated(&frame->data[5], CycleCounter::toMicros(stats->max()));
+}
+
+/**
+ * @brief Fill bytes 1-7 of an RX interrupt page
+ */
+void Diagnostics::buildRxFifo(const RxFifoStats *stats, CAN_FRAME *frame) const
+{
+    frame->data[1] = stats->maxFramesPerIrq();
+    PutU24(&frame->data[2], stats->irqs());
+    PutU24(&frame->data[5], stats->frames());
+}
+
+/**
+ * @brief Fill bytes 1-7 of a cut-through page
+ */
+void Diagnostics::buildCutThrough(const RxFifoStats *stats, CAN_FRAME *frame) const
+{
+    PutU32(&frame->data[1], stats->cutThroughs());
+}
+
+/**
+ * @brief Fill bytes 1-7 of the receive interval page
+ */
+void Diagnostics::buildRxInterval(const LatencyStats *stats, CAN_FRAME *frame) const
+{
+    PutU16Saturated(&frame->data[1], BitTimesToMicros(stats->min()));
+    PutU16Saturated(&frame->data[3], BitTimesToMicros(stats->mean()));
+    PutU24Saturated(&frame->data[5], BitTimesToMicros(stats->max()));
+}
+
+/**
+ * @brief Fill bytes 1-7 of an RX FIFO loss page
+ */
+void Diagnostics::buildRxLoss(const RxFifoStats *stats, CAN_FRAME *frame) const
+{
+    static_assert(RxFifoStats::OVERRUN_HISTORY == 3, "RX FIFO loss page has room for three overruns");
+
+    PutU16Saturated(&frame->data[1], stats->overruns());
+    PutU16Saturated(&frame->data[3], stats->fulls());
+    for (uint8_t age = 0; age < RxFifoStats::OVERRUN_HISTORY; age++)
+    {
+        RxFifoStats::Overrun overrun;
+        if (stats->recentOverrun(age, &overrun))
+        {
+            frame->data[5 + age] = (overrun.queueDepth > 0xFE) ? 0xFE : overrun.queueDepth;
+        }
+        else
+        {
+            frame->data[5 + age] = 0xFF;
+        }
+    }
+}
+
+/**
+ * @brief Fill bytes 1-7 of the main loop page
+ */
+void Diagnostics::buildMainLoop(CAN_FRAME *frame) const
+{
+    PutU16Saturated(&frame->data[1], m_idleStats->idlePermille());
+    if (m_wakeLatency != nullptr)
+    {
+        PutU16Saturated(&frame->data[3], CycleCounter::toMicros(m_wakeLatency->mean()));
+        PutU24Saturated(&frame->data[5], CycleCounter::toMicros(m_wakeLatency->max()));
+    }
+}
+
+/**
+ * @brief Fill bytes 1-7 of the scheduler page
+ */
+void Diagnostics::buildScheduler(CAN_FRAME *frame) const
+{
+    PutU24Saturated(&frame->data[1], m_schedulerCost->mean());
+    PutU32(&frame->data[4], m_schedulerCost->max());
+}
+
+/**
+ * @brief Fill bytes 1-7 of the CPU load page
+ */
+void Diagnostics::buildCpuLoad(CAN_FRAME *frame) const
+{
+    PutU16Saturated(&frame->data[1], m_cpuProfile->loadPermille());
+    PutU24Saturated(&frame->data[3], CycleCounter::toMicros(m_cpuProfile->maxAwakeCycles()));
+}
+
+/**
+ * @brief Fill bytes 1-7 of the CPU section page
+ */
+void Diagnostics::buildCpuSections(CAN_FRAME *frame) const
+{
+    uint16_t rxIsr = m_cpuProfile->sectionPermille(CpuProfile::SECTION_RX_ISR_FIFO0) +
+                     m_cpuProfile->sectionPermille(CpuProfile::SECTION_RX_ISR_FIFO1);
+    uint16_t tick = m_cpuProfile->sectionPermille(CpuProfile::SECTION_PROCESS_TICK);
+    PutU16Saturated(&frame->data[1], rxIsr);
+    PutU16Saturated(&frame->data[3], m_cpuProfile->sectionPermille(CpuProfile::SECTION_PROCESS_RX));
+    PutU16Saturated(&frame->data[5], m_cpuProfile->sectionPermille(CpuProfile::SECTION_PROCESS_TX));
+    frame->data[7] = (tick > 0xFF) ? 0xFF : tick;
+}
+
+/**
+ * @brief Fill bytes 1-7 of the page on the reset before this start-up
+ */
+void Diagnostics::buildStallPrevious(CAN_FRAME *frame) const
+{
+    const LoopMonitor::Previous &previous = m_loopMonitor->previous();
+    frame->data[1] = (previous.valid ? 0x01 : 0x00) | (previous.watchdogReset ? 0x02 : 0x00);
+    frame->data[2] = previous.activeStage;
+    frame->data[3] = previous.worstStage;
+    if (previous.valid)
+    {
+        PutU32(&frame->data[4], CycleCounter::toMicros(previous.worstCycles));
+    }
+}
+
+/**
+ * @brief Fill bytes 1-7 of the stall page since start-up
+ */
+void Diagnostics::buildStallCurrent(CAN_FRAME *frame) const
+{
+    frame->data[1] = m_loopMonitor->worstStage();
+    PutU24Saturated(&frame->data[2], CycleCounter::toMicros(m_loopMonitor->worstCycles()));
+    PutU24Saturated(&frame->data[5], CycleCounter::toMicros(m_loopMonitor->maxIterationCycles()));
+}
+
+/**
+ * @brief Fill bytes 1-7 of a bus error state page
+ */
+void Diagnostics::buildBusState(const CanErrorMonitor *monitor, CAN_FRAME *frame) const
+{
+    frame->data[1] = monitor->state();
+    frame->data[2] = monitor->tec();
+    frame->data[3] = monitor->rec();
+    PutU16Saturated(&frame->data[4], monitor->busOffs());
+    PutU16Saturated(&frame->data[6], monitor->framesDropped());
+}
+
+/**
+ * @brief Fill bytes 1-7 of a bus error page with three consecutive last error codes
+ * @param first Code reported in bytes 1-2, the next two follow
+ */
+void Diagnostics::buildBusErrors(const CanErrorMonitor *monitor, CanErrorMonitor::ErrorCode first,
+                                 CAN_FRAME *frame) const
+{
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        CanErrorMonitor::ErrorCode code = (CanErrorMonitor::ErrorCode)(first + i);
+        PutU16Saturated(&frame->data[1 + 2 * i], monitor->errors(code));
+    }
+}
+
+/**
+ * @brief Fill bytes 1-7 of a bus error time page
+ */
+void Diagnostics::buildBusTime(const CanErrorMonitor *monitor, CAN_FRAME *frame) const
+{
+    uint32_t recoveryMs = monitor->maxRecoveryMs();
+    PutU16Saturated(&frame->data[1], monitor->timeInStateMs(CanErrorMonitor::STATE_WARNING) / 1000);
+    PutU16Saturated(&frame->data[3], monitor->timeInStateMs(CanErrorMonitor::STATE_PASSIVE) / 1000);
+    PutU16Saturated(&frame->data[5], monitor->timeInStateMs(CanErrorMonitor::STATE_BUS_OFF) / 1000);
+    frame->data[7] = (recoveryMs > 0xFF) ? 0xFF : recoveryMs;
+}
@@ -2,43 +2,393 @@
  * @file can_callbacks.cpp
  * @brief CAN interrupt callbacks for main program
  *
- * These callbacks push received CAN frames directly to the RxQueue
+ * These callbacks receive CAN frames directly into the RxQueue of their
+ * FIFO: FIFO1 holds the IDs the App handles, FIFO0 everything else. Each
+ * interrupt drains every message pending in its FIFO, so a burst of up to
+ * three frames costs one interrupt entry instead of three.
+ *
+ * The TX mailbox complete callbacks reload a freed mailbox from the TX
+ * stage filled by the main loop (see ProcessCanTxChannel() in main.cpp).
+ *
+ * The FIFO1 interrupts never go through HAL_CAN_IRQHandler(), which would
+ * also run the other callbacks at FIFO1's priority; see CanRxFifo1IRQHandler().
+ *
+ * CAN_RX_DIRECT builds bypass HAL_CAN_IRQHandler() for the RX interrupts:
+ * CanRxDirectIRQHandler() reads the FIFO mailbox registers itself. The HAL
+ * callbacks below stay registered and are the path taken otherwise.
+ *
+ * CAN_CUT_THROUGH builds forward passthrough frames from FIFO0 straight
+ * into a TX mailbox of the other controller when that cannot reorder
+ * them, bypassing the queues and the main loop; see CutThrough().
+ *
+ * Both paths check the FIFO's full and overrun flags on entry, see
+ * CheckRxFifoLoss().
+ *
+ * CAN_HW_TIMESTAMPS builds store the controller's start-of-frame timestamp
+ * of every received message, extended to 32 bits, in the frame's rx_time.
+ *
+ * The error callbacks count bus errors by their last error code and
+ * restart a controller that went bus-off, see HandleCanError().
  */
 
 #include "can.h"
-#include "CanQueue.h"
+#include "CanRxQueue.h"
+#include "FrameTimestamp.h"
+#include "RxFifoStats.h"
+#include "CanRxMailbox.h"
+#include "CanTimestampExtender.h"
+#include "CycleCounter.h"
+#include "CanErrorMonitor.h"
+#include "App.h"
 
-// Implementation of GetRxQueue to provide access to RxQueue
+// Implementation of GetRxQueue to provide access to the RxQueues
 // is in main.cpp
 extern "C"
 {
-    CanQueue<QUEUE_CAPACITY> *GetRxQueue(void);
+    CanRxQueue *GetRxQueue(uint8_t fifo);
+    RxFifoStats *GetRxFifoStats(uint8_t channel, uint8_t fifo);
+    bool IsTxLaneEmpty(uint8_t channel);
+    bool LoadCanTxMailbox(uint8_t channel, CAN_FRAME *frame);
+    void RefillCanTxMailboxes(uint8_t channel);
+    void SignalCanRxWork(void);
+    void ProfileCanRxIrq(uint8_t fifo, uint32_t cycles);
+    CanErrorMonitor *GetCanErrorMonitor(uint8_t channel);
+}
+
+// Entering initialization mode from bus-off takes a few APB cycles, as the
+// controller is not on the bus; this bounds the wait if it never does
+static const uint16_t CAN_INIT_ACK_SPINS = 1000;
+
+#ifdef CAN_HW_TIMESTAMPS
+// One per FIFO interrupt handler, as the extenders are not shared between contexts
+static CanTimestampExtender g_rxTimeExtender[CAN_CHANNEL_COUNT][CAN_RX_FIFO_COUNT];
+#endif
+
+/**
+ * @brief Store the extended hardware receive timestamp in a frame (CAN_HW_TIMESTAMPS builds)
+ * @param frame The received frame
+ * @param channel CAN channel index (0 for CAN1, 1 for CAN2)
+ * @param fifo FIFO number (0 or 1)
+ * @param sample 16-bit timestamp from the FIFO mailbox, in bit times
+ */
+static inline void FrameStampRxTime(CAN_FRAME *frame, uint8_t channel, uint8_t fifo, uint16_t sample)
+{
+#ifdef CAN_HW_TIMESTAMPS
+    frame->rx_time = g_rxTimeExtender[channel][fifo].extend(sample, HAL_GetTick() * CAN_BITS_PER_MS);
+#else
+    (void)frame;
+    (void)channel;
+    (void)fifo;
+    (void)sample;
+#endif
+}
+
+/**
+ * @brief Count and clear the full and overrun flags of a receive FIFO
+ * @param can Controller registers
+ * @param fifo FIFO number (0 or 1)
+ * @param rxQueue RxQueue of that FIFO, may be nullptr
+ * @param stats Statistics of that FIFO, may be nullptr
+ *
+ * Polled at the start of every RX interrupt instead of enabling the full
+ * and overrun interrupts: a FIFO can only fill or overrun with messages
+ * pending, so its message pending interrupt is always taken as well. HAL
+ * would report an overrun through the shared, sticky hcan->ErrorCode,
+ * which interrupts of both FIFOs would have to read and clear.
+ */
+static void CheckRxFifoLoss(CAN_TypeDef *can, uint8_t fifo, const CanRxQueue *rxQueue, RxFifoStats *stats)
+{
+    // RF0R and RF1R have the same layout
+    volatile uint32_t *rfr = (fifo == 0) ? &can->RF0R : &can->RF1R;
+    uint32_t flags = *rfr & (CAN_RF0R_FULL0 | CAN_RF0R_FOVR0);
+    if (flags == 0)
+    {
+        return;
+    }
+
+    // Both flags are cleared by writing 1; RFOM written as 0 releases nothing
+    *rfr = flags;
+
+    if (stats != nullptr)
+    {
+        if ((flags & CAN_RF0R_FOVR0) != 0)
+        {
+            stats->onOverrun((rxQueue != nullptr) ? rxQueue->length() : 0, HAL_GetTick());
+        }
+        if ((flags & CAN_RF0R_FULL0) != 0)
+        {
+            stats->onFull();
+        }
+    }
+}
+
+#ifdef CAN_CUT_THROUGH
+/**
+ * @brief Check whether a pending TX mailbox holds a frame with the same ID
+ * @param can Controller registers
+ * @param frame Frame about to be sent
+ * @return true if a mailbox that has not finished sending has the frame's ID
+ */
+static bool TxMailboxHoldsId(const CAN_TypeDef *can, const CAN_FRAME *frame)
+{
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        if ((can->TSR & (CAN_TSR_TME0 << i)) != 0)
+        {
+            continue;
+        }
+
+        uint32_t tir = can->sTxMailBox[i].TIR;
+        bool ide = (tir & CAN_TI0R_IDE) != 0;
+        uint32_t id = ide ? (tir >> CAN_TI0R_EXID_Pos) : (tir >> CAN_TI0R_STID_Pos);
+        if (ide == (frame->ide != 0) && id == frame->ID)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Forward a passthrough frame straight into a TX mailbox of the other controller
+ * @param frame Received frame, from FIFO0
+ * @param rxQueue RxQueue the frame would otherwise be queued in
+ * @return true if the frame was loaded into a TX mailbox
+ *
+ * Only done when it cannot reorder frames: the RxQueue and the destination
+ * TxQueue lane must be empty, and no pending TX mailbox may hold the same
+ * ID, as bxCAN sends equal IDs in mailbox order rather than load order.
+ * Otherwise, or when no mailbox is free, the frame takes the queued path.
+ *
+ * The main loop masks the FIFO0 RX interrupts while it loads a mailbox
+ * (see LockTxMailboxes() in main.cpp), so the two never race for one.
+ * FIFO1 interrupts preempt that mask and must not cut through; they drain
+ * FIFO1 alone, see CanRxFifo1IRQHandler().
+ */
+static bool CutThrough(CAN_FRAME *frame, const CanRxQueue *rxQueue)
+{
+    if (AppHandlesId(frame->ID) || (rxQueue != nullptr && !rxQueue->isEmpty()))
+    {
+        return false;
+    }
+
+    uint8_t txChannel = frame->rx_channel ? 0 : 1;
+    CAN_HandleTypeDef *txCan = (txChannel == 0) ? &hcan1 : &hcan2;
+    if (!IsTxLaneEmpty(txChannel) || TxMailboxHoldsId(txCan->Instance, frame))
+    {
+        return false;
+    }
+
+    return LoadCanTxMailbox(txChannel, frame);
 }
+#endif
+
+/**
+ * @brief Pass a received frame on, through its reserved RxQueue slot
+ * @param frame The received frame
+ * @param reserved true if frame is the slot returned by rxQueue->reserve()
+ * @param rxQueue RxQueue of the FIFO the frame came from
+ * @param fifo FIFO number (0 or 1)
+ * @param stats Statistics of that FIFO, may be nullptr
+ *
+ * In CAN_CUT_THROUGH builds a passthrough frame from FIFO0 may be sent
+ * straight away instead; its reservation is then abandoned.
+ */
+static void DeliverRxFrame(CAN_FRAME *frame, bool reserved, CanRxQueue *rxQueue, uint8_t fifo, RxFifoStats *stats)
+{
+#ifdef CAN_CUT_THROUGH
+    if (fifo == 0 && CutThrough(frame, rxQueue))
+    {
+        if (stats != nullptr)
+        {
+            stats->onCutThrough();
+        }
+        return;
+    }
+#else
+    (void)frame;
+    (void)fifo;
+    (void)stats;
+#endif
+
+    if (reserved)
+    {
+        rxQueue->commit();
+    }
+}
+
 /**
  * @brief Common implementation for CAN RX message handling
  * @param channel CAN channel index (0 for CAN1, 1 for CAN2)
  * @param canChan CAN handle
  * @param fifo FIFO number (CAN_RX_FIFO0 or CAN_RX_FIFO1)
+ * @param rxQueue RxQueue of that FIFO
+ * @param stats Statistics of that FIFO, may be nullptr
+ * @return true if a message was read from the FIFO
  */
-static void HandleCanRxMessage(uint8_t channel, CAN_HandleTypeDef *canChan, uint32_t fifo)
+static bool HandleCanRxMessage(uint8_t channel, CAN_HandleTypeDef *canChan, uint32_t fifo,
+                               CanRxQueue *rxQueue, RxFifoStats *stats)
 {
     CAN_RxHeaderTypeDef rxHeader;
-    CAN_FRAME frame;
+    CAN_FRAME overflow;
+
+    // Receive straight into the next RxQueue slot. If the queue is full the
+    // message is still read, into a scratch frame, to release the FIFO, and
+    // the failed reserve() is counted as a drop in the RxQueue statistics.
+    CAN_FRAME *frame = (rxQueue != nullptr) ? rxQueue->reserve() : nullptr;
+    if (frame == nullptr)
+    {
+        frame = &overflow;
+    }
+    FrameStampReceived(frame);
+
+    if (HAL_CAN_GetRxMessage(canChan, fifo, &rxHeader, frame->data) == HAL_OK)
+    {
+        frame->ID = (rxHeader.IDE == CAN_ID_EXT) ? rxHeader.ExtId : rxHeader.StdId;
+        frame->dlc = rxHeader.DLC;
+        frame->ide = rxHeader.IDE;
+        frame->rtr = rxHeader.RTR;
+        frame->rx_channel = channel;
+
+        uint8_t fifoIndex = (fifo == CAN_RX_FIFO0) ? 0 : 1;
+        FrameStampRxTime(frame, channel, fifoIndex, (uint16_t)rxHeader.Timestamp);
+        DeliverRxFrame(frame, frame != &overflow, rxQueue, fifoIndex, stats);
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Move every message pending in a FIFO into the RxQueue
+ * @param channel CAN channel index (0 for CAN1, 1 for CAN2)
+ * @param canChan CAN handle
+ * @param fifo FIFO number (CAN_RX_FIFO0 or CAN_RX_FIFO1)
+ *
+ * Frames that arrive while the FIFO is being drained are read by the same
+ * interrupt. The loop stops after UINT8_MAX frames, or if HAL refuses a
+ * read, so a flooded or failing controller cannot hold the interrupt.
+ */
+static void DrainCanRxFifo(uint8_t channel, CAN_HandleTypeDef *canChan, uint32_t fifo)
+{
+    uint32_t start = CycleCounter::now();
+    uint8_t fifoIndex = (fifo == CAN_RX_FIFO0) ? 0 : 1;
+    CanRxQueue *rxQueue = GetRxQueue(fifoIndex);
+    RxFifoStats *stats = GetRxFifoStats(channel, fifoIndex);
+    uint8_t frames = 0;
+
+    CheckRxFifoLoss(canChan->Instance, fifoIndex, rxQueue, stats);
+
+    while (HAL_CAN_GetRxFifoFillLevel(canChan, fifo) > 0 && frames < UINT8_MAX)
+    {
+        if (!HandleCanRxMessage(channel, canChan, fifo, rxQueue, stats))
+        {
+            break;
+        }
+        frames++;
+    }
+
+    if (frames > 0)
+    {
+        SignalCanRxWork();
+    }
+    if (stats != nullptr)
+    {
+        stats->onIrq(frames);
+    }
+    ProfileCanRxIrq(fifoIndex, CycleCounter::now() - start);
+}
+
+/**
+ * @brief Abort a controller's TX mailboxes and start its recovery from bus-off
+ * @param can Controller registers
+ * @return Number of mailboxes that held a frame
+ *
+ * With automatic bus-off management disabled, bxCAN stays off the bus
+ * until software takes it through initialization mode. Doing that straight
+ * from the interrupt starts the recovery, 128 occurrences of 11 recessive
+ * bits, at once. The mailboxes are aborted first, so frames that waited
+ * out the bus-off are not sent late.
+ */
+static uint8_t RestartAfterBusOff(CAN_TypeDef *can)
+{
+    uint8_t pending = 0;
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        if ((can->TSR & (CAN_TSR_TME0 << i)) == 0)
+        {
+            pending++;
+        }
+    }
+    // The other TSR bits are cleared by writing 1, so a plain write
+    can->TSR = CAN_TSR_ABRQ0 | CAN_TSR_ABRQ1 | CAN_TSR_ABRQ2;
+
+    can->MCR |= CAN_MCR_INRQ;
+    for (uint16_t spins = 0; (can->MSR & CAN_MSR_INAK) == 0 && spins < CAN_INIT_ACK_SPINS; spins++)
+    {
+    }
+    // Leaving initialization mode does not wait for the bus; the recovery
+    // carries on in the controller
+    can->MCR &= ~CAN_MCR_INRQ;
+    return pending;
+}
+
+/**
+ * @brief Count the errors HAL reported for a controller and handle a bus-off
+ * @param channel CAN channel index (0 for CAN1, 1 for CAN2)
+ * @param canChan CAN handle
+ *
+ * HAL services the error interrupt flag in whichever of the controller's
+ * interrupts at CAN_IRQ_PRIORITY runs first (the RX1 interrupts never call
+ * HAL_CAN_IRQHandler()), decodes the last error code into hcan->ErrorCode
+ * and clears it, so the errors are taken from there and ErrorCode is
+ * cleared for the next report. Transmit errors HAL reports there too are
+ * left to the mailbox handling; the error warning and passive interrupts
+ * are not enabled, the states are polled (see CanErrorMonitor).
+ *
+ * Running at CAN_IRQ_PRIORITY, the restart is held off while the main loop
+ * loads a mailbox (LockTxMailboxes() in main.cpp), so it cannot abort the
+ * mailboxes between the loop's onBus() check and its load.
+ */
+static void HandleCanError(uint8_t channel, CAN_HandleTypeDef *canChan)
+{
+    static const struct
+    {
+        uint32_t halError;
+        CanErrorMonitor::ErrorCode code;
+    } LAST_ERROR_CODES[] = {
+        {HAL_CAN_ERROR_STF, CanErrorMonitor::ERROR_STUFF},
+        {HAL_CAN_ERROR_FOR, CanErrorMonitor::ERROR_FORM},
+        {HAL_CAN_ERROR_ACK, CanErrorMonitor::ERROR_ACK},
+        {HAL_CAN_ERROR_BR, CanErrorMonitor::ERROR_BIT_RECESSIVE},
+        {HAL_CAN_ERROR_BD, CanErrorMonitor::ERROR_BIT_DOMINANT},
+        {HAL_CAN_ERROR_CRC, CanErrorMonitor::ERROR_CRC},
+    };
+
+    uint32_t errors = canChan->ErrorCode;
+    canChan->ErrorCode = HAL_CAN_ERROR_NONE;
 
-    if (HAL_CAN_GetRxMessage(canChan, fifo, &rxHeader, frame.data) == HAL_OK)
+    CanErrorMonitor *monitor = GetCanErrorMonitor(channel);
+    if (monitor == nullptr)
     {
-        frame.ID = rxHeader.StdId;
-        frame.dlc = rxHeader.DLC;
-        frame.ide = rxHeader.IDE;
-        frame.rtr = rxHeader.RTR;
-        frame.rx_channel = channel;
+        return;
+    }
 
-        CanQueue<QUEUE_CAPACITY> *rxQueue = GetRxQueue();
-        if (rxQueue != nullptr)
+    for (uint8_t i = 0; i < sizeof(LAST_ERROR_CODES) / sizeof(LAST_ERROR_CODES[0]); i++)
+    {
+        if ((errors & LAST_ERROR_CODES[i].halError) != 0)
         {
-            rxQueue->push(frame);
+            monitor->onError(LAST_ERROR_CODES[i].code);
         }
     }
+
+    // Once per bus-off: a later report while still recovering is the same one
+    if ((errors & HAL_CAN_ERROR_BOF) != 0 && monitor->onBus())
+    {
+        uint8_t aborted = RestartAfterBusOff(canChan->Instance);
+        monitor->onBusOff(HAL_GetTick(), aborted);
+    }
 }
 
 extern "C"
@@ -49,31 +399,124 @@ extern "C"
      */
     void HAL_CAN_RxFIFO0MsgPendingCallback1(CAN_HandleTypeDef *canChan)
     {
-        HandleCanRxMessage(0, canChan, CAN_RX_FIFO0);
+        DrainCanRxFifo(0, canChan, CAN_RX_FIFO0);
     }
 
     /**
-     * @brief CAN1 FIFO1 message pending callback
+     * @brief CAN2 FIFO0 message pending callback
      */
-    void HAL_CAN_RxFIFO1MsgPendingCallback1(CAN_HandleTypeDef *canChan)
+    void HAL_CAN_RxFIFO0MsgPendingCallback2(CAN_HandleTypeDef *canChan)
     {
-        HandleCanRxMessage(0, canChan, CAN_RX_FIFO1);
+        DrainCanRxFifo(1, canChan, CAN_RX_FIFO0);
     }
 
     /**
-     * @brief CAN2 FIFO0 message pending callback
+     * @brief FIFO1 RX interrupt handler, used instead of HAL_CAN_IRQHandler()
+     * @param channel CAN channel index (0 for CAN1, 1 for CAN2)
+     * @param canChan CAN handle
+     *
+     * The RX1 interrupts preempt the controller's other interrupts (see
+     * can.h), so they drain FIFO1 and nothing else. HAL_CAN_IRQHandler()
+     * would service every pending source of the controller, running the
+     * FIFO0, TX mailbox and error callbacks above their priority. No FIFO1
+     * callback is registered with HAL, so the other vectors leave FIFO1 alone.
      */
-    void HAL_CAN_RxFIFO0MsgPendingCallback2(CAN_HandleTypeDef *canChan)
+    void CanRxFifo1IRQHandler(uint8_t channel, CAN_HandleTypeDef *canChan)
     {
-        HandleCanRxMessage(1, canChan, CAN_RX_FIFO0);
+        DrainCanRxFifo(channel, canChan, CAN_RX_FIFO1);
     }
 
     /**
-     * @brief CAN2 FIFO1 message pending callback
+     * @brief CAN1 TX mailbox complete callback, for all three mailboxes
      */
-    void HAL_CAN_RxFIFO1MsgPendingCallback2(CAN_HandleTypeDef *canChan)
+    void HAL_CAN_TxMailboxCompleteCallback1(CAN_HandleTypeDef *canChan)
     {
-        HandleCanRxMessage(1, canChan, CAN_RX_FIFO1);
+        (void)canChan;
+        RefillCanTxMailboxes(0);
+    }
+
+    /**
+     * @brief CAN2 TX mailbox complete callback, for all three mailboxes
+     */
+    void HAL_CAN_TxMailboxCompleteCallback2(CAN_HandleTypeDef *canChan)
+    {
+        (void)canChan;
+        RefillCanTxMailboxes(1);
+    }
+
+    /**
+     * @brief CAN1 error callback
+     */
+    void HAL_CAN_ErrorCallback1(CAN_HandleTypeDef *canChan)
+    {
+        HandleCanError(0, canChan);
+    }
+
+    /**
+     * @brief CAN2 error callback
+     */
+    void HAL_CAN_ErrorCallback2(CAN_HandleTypeDef *canChan)
+    {
+        HandleCanError(1, canChan);
+    }
+
+#ifdef CAN_RX_DIRECT
+    /**
+     * @brief Register-level RX interrupt handler, used instead of HAL_CAN_IRQHandler()
+     * @param channel CAN channel index (0 for CAN1, 1 for CAN2)
+     * @param can Controller registers (CAN1 or CAN2)
+     * @param fifo FIFO number (0 or 1)
+     *
+     * Drains the FIFO like DrainCanRxFifo(), but copies each message from
+     * the output mailbox registers straight into its RxQueue slot and
+     * releases it by writing RFOM, without HAL's state and parameter checks.
+     * Only the message pending interrupt is enabled for the RX FIFOs; the
+     * full and overrun flags are polled, as in DrainCanRxFifo().
+     */
+    void CanRxDirectIRQHandler(uint8_t channel, CAN_TypeDef *can, uint8_t fifo)
+    {
+        uint32_t start = CycleCounter::now();
+        // RF0R and RF1R have the same layout
+        volatile uint32_t *rfr = (fifo == 0) ? &can->RF0R : &can->RF1R;
+        const CAN_FIFOMailBox_TypeDef *mailbox = &can->sFIFOMailBox[fifo];
+        CanRxQueue *rxQueue = GetRxQueue(fifo);
+        RxFifoStats *stats = GetRxFifoStats(channel, fifo);
+        uint8_t frames = 0;
+
+        CheckRxFifoLoss(can, fifo, rxQueue, stats);
+
+        while ((*rfr & CAN_RF0R_FMP0) != 0 && frames < UINT8_MAX)
+        {
+            // As HandleCanRxMessage(): a full queue still releases the message
+            CAN_FRAME overflow;
+            CAN_FRAME *frame = (rxQueue != nullptr) ? rxQueue->reserve() : nullptr;
+            if (frame == nullptr)
+            {
+                frame = &overflow;
+            }
+            FrameStampReceived(frame);
+
+            uint32_t rdtr = mailbox->RDTR;
+            CanRxMailboxDecode(mailbox->RIR, rdtr, mailbox->RDLR, mailbox->RDHR, channel, frame);
+            FrameStampRxTime(frame, channel, fifo, (uint16_t)(rdtr >> CAN_RDT0R_TIME_Pos));
+
+            // Plain write: the other RFxR bits are cleared by writing 1
+            *rfr = CAN_RF0R_RFOM0;
+
+            DeliverRxFrame(frame, frame != &overflow, rxQueue, fifo, stats);
+            frames++;
+        }
+
+        if (frames > 0)
+        {
+            SignalCanRxWork();
+        }
+        if (stats != nullptr)
+        {
+            stats->onIrq(frames);
+        }
+        ProfileCanRxIrq(fifo, CycleCounter::now() - start);
     }
+#endif
 
 } // extern "C"
@@ -0,0 +1,53 @@
+/**
+ * @file can_filters.cpp
+ * @brief CAN acceptance filter configuration
+ *
+ * Programs the filter banks from CanFilterTable, built from the App's list
+ * of handled IDs: those frames are received into FIFO1, everything else
+ * into FIFO0.
+ */
+
+#include "can.h"
+#include "App.h"
+#include "CanFilterTable.h"
+
+extern "C"
+{
+
+    /**
+     * @brief Program the filter banks of one controller
+     * @param canHandle CAN handle (hcan1 or hcan2)
+     *
+     * CAN1 uses banks 0-13 and CAN2 banks 14-27 of the shared filter bank
+     * array, so both controllers get the same routing.
+     */
+    void ConfigureCanFilters(CAN_HandleTypeDef *canHandle)
+    {
+        const CanFilterTable<APP_HANDLED_ID_COUNT> table(APP_HANDLED_IDS);
+        uint8_t firstBank = (canHandle->Instance == CAN2) ? CAN_FILTER_BANKS_PER_CHANNEL : 0;
+
+        for (uint8_t i = 0; i < table.bankCount(); i++)
+        {
+            const CanFilterBank &bank = table.bank(i);
+            CAN_FilterTypeDef sFilterConfig;
+
+            sFilterConfig.FilterBank = firstBank + i;
+            sFilterConfig.FilterMode = bank.listMode ? CAN_FILTERMODE_IDLIST : CAN_FILTERMODE_IDMASK;
+            sFilterConfig.FilterScale = CAN_FILTERSCALE_32BIT;
+            sFilterConfig.FilterIdHigh = (bank.fr1 >> 16) & 0xFFFF;
+            sFilterConfig.FilterIdLow = bank.fr1 & 0xFFFF;
+            sFilterConfig.FilterMaskIdHigh = (bank.fr2 >> 16) & 0xFFFF;
+            sFilterConfig.FilterMaskIdLow = bank.fr2 & 0xFFFF;
+            sFilterConfig.FilterFIFOAssignment = (bank.fifo == 1) ? CAN_FILTER_FIFO1 : CAN_FILTER_FIFO0;
+            sFilterConfig.FilterActivation = CAN_FILTER_ENABLE;
+            sFilterConfig.SlaveStartFilterBank = CAN_FILTER_BANKS_PER_CHANNEL;
+
+            if (HAL_CAN_ConfigFilter(canHandle, &sFilterConfig) != HAL_OK)
+            {
+                /* Filter configuration Error */
+                Error_Handler();
+            }
+        }
+    }
+
+} // extern "C"
@@ -23,34 +23,127 @@
 #include "gpio.h"
 #include <stdint.h>
 #include "can_types.h"
-#include "CanQueue.h"
+#include "CanRxQueue.h"
+#include "CanTxQueue.h"
 #include "App.h"
+#include "Diagnostics.h"
+#include "CycleCounter.h"
+#include "FrameTimestamp.h"
+#include "LatencyStats.h"
+#include "LatencyHistogram.h"
+#include "RxFifoStats.h"
+#include "CanTxMailbox.h"
+#include "MainLoopEvents.h"
+#include "CpuProfile.h"
+#include "LoopMonitor.h"
+#include "CanErrorMonitor.h"
 #include "utility.h"
 #include <stm32f1xx_hal_rcc_ex.h>
 
 // CAN Queue instances
-static CanQueue<QUEUE_CAPACITY> g_rxQueue;
-static CanQueue<QUEUE_CAPACITY> g_TxQueue;
+// Each RxQueue is filled by the RX ISRs of one bxCAN FIFO and drained here,
+// lock-free. The FIFO0 (passthrough) and FIFO1 (App handled IDs) interrupts
+// each share one preemption priority (see can.h), and only the RX1 vectors
+// drain FIFO1, so the ISRs feeding a queue can never interrupt each other
+// and act as a single producer.
+static CanRxQueue g_rxQueue;
+static CanRxQueue g_rxPriorityQueue;
+// TxQueue has one lane per CAN channel, each serviced independently
+static CanTxQueue g_TxQueue;
+// Frames taken from each lane, ready for the TX mailbox empty interrupt.
+// Filled by the main loop, emptied by that interrupt, lock-free.
+static CanTxStage g_txStage[CAN_CHANNEL_COUNT];
 // Create App
 BatteryModel g_batteryModel(BATTERY_PACK_AH_CAPACITY);
-App g_app(&g_TxQueue, &g_batteryModel);
+// Receive to TX mailbox latency of forwarded frames, per TX channel
+static LatencyStats g_txLatency[CAN_CHANNEL_COUNT];
+#ifdef CAN_FRAME_TIMESTAMPS
+// The same per forwarding stage, as histograms for the tail; the App keeps
+// the stage in between. Both TX mailbox empty interrupts write the mailbox
+// stage, which is safe as they share CAN_IRQ_PRIORITY (see LockTxMailboxes())
+static LatencyHistogram g_dispatchLatency;
+static LatencyHistogram g_mailboxLatency;
+// Copies of the statistics those interrupts write, taken by the main loop
+// under LockTxMailboxes() for Diagnostics, so it never reads one half updated
+static LatencyStats g_txLatencyCopy[CAN_CHANNEL_COUNT];
+static LatencyHistogram g_mailboxLatencyCopy;
+#endif
+// Frames drained per RX interrupt and hardware FIFO losses, per channel and FIFO
+static RxFifoStats g_rxFifoStats[CAN_CHANNEL_COUNT][CAN_RX_FIFO_COUNT];
+// Work left for the main loop by the interrupts, and how the loop keeps up
+static MainLoopEvents g_events;
+static CpuProfile g_cpuProfile;
+// Stage budgets and the watchdog; the record of the stage running and the
+// worst overrun is in .noinit, so it survives a reset for the next start-up
+static LoopMonitor g_loopMonitor;
+__attribute__((section(".noinit"))) static LoopMonitor::Record g_stallRecord;
+// Bus errors and bus-offs, per controller. While one is off the bus the
+// frames queued for it are dropped, see ProcessCanTxChannel()
+static CanErrorMonitor g_canErrors[CAN_CHANNEL_COUNT];
+static LatencyStats g_wakeLatency;
+static uint32_t g_awakeSince = 0;
+Diagnostics g_diagnostics;
+App g_app(&g_TxQueue, &g_batteryModel, &g_diagnostics);
 uint32_t g_lastTickTime = 0;
 
 // Function prototypes
 void SystemClock_Config(void);
 void InitializeHardware(void);
 void ProcessCanRx(void);
+void ProcessCanRxQueue(CanRxQueue &queue);
 void ProcessCanTx(void);
+void ProcessCanTxChannel(uint8_t channel, CAN_HandleTypeDef *canChan);
 void ProcessTick(void);
+void WaitForWork(void);
+void FeedWatchdog(void);
 
 // CAN callbacks (defined in can_callbacks.cpp)
 extern "C"
 {
     void HAL_CAN_RxFIFO0MsgPendingCallback1(CAN_HandleTypeDef *canChan);
-    void HAL_CAN_RxFIFO1MsgPendingCallback1(CAN_HandleTypeDef *canChan);
     void HAL_CAN_RxFIFO0MsgPendingCallback2(CAN_HandleTypeDef *canChan);
-    void HAL_CAN_RxFIFO1MsgPendingCallback2(CAN_HandleTypeDef *canChan);
+    void HAL_CAN_TxMailboxCompleteCallback1(CAN_HandleTypeDef *canChan);
+    void HAL_CAN_TxMailboxCompleteCallback2(CAN_HandleTypeDef *canChan);
+    void HAL_CAN_ErrorCallback1(CAN_HandleTypeDef *canChan);
+    void HAL_CAN_ErrorCallback2(CAN_HandleTypeDef *canChan);
+}
+
+#ifdef CAN_PENDSV_PROCESSING
+/**
+ * @brief Request a run of ProcessDeferredWork()
+ *
+ * PendSV runs as soon as no higher priority interrupt is active, straight
+ * after the CAN interrupt that pends it (tail-chained), or when the main
+ * loop calls UnlockDeferredWork().
+ */
+static inline void PendDeferredWork(void)
+{
+    SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+}
+
+/**
+ * @brief Keep PendSV from running while the main loop uses the App or the TxQueue
+ * @return Previous BASEPRI, to pass to UnlockDeferredWork()
+ *
+ * Masks CAN_DEFERRED_IRQ_PRIORITY only, so the CAN interrupts keep
+ * capturing frames meanwhile.
+ */
+static inline uint32_t LockDeferredWork(void)
+{
+    uint32_t basepri = __get_BASEPRI();
+    __set_BASEPRI(CAN_DEFERRED_IRQ_PRIORITY << (8U - __NVIC_PRIO_BITS));
+    return basepri;
+}
+
+/**
+ * @brief Undo LockDeferredWork()
+ * @param basepri Value returned by LockDeferredWork()
+ */
+static inline void UnlockDeferredWork(uint32_t basepri)
+{
+    __set_BASEPRI(basepri);
 }
+#endif
 
 /**
  * @brief Main program entry point
@@ -61,21 +154,59 @@ int main(void)
     InitializeHardware();
 
     g_lastTickTime = HAL_GetTick();
+    g_awakeSince = CycleCounter::now();
 
-    // Main loop
+    // Main loop, sleeping until an interrupt leaves work for it
     while (1)
     {
-        // Process received CAN frames
-        ProcessCanRx();
+        WaitForWork();
+        uint32_t iterationStart = CycleCounter::now();
 
-        // Process transmit CAN frames
-        ProcessCanTx();
+#ifdef CAN_PENDSV_PROCESSING
+        // Frames are handled in PendSV (ProcessDeferredWork()), only the
+        // background work of the time tick is left here
+        if (g_events.take(MainLoopEvents::EVENT_TICK))
+        {
+            uint32_t basepri = LockDeferredWork();
+            ProcessTick();
+            UnlockDeferredWork(basepri);
+
+            // Send what the App queued (heartbeat, diagnostics)
+            PendDeferredWork();
+        }
+#else
+        // Time from the interrupt that left the oldest work to picking it up
+        uint32_t waited;
+        if (g_events.waitedSince(CycleCounter::now(), &waited))
+        {
+            g_wakeLatency.record(waited);
+        }
+
+        bool rx = g_events.take(MainLoopEvents::EVENT_CAN_RX);
+        bool tx = g_events.take(MainLoopEvents::EVENT_CAN_TX);
+        bool tick = g_events.take(MainLoopEvents::EVENT_TICK);
+
+        // Process received CAN frames
+        if (rx)
+        {
+            ProcessCanRx();
+        }
 
         // Process time tick
-        ProcessTick();
+        if (tick)
+        {
+            ProcessTick();
+        }
+
+        // Process transmit CAN frames, including any the App just queued
+        if (rx || tx || tick)
+        {
+            ProcessCanTx();
+        }
+#endif
 
-        // Optional: Refresh watchdog
-        // HAL_IWDG_Refresh(&hiwdg);
+        g_loopMonitor.iterationDone(CycleCounter::now() - iterationStart);
+        FeedWatchdog();
     }
 }
 
@@ -87,132 +218,426 @@ void InitializeHardware(void)
     // Reset of all peripherals, Initializes the Flash interface and the Systick
     HAL_Init();
 
+#ifdef CAN_PENDSV_PROCESSING
+    // Below every CAN interrupt, which pend it
+    HAL_NVIC_SetPriority(PendSV_IRQn, CAN_DEFERRED_IRQ_PRIORITY, 0);
+#endif
+
     // Configure the system clock
     SystemClock_Config();
 
+    // Start the DWT cycle counter used for timestamps and profiling
+    CycleCounter::init();
+
+    // Pick up the stall record the last run left, then start a new one
+    bool watchdogReset = __HAL_RCC_GET_FLAG(RCC_FLAG_IWDGRST) != 0;
+    __HAL_RCC_CLEAR_RESET_FLAGS();
+    g_loopMonitor.start(&g_stallRecord, watchdogReset, HAL_GetTick());
+
     // Initialize peripherals
     MX_GPIO_Init();
     MX_CAN1_Init();
     MX_CAN2_Init();
 
-    // Optional: Initialize watchdog
-    // MX_IWDG_Init();
+    // Start the watchdog, held while the core is halted by a debugger.
+    // FeedWatchdog() refreshes it while the main loop stays healthy.
+    __HAL_DBGMCU_FREEZE_IWDG();
+    MX_IWDG_Init();
 
-    // Register CAN callbacks - using callbacks for RxQueue integration
+    // Register CAN callbacks - RX callbacks fill the FIFO0 RxQueue, TX mailbox
+    // complete callbacks refill the mailboxes from the TX stages. FIFO1 has
+    // no HAL callback, its interrupts drain it themselves (can_callbacks.cpp)
     HAL_CAN_RegisterCallback(&hcan1, HAL_CAN_RX_FIFO0_MSG_PENDING_CB_ID, HAL_CAN_RxFIFO0MsgPendingCallback1);
-    HAL_CAN_RegisterCallback(&hcan1, HAL_CAN_RX_FIFO1_MSG_PENDING_CB_ID, HAL_CAN_RxFIFO1MsgPendingCallback1);
     HAL_CAN_RegisterCallback(&hcan2, HAL_CAN_RX_FIFO0_MSG_PENDING_CB_ID, HAL_CAN_RxFIFO0MsgPendingCallback2);
-    HAL_CAN_RegisterCallback(&hcan2, HAL_CAN_RX_FIFO1_MSG_PENDING_CB_ID, HAL_CAN_RxFIFO1MsgPendingCallback2);
-
-    // Activate CAN notifications
+    HAL_CAN_RegisterCallback(&hcan1, HAL_CAN_TX_MAILBOX0_COMPLETE_CB_ID, HAL_CAN_TxMailboxCompleteCallback1);
+    HAL_CAN_RegisterCallback(&hcan1, HAL_CAN_TX_MAILBOX1_COMPLETE_CB_ID, HAL_CAN_TxMailboxCompleteCallback1);
+    HAL_CAN_RegisterCallback(&hcan1, HAL_CAN_TX_MAILBOX2_COMPLETE_CB_ID, HAL_CAN_TxMailboxCompleteCallback1);
+    HAL_CAN_RegisterCallback(&hcan2, HAL_CAN_TX_MAILBOX0_COMPLETE_CB_ID, HAL_CAN_TxMailboxCompleteCallback2);
+    HAL_CAN_RegisterCallback(&hcan2, HAL_CAN_TX_MAILBOX1_COMPLETE_CB_ID, HAL_CAN_TxMailboxCompleteCallback2);
+    HAL_CAN_RegisterCallback(&hcan2, HAL_CAN_TX_MAILBOX2_COMPLETE_CB_ID, HAL_CAN_TxMailboxCompleteCallback2);
+    // Error callbacks count bus errors and restart a controller after bus-off
+    HAL_CAN_RegisterCallback(&hcan1, HAL_CAN_ERROR_CB_ID, HAL_CAN_ErrorCallback1);
+    HAL_CAN_RegisterCallback(&hcan2, HAL_CAN_ERROR_CB_ID, HAL_CAN_ErrorCallback2);
+
+    // Activate CAN notifications. Every bus error is reported, by its last
+    // error code, and bus-off; the error states are polled by ProcessTick()
     HAL_CAN_ActivateNotification(&hcan1, CAN_IT_RX_FIFO0_MSG_PENDING | CAN_IT_RX_FIFO1_MSG_PENDING);
     HAL_CAN_ActivateNotification(&hcan2, CAN_IT_RX_FIFO0_MSG_PENDING | CAN_IT_RX_FIFO1_MSG_PENDING);
+    HAL_CAN_ActivateNotification(&hcan1, CAN_IT_ERROR | CAN_IT_LAST_ERROR_CODE | CAN_IT_BUSOFF);
+    HAL_CAN_ActivateNotification(&hcan2, CAN_IT_ERROR | CAN_IT_LAST_ERROR_CODE | CAN_IT_BUSOFF);
 
     // Add CAN filters
     AddCANFilters(&hcan1);
     AddCANFilters(&hcan2);
+
+    // Report queue statistics in the 0x721 diagnostic pages
+    g_diagnostics.setQueueStats(Diagnostics::QUEUE_RX, queueStatsOf(g_rxQueue.stats()));
+    g_diagnostics.setQueueStats(Diagnostics::QUEUE_RX_PRIORITY, queueStatsOf(g_rxPriorityQueue.stats()));
+    g_diagnostics.setQueueStats(Diagnostics::QUEUE_TX_CAN1, queueStatsOf(g_TxQueue.lane(0).stats()));
+    g_diagnostics.setQueueStats(Diagnostics::QUEUE_TX_CAN2, queueStatsOf(g_TxQueue.lane(1).stats()));
+    g_diagnostics.setMainLoopStats(&g_cpuProfile.idle(), &g_wakeLatency);
+    g_diagnostics.setCpuProfile(&g_cpuProfile);
+    g_diagnostics.setLoopMonitor(&g_loopMonitor);
+    g_diagnostics.setCanErrorMonitor(0, &g_canErrors[0]);
+    g_diagnostics.setCanErrorMonitor(1, &g_canErrors[1]);
+    g_app.setCpuProfile(&g_cpuProfile);
+#ifdef CAN_FRAME_TIMESTAMPS
+    g_diagnostics.setLatencyStats(0, &g_txLatencyCopy[0]);
+    g_diagnostics.setLatencyStats(1, &g_txLatencyCopy[1]);
+    g_diagnostics.setLatencyHistogram(Diagnostics::HISTOGRAM_RX_TO_DISPATCH, &g_dispatchLatency);
+    g_diagnostics.setLatencyHistogram(Diagnostics::HISTOGRAM_ENQUEUE_TO_MAILBOX, &g_mailboxLatencyCopy);
+#endif
+    for (uint8_t channel = 0; channel < CAN_CHANNEL_COUNT; channel++)
+    {
+        for (uint8_t fifo = 0; fifo < CAN_RX_FIFO_COUNT; fifo++)
+        {
+            g_diagnostics.setRxFifoStats(channel, fifo, &g_rxFifoStats[channel][fifo]);
+            g_diagnostics.setRxLossStats(channel, fifo, &g_rxFifoStats[channel][fifo]);
+        }
+#ifdef CAN_CUT_THROUGH
+        // Passthrough frames arrive in FIFO0
+        g_diagnostics.setCutThroughStats(channel, &g_rxFifoStats[channel][0]);
+#endif
+    }
 }
 
 /**
- * @brief Safely pop a CAN frame from the given queue with interrupts disabled
- * @param queue The CAN queue to pop from
- * @param frame Pointer to store the popped CAN frame
- * @return true if a frame was popped, false if the queue was empty
+ * @brief Sleep until an interrupt leaves work for the main loop
+ *
+ * Interrupts are disabled while checking for work, so one that arrives
+ * after the check still ends the WFI: a pending interrupt wakes the core
+ * even when masked by PRIMASK, and is taken once they are enabled again.
+ * The time awake since the last sleep goes to the CPU profile, which
+ * keeps the idle statistics.
  */
-inline bool SafePopCanQueue(CanQueue<QUEUE_CAPACITY> &queue, CAN_FRAME *frame)
+void WaitForWork(void)
 {
     __disable_irq();
-    bool result = queue.pop(frame);
+    if (!g_events.anyPending())
+    {
+        g_cpuProfile.addAwake(CycleCounter::now() - g_awakeSince);
+        __WFI();
+        g_awakeSince = CycleCounter::now();
+    }
     __enable_irq();
-    return result;
+
+    g_cpuProfile.update(HAL_GetTick());
+}
+
+/**
+ * @brief Refresh the watchdog if the main loop has kept within its budgets
+ *
+ * Work still waiting for its stage counts against the check interval, so
+ * a stage that is never reached, not only one that overruns, holds the
+ * refresh back. In CAN_PENDSV_PROCESSING builds PendSV, which runs the RX
+ * and TX stages, is masked meanwhile.
+ */
+void FeedWatchdog(void)
+{
+#ifdef CAN_PENDSV_PROCESSING
+    uint32_t basepri = LockDeferredWork();
+#endif
+    uint32_t now = CycleCounter::now();
+    uint32_t waited;
+    if (g_events.waitedSince(MainLoopEvents::EVENT_CAN_RX, now, &waited))
+    {
+        g_loopMonitor.stageWaiting(LoopMonitor::STAGE_RX, waited);
+    }
+    if (g_events.waitedSince(MainLoopEvents::EVENT_CAN_TX, now, &waited))
+    {
+        g_loopMonitor.stageWaiting(LoopMonitor::STAGE_TX, waited);
+    }
+    if (g_loopMonitor.feedDue(HAL_GetTick()))
+    {
+        HAL_IWDG_Refresh(&hiwdg);
+    }
+#ifdef CAN_PENDSV_PROCESSING
+    UnlockDeferredWork(basepri);
+#endif
 }
 
 /**
- * @brief Process received CAN frames from RxQueue
+ * @brief Process received CAN frames from both RxQueues
+ *
+ * Frames the App handles, received through FIFO1, are processed before
+ * passthrough traffic.
  */
 void ProcessCanRx(void)
 {
-    CAN_FRAME frame;
+    uint32_t start = CycleCounter::now();
+    g_loopMonitor.beginStage(LoopMonitor::STAGE_RX);
+    ProcessCanRxQueue(g_rxPriorityQueue);
+    ProcessCanRxQueue(g_rxQueue);
+    uint32_t cycles = CycleCounter::now() - start;
+    g_cpuProfile.add(CpuProfile::SECTION_PROCESS_RX, cycles);
+    g_loopMonitor.endStage(LoopMonitor::STAGE_RX, cycles);
+}
 
-    // Process all available frames in RxQueue
-    while (SafePopCanQueue(g_rxQueue, &frame))
+/**
+ * @brief Pass every frame in one RxQueue to the App
+ * @param queue RxQueue to drain
+ */
+void ProcessCanRxQueue(CanRxQueue &queue)
+{
+    CAN_FRAME *frames;
+    uint16_t count;
+
+    // Process all available frames in the queue, in place, one contiguous
+    // span at a time (a backlog that wraps the buffer takes two passes).
+    // The main loop is the only consumer, so no IRQ fence is needed.
+    while ((count = queue.frontSpan(&frames)) > 0)
     {
-        // Pass frame to App for processing
-        g_app.canMsgReceived(frame);
+#ifdef CAN_FRAME_TIMESTAMPS
+        // The whole span is handed over now
+        for (uint16_t i = 0; i < count; i++)
+        {
+            uint32_t latency;
+            if (FrameNextStage(&frames[i], &latency))
+            {
+                g_dispatchLatency.record(latency);
+            }
+        }
+#endif
+
+        // Pass frames to App for processing, then hand the slots back to the ISR
+        g_app.canMsgsReceived(frames, count);
+        queue.release(count);
     }
 }
 
 /**
- * @brief Process CAN frames to transmit from TxQueue
+ * @brief Load one frame into a free TX mailbox of a controller
+ * @param canChan CAN handle
+ * @param frame Frame to send
+ * @return true if the frame was loaded, false if no mailbox was free
+ *
+ * CAN_TX_DIRECT builds write the mailbox registers themselves (see
+ * CanTxMailbox.h); otherwise HAL_CAN_AddTxMessage() is used. Either way
+ * the caller must hold off the other contexts that load mailboxes.
  */
-void ProcessCanTx(void)
+static bool LoadTxMailbox(CAN_HandleTypeDef *canChan, CAN_FRAME *frame)
 {
-    CAN_FRAME frame;
+#ifdef CAN_TX_DIRECT
+    return CanTxMailboxLoad(canChan->Instance, *frame) >= 0;
+#else
+    if (HAL_CAN_GetTxMailboxesFreeLevel(canChan) == 0)
+    {
+        return false;
+    }
 
-    // Transmit all available frames in TxQueue
-    while (g_TxQueue.peek(&frame))
+    // Prepare CAN header
+    CAN_TxHeaderTypeDef header;
+    header.IDE = frame->ide;
+    header.StdId = frame->ID;
+    header.ExtId = frame->ID;
+    header.DLC = frame->dlc;
+    header.RTR = frame->rtr;
+    header.TransmitGlobalTime = DISABLE;
+
+    uint32_t mailbox;
+    return HAL_CAN_AddTxMessage(canChan, &header, frame->data, &mailbox) == HAL_OK;
+#endif
+}
+
+/**
+ * @brief Load a controller's free TX mailboxes from its TX stage
+ * @param channel CAN channel index (0 for CAN1, 1 for CAN2)
+ * @param canChan CAN handle for that channel
+ *
+ * Called from the TX mailbox empty interrupt, and from the main loop with
+ * that interrupt masked (LockTxMailboxes()), so it never runs twice at once.
+ * Nothing is loaded while the controller is off the bus.
+ */
+static void RefillTxMailboxes(uint8_t channel, CAN_HandleTypeDef *canChan)
+{
+    CanTxStage &stage = g_txStage[channel];
+    CAN_FRAME *frame;
+
+    while (g_canErrors[channel].onBus() && (frame = stage.front()) != nullptr)
     {
-        CAN_HandleTypeDef *canChan = &hcan1;
-        // Get CAN channel from frame
-        if (frame.tx_channel > 0)
+        // Transmit the frame, straight from the stage slot
+        if (!LoadTxMailbox(canChan, frame))
         {
-            canChan = &hcan2;
+            // No free mailbox, the next TX complete interrupt carries on
+            break;
         }
 
-        // Check if there are free TX mailboxes
-        if (HAL_CAN_GetTxMailboxesFreeLevel(canChan) > 0)
+        // Successfully queued for transmission. Measure how long a forwarded
+        // frame took from the RX ISR to here, then remove it from the stage
+        uint32_t latency;
+        if (FrameLatency(frame, &latency))
         {
-            // Prepare CAN header
-            CAN_TxHeaderTypeDef header;
-            header.IDE = frame.ide;
-            if (frame.ide)
-            {
-                header.ExtId = frame.ID;
-            }
-            else
-            {
-                header.StdId = frame.ID;
-            }
-
-            header.DLC = frame.dlc;
-            header.RTR = frame.rtr;
-
-            // Transmit the frame
-            uint32_t mailbox;
-            if (HAL_CAN_AddTxMessage(canChan, &header, frame.data, &mailbox) == HAL_OK)
-            {
-                // Successfully queued for transmission, remove from TxQueue
-                g_TxQueue.pop(&frame);
-            }
-            else
-            {
-                // Failed to add to mailbox, try again later
-                // exit the loop
-                break;
-            }
+            g_txLatency[channel].record(latency);
         }
-        else
+#ifdef CAN_FRAME_TIMESTAMPS
+        if (FrameNextStage(frame, &latency))
         {
-            // No free mailboxes, try again later
-            // exit the loop
-            break;
+            g_mailboxLatency.record(latency);
         }
+#endif
+        stage.release();
     }
 }
 
+/**
+ * @brief Keep the CAN interrupts that load TX mailboxes out of the main loop's way
+ * @return Previous BASEPRI, to pass to UnlockTxMailboxes()
+ *
+ * The TX mailbox empty interrupts refill mailboxes from the TX stage, and in
+ * CAN_CUT_THROUGH builds the FIFO0 RX interrupts load them too, and the
+ * error callbacks abort them on a bus-off. All of them run at
+ * CAN_IRQ_PRIORITY; masking that priority while the main loop loads a
+ * mailbox keeps them from taking the same one, consuming the same staged
+ * frame or restarting the controller between its onBus() check and the
+ * load. The FIFO1 interrupts, which never touch TX, are not held off.
+ */
+static inline uint32_t LockTxMailboxes(void)
+{
+    uint32_t basepri = __get_BASEPRI();
+    __set_BASEPRI(CAN_IRQ_PRIORITY << (8U - __NVIC_PRIO_BITS));
+    return basepri;
+}
+
+/**
+ * @brief Check that the running interrupt is one LockTxMailboxes() holds off
+ * @return true in an interrupt handler at CAN_IRQ_PRIORITY
+ *
+ * A mailbox loaded from any other interrupt could preempt the main loop
+ * while it holds the lock, and become a second consumer of the TX stage.
+ * Checked with assert_param(), so only in USE_FULL_ASSERT builds.
+ */
+static inline bool InTxMailboxIrq(void)
+{
+    uint32_t exception = __get_IPSR();
+    return exception >= 16 && NVIC_GetPriority((IRQn_Type)(exception - 16)) == CAN_IRQ_PRIORITY;
+}
+
+/**
+ * @brief Undo LockTxMailboxes()
+ * @param basepri Value returned by LockTxMailboxes()
+ */
+static inline void UnlockTxMailboxes(uint32_t basepri)
+{
+    __set_BASEPRI(basepri);
+}
+
+#ifdef CAN_FRAME_TIMESTAMPS
+/**
+ * @brief Copy the latency statistics of the TX mailbox empty interrupts for Diagnostics
+ *
+ * The interrupts keep recording into the originals; a LatencyStats sum
+ * is 64 bits wide, so reading it while one lands could mix two samples.
+ */
+static void CopyTxLatency(void)
+{
+    uint32_t basepri = LockTxMailboxes();
+    for (uint8_t channel = 0; channel < CAN_CHANNEL_COUNT; channel++)
+    {
+        g_txLatencyCopy[channel] = g_txLatency[channel];
+    }
+    g_mailboxLatencyCopy = g_mailboxLatency;
+    UnlockTxMailboxes(basepri);
+}
+#endif
+
+/**
+ * @brief Process CAN frames to transmit from TxQueue
+ *
+ * Each controller is fed from its own TxQueue lane, so a busy bus only
+ * delays frames waiting for that bus.
+ */
+void ProcessCanTx(void)
+{
+    uint32_t start = CycleCounter::now();
+    g_loopMonitor.beginStage(LoopMonitor::STAGE_TX);
+    ProcessCanTxChannel(0, &hcan1);
+    ProcessCanTxChannel(1, &hcan2);
+    uint32_t cycles = CycleCounter::now() - start;
+    g_cpuProfile.add(CpuProfile::SECTION_PROCESS_TX, cycles);
+    g_loopMonitor.endStage(LoopMonitor::STAGE_TX, cycles);
+}
+
+/**
+ * @brief Move frames from one TxQueue lane to its TX stage and kick the controller
+ * @param channel CAN channel index (0 for CAN1, 1 for CAN2)
+ * @param canChan CAN handle for that channel
+ *
+ * The TX mailbox empty interrupt refills a mailbox from the stage as soon
+ * as it is free, so back-to-back frames do not wait for the next main loop
+ * pass. The main loop only has to load mailboxes itself when they are free
+ * already, as no completion interrupt is then on its way.
+ *
+ * While the controller is off the bus after a bus-off, the lane and the
+ * stage are emptied instead, so the App keeps finding room for frames to
+ * the other bus and nothing stale is sent once the controller recovers.
+ */
+void ProcessCanTxChannel(uint8_t channel, CAN_HandleTypeDef *canChan)
+{
+    CanTxQueue::Lane &queue = g_TxQueue.lane(channel);
+    CanTxStage &stage = g_txStage[channel];
+    CAN_FRAME *frame;
+
+    if (!g_canErrors[channel].onBus())
+    {
+        uint16_t dropped = queue.length();
+        queue.clear();
+
+        // The stage belongs to the mailbox refill side, held off meanwhile
+        uint32_t basepri = LockTxMailboxes();
+        dropped += stage.length();
+        stage.clear();
+        UnlockTxMailboxes(basepri);
+
+        g_canErrors[channel].onDropped(dropped);
+        return;
+    }
+
+    // Stage frames from this lane, highest priority first. The stage is kept
+    // short, so a frame queued later waits behind at most CAN_TX_STAGE_DEPTH
+    // staged frames on top of the mailboxes.
+    CAN_FRAME *slot;
+    while ((frame = queue.front()) != nullptr && (slot = stage.reserve()) != nullptr)
+    {
+        *slot = *frame;
+        stage.commit();
+        queue.release();
+    }
+
+    uint32_t basepri = LockTxMailboxes();
+    RefillTxMailboxes(channel, canChan);
+    UnlockTxMailboxes(basepri);
+}
+
 /**
  * @brief Process periodic time tick for App
  */
 void ProcessTick(void)
 {
+    uint32_t start = CycleCounter::now();
+    g_loopMonitor.beginStage(LoopMonitor::STAGE_TICK);
+
     // Call time tick handler every 1ms
     uint32_t currentTime = HAL_GetTick();
     if ((currentTime != g_lastTickTime))
     {
         uint32_t diff = CalculateTickDifference(currentTime, g_lastTickTime);
         g_lastTickTime = currentTime;
+        g_rxQueue.sampleStats(diff);
+        g_rxPriorityQueue.sampleStats(diff);
+        g_TxQueue.sampleStats(diff);
+        g_canErrors[0].sample(&hcan1.Instance->ESR, diff, currentTime);
+        g_canErrors[1].sample(&hcan2.Instance->ESR, diff, currentTime);
+#ifdef CAN_FRAME_TIMESTAMPS
+        // Diagnostics pages are built from the App, by its timer tasks or
+        // for a request received before the next tick
+        CopyTxLatency();
+#endif
         g_app.timeTickMs(diff);
     }
+
+    uint32_t cycles = CycleCounter::now() - start;
+    g_cpuProfile.add(CpuProfile::SECTION_PROCESS_TICK, cycles);
+    g_loopMonitor.endStage(LoopMonitor::STAGE_TICK, cycles);
 }
 
 /**
@@ -274,18 +699,199 @@ void Error_Handler(void)
     HAL_NVIC_SystemReset();
 }
 
+#ifdef USE_FULL_ASSERT
+/**
+ * @brief  Reports the source file and line of a failed assert_param()
+ * @param  file Source file name
+ * @param  line Source line number
+ * @retval None
+ *
+ * Debug builds only. Stops here, with interrupts off, for the debugger.
+ */
+extern "C" void assert_failed(uint8_t *file, uint32_t line)
+{
+    (void)file;
+    (void)line;
+    __disable_irq();
+    while (1)
+    {
+    }
+}
+#endif /* USE_FULL_ASSERT */
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif
 
     /**
-     * @brief Get access to RxQueue for CAN interrupt handlers
+     * @brief Get access to the RxQueue fed by a FIFO, for CAN interrupt handlers
+     * @param fifo FIFO number (0 or 1)
      * @return Pointer to RxQueue
      */
-    CanQueue<QUEUE_CAPACITY> *GetRxQueue(void)
+    CanRxQueue *GetRxQueue(uint8_t fifo)
+    {
+        return (fifo == 1) ? &g_rxPriorityQueue : &g_rxQueue;
+    }
+
+    /**
+     * @brief Get the interrupt statistics of a receive FIFO
+     * @param channel CAN channel index (0 for CAN1, 1 for CAN2)
+     * @param fifo FIFO number (0 or 1)
+     * @return Pointer to the statistics, or nullptr if out of range
+     */
+    RxFifoStats *GetRxFifoStats(uint8_t channel, uint8_t fifo)
+    {
+        if (channel >= CAN_CHANNEL_COUNT || fifo >= CAN_RX_FIFO_COUNT)
+        {
+            return nullptr;
+        }
+        return &g_rxFifoStats[channel][fifo];
+    }
+
+    /**
+     * @brief Get the bus error monitor of a controller, for the CAN error callbacks
+     * @param channel CAN channel index (0 for CAN1, 1 for CAN2)
+     * @return Pointer to the monitor, or nullptr if out of range
+     */
+    CanErrorMonitor *GetCanErrorMonitor(uint8_t channel)
+    {
+        if (channel >= CAN_CHANNEL_COUNT)
+        {
+            return nullptr;
+        }
+        return &g_canErrors[channel];
+    }
+
+    /**
+     * @brief Add the running time of one CAN RX interrupt to the CPU profile
+     * @param fifo FIFO number (0 or 1) the interrupt drained
+     * @param cycles Running time in CycleCounter counts
+     */
+    void ProfileCanRxIrq(uint8_t fifo, uint32_t cycles)
+    {
+        g_cpuProfile.add((fifo == 1) ? CpuProfile::SECTION_RX_ISR_FIFO1 : CpuProfile::SECTION_RX_ISR_FIFO0, cycles);
+    }
+
+    /**
+     * @brief Check from a CAN RX interrupt whether a TxQueue lane and its stage are empty
+     * @param channel CAN channel index (0 for CAN1, 1 for CAN2)
+     * @return true if no frame is waiting to be sent on that channel
+     *
+     * Used by cut-through forwarding, which must not overtake queued frames.
+     * A forwarded frame the App is still pushing keeps its RxQueue slot until
+     * ProcessCanRxQueue() releases it, so the caller's RxQueue check covers
+     * a push this interrupt may have preempted.
+     */
+    bool IsTxLaneEmpty(uint8_t channel)
+    {
+        return (channel < CAN_CHANNEL_COUNT) && g_TxQueue.lane(channel).isEmpty() &&
+               g_txStage[channel].isEmpty();
+    }
+
+    /**
+     * @brief Load one frame into a free TX mailbox, for CAN interrupt handlers
+     * @param channel CAN channel index (0 for CAN1, 1 for CAN2)
+     * @param frame Frame to send
+     * @return true if the frame was loaded, false if no mailbox was free
+     *
+     * For interrupts that LockTxMailboxes() holds off, which is only the
+     * RX0, TX and SCE vectors at CAN_IRQ_PRIORITY. Refused while the
+     * controller is off the bus.
+     */
+    bool LoadCanTxMailbox(uint8_t channel, CAN_FRAME *frame)
+    {
+        assert_param(InTxMailboxIrq());
+        if (channel >= CAN_CHANNEL_COUNT || !g_canErrors[channel].onBus())
+        {
+            return false;
+        }
+        return LoadTxMailbox((channel == 0) ? &hcan1 : &hcan2, frame);
+    }
+
+    /**
+     * @brief Refill a controller's free TX mailboxes from its TX stage
+     * @param channel CAN channel index (0 for CAN1, 1 for CAN2)
+     *
+     * For the TX mailbox empty interrupt of that controller only. Called
+     * from any other context it could race the main loop for the stage and
+     * send a frame twice.
+     */
+    void RefillCanTxMailboxes(uint8_t channel)
+    {
+        assert_param(InTxMailboxIrq());
+        if (channel < CAN_CHANNEL_COUNT)
+        {
+            RefillTxMailboxes(channel, (channel == 0) ? &hcan1 : &hcan2);
+            // The stage has room again for frames waiting in the lane
+            g_events.signal(MainLoopEvents::EVENT_CAN_TX);
+#ifdef CAN_PENDSV_PROCESSING
+            PendDeferredWork();
+#endif
+        }
+    }
+
+    /**
+     * @brief Tell the main loop, or PendSV, that an RxQueue has new frames
+     *
+     * For the CAN RX interrupts.
+     */
+    void SignalCanRxWork(void)
+    {
+        g_events.signal(MainLoopEvents::EVENT_CAN_RX);
+#ifdef CAN_PENDSV_PROCESSING
+        PendDeferredWork();
+#endif
+    }
+
+#ifdef CAN_PENDSV_PROCESSING
+    /**
+     * @brief Receive and transmit processing, for PendSV_Handler()
+     *
+     * Runs the RxQueues through the App and moves the TxQueue lanes to the
+     * controllers, preempting the main loop but below every CAN interrupt.
+     * It is the only consumer of both queues in these builds; the main loop
+     * feeds the App and the TxQueue only with PendSV masked. The wake
+     * latency statistics time the CAN work from its interrupt to here.
+     */
+    void ProcessDeferredWork(void)
+    {
+        uint32_t now = CycleCounter::now();
+        uint32_t waited;
+        uint32_t longest = 0;
+        bool any = false;
+        if (g_events.waitedSince(MainLoopEvents::EVENT_CAN_RX, now, &waited))
+        {
+            longest = waited;
+            any = true;
+        }
+        if (g_events.waitedSince(MainLoopEvents::EVENT_CAN_TX, now, &waited))
+        {
+            longest = (any && longest > waited) ? longest : waited;
+            any = true;
+        }
+        if (any)
+        {
+            g_wakeLatency.record(longest);
+        }
+
+        g_events.take(MainLoopEvents::EVENT_CAN_TX);
+        if (g_events.take(MainLoopEvents::EVENT_CAN_RX))
+        {
+            ProcessCanRx();
+        }
+        ProcessCanTx();
+    }
+#endif
+
+    /**
+     * @brief Tell the main loop the HAL tick has advanced
+     *
+     * For SysTick_Handler(), after HAL_IncTick().
+     */
+    void SignalMainLoopTick(void)
     {
-        return &g_rxQueue;
+        g_events.signal(MainLoopEvents::EVENT_TICK);
     }
 
 #ifdef __cplusplus
@@ -23,6 +23,7 @@
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
 #include <stm32f1xx_hal.h>
+#include "can.h"
 
 /* USER CODE END Includes */
 
@@ -173,7 +174,9 @@ void DebugMon_Handler(void)
 void PendSV_Handler(void)
 {
   /* USER CODE BEGIN PendSV_IRQn 0 */
-
+#ifdef CAN_PENDSV_PROCESSING
+  ProcessDeferredWork();
+#endif
   /* USER CODE END PendSV_IRQn 0 */
   /* USER CODE BEGIN PendSV_IRQn 1 */
 
@@ -190,7 +193,7 @@ void SysTick_Handler(void)
   /* USER CODE END SysTick_IRQn 0 */
   HAL_IncTick();
   /* USER CODE BEGIN SysTick_IRQn 1 */
-
+  SignalMainLoopTick();
   /* USER CODE END SysTick_IRQn 1 */
 }
 
@@ -221,7 +224,10 @@ void CAN1_TX_IRQHandler(void)
 void CAN1_RX0_IRQHandler(void)
 {
   /* USER CODE BEGIN CAN1_RX0_IRQn 0 */
-
+#ifdef CAN_RX_DIRECT
+  CanRxDirectIRQHandler(0, CAN1, 0);
+  return;
+#endif
   /* USER CODE END CAN1_RX0_IRQn 0 */
   HAL_CAN_IRQHandler(&hcan1);
   /* USER CODE BEGIN CAN1_RX0_IRQn 1 */
@@ -235,7 +241,14 @@ void CAN1_RX0_IRQHandler(void)
 void CAN1_RX1_IRQHandler(void)
 {
   /* USER CODE BEGIN CAN1_RX1_IRQn 0 */
-
+  /* FIFO1 only: this vector preempts the other CAN1 interrupts, so it must
+     not run their callbacks through HAL_CAN_IRQHandler() */
+#ifdef CAN_RX_DIRECT
+  CanRxDirectIRQHandler(0, CAN1, 1);
+#else
+  CanRxFifo1IRQHandler(0, &hcan1);
+#endif
+  return;
   /* USER CODE END CAN1_RX1_IRQn 0 */
   HAL_CAN_IRQHandler(&hcan1);
   /* USER CODE BEGIN CAN1_RX1_IRQn 1 */
@@ -263,7 +276,10 @@ void CAN2_TX_IRQHandler(void)
 void CAN2_RX0_IRQHandler(void)
 {
   /* USER CODE BEGIN CAN2_RX0_IRQn 0 */
-
+#ifdef CAN_RX_DIRECT
+  CanRxDirectIRQHandler(1, CAN2, 0);
+  return;
+#endif
   /* USER CODE END CAN2_RX0_IRQn 0 */
   HAL_CAN_IRQHandler(&hcan2);
   /* USER CODE BEGIN CAN2_RX0_IRQn 1 */
@@ -277,7 +293,14 @@ void CAN2_RX0_IRQHandler(void)
 void CAN2_RX1_IRQHandler(void)
 {
   /* USER CODE BEGIN CAN2_RX1_IRQn 0 */
-
+  /* FIFO1 only: this vector preempts the other CAN2 interrupts, so it must
+     not run their callbacks through HAL_CAN_IRQHandler() */
+#ifdef CAN_RX_DIRECT
+  CanRxDirectIRQHandler(1, CAN2, 1);
+#else
+  CanRxFifo1IRQHandler(1, &hcan2);
+#endif
+  return;
   /* USER CODE END CAN2_RX1_IRQn 0 */
   HAL_CAN_IRQHandler(&hcan2);
   /* USER CODE BEGIN CAN2_RX1_IRQn 1 */
@@ -287,4 +310,20 @@ void CAN2_RX1_IRQHandler(void)
 
 /* USER CODE BEGIN 1 */
 
+/**
+  * @brief This function handles CAN1 SCE interrupt, bus errors and bus-off.
+  */
+void CAN1_SCE_IRQHandler(void)
+{
+  HAL_CAN_IRQHandler(&hcan1);
+}
+
+/**
+  * @brief This function handles CAN2 SCE interrupt, bus errors and bus-off.
+  */
+void CAN2_SCE_IRQHandler(void)
+{
+  HAL_CAN_IRQHandler(&hcan2);
+}
+
 /* USER CODE END 1 */
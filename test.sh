@@ -104,11 +104,11 @@ echo -e "${GREEN}Running tests...${NC}"
 echo -e "${GREEN}================================${NC}"
 echo ""
 
-# Run tests
+# Run tests, with the optional frame timestamps and in the default configuration
 if [ $VERBOSE -eq 1 ]; then
-    ./MIevM_Tests -v -c
+    ./MIevM_Tests -v -c && ./MIevM_Tests_Default -v -c
 else
-    ./MIevM_Tests
+    ./MIevM_Tests && ./MIevM_Tests_Default
 fi
 
 TEST_RESULT=$?
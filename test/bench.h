@@ -0,0 +1,121 @@
+/**
+ * @file bench.h
+ * @brief Minimal timing harness for the host benchmarks
+ *
+ * Benchmarks are plain functions that call RunBenchmark() with a body to
+ * time. They are built with optimisation into MIevM_Bench and are not run
+ * as part of the unit tests.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+/**
+ * @brief Benchmark timing configuration
+ */
+struct BenchConfig {
+    uint32_t warmupMs;      ///< Time spent running the body before measuring
+    uint32_t repetitionMs;  ///< Minimum duration of one timed repetition
+    uint32_t repetitions;   ///< Number of timed repetitions, the best is reported
+    const char* filter;     ///< Only run benchmarks whose name contains this, nullptr for all
+};
+
+/**
+ * @brief Maximum number of timed repetitions
+ */
+const uint32_t BENCH_MAX_REPETITIONS = 100;
+
+/**
+ * @brief Timing configuration used by RunBenchmark()
+ */
+extern BenchConfig g_benchConfig;
+
+/**
+ * @brief Stop the compiler optimising away a value computed by a benchmark
+ */
+template<typename T>
+inline void DoNotOptimize(const T& value) {
+    __asm volatile ("" : : "r,m"(value) : "memory");
+}
+
+/**
+ * @brief Print a section heading in the benchmark report
+ */
+inline void BenchSection(const char* title) {
+    printf("\n%s\n", title);
+}
+
+/**
+ * @brief Check a benchmark name against the configured filter
+ * @return true if the benchmark should run
+ */
+inline bool BenchSelected(const char* name) {
+    return g_benchConfig.filter == nullptr || strstr(name, g_benchConfig.filter) != nullptr;
+}
+
+/**
+ * @brief Time a benchmark body and print ns/op and ops/s
+ * @param name Name printed in the report
+ * @param opsPerCall Number of operations performed by one call of body
+ * @param body Callable to time
+ * @return Best time per operation in nanoseconds, 0 if filtered out
+ *
+ * The body is run for the warm-up period, then calibrated so that one
+ * repetition lasts at least repetitionMs. The fastest repetition is
+ * reported, as it is the one least disturbed by the host OS, along with
+ * the median as a check on how noisy the run was.
+ */
+template<typename BODY>
+double RunBenchmark(const char* name, uint32_t opsPerCall, BODY body) {
+    typedef std::chrono::steady_clock Clock;
+
+    if (!BenchSelected(name)) {
+        return 0.0;
+    }
+
+    // Warm up caches and branch predictors
+    Clock::time_point warmupEnd = Clock::now() + std::chrono::milliseconds(g_benchConfig.warmupMs);
+    uint64_t calls = 0;
+    do {
+        body();
+        calls++;
+    } while (Clock::now() < warmupEnd);
+
+    // Estimate calls per repetition from the warm-up rate
+    uint64_t callsPerRep = (calls * g_benchConfig.repetitionMs) / (g_benchConfig.warmupMs ? g_benchConfig.warmupMs : 1);
+    if (callsPerRep == 0) {
+        callsPerRep = 1;
+    }
+
+    uint32_t repetitions = g_benchConfig.repetitions;
+    if (repetitions == 0) {
+        repetitions = 1;
+    } else if (repetitions > BENCH_MAX_REPETITIONS) {
+        repetitions = BENCH_MAX_REPETITIONS;
+    }
+
+    double nsPerOp[BENCH_MAX_REPETITIONS];
+    for (uint32_t rep = 0; rep < repetitions; rep++) {
+        Clock::time_point start = Clock::now();
+        for (uint64_t i = 0; i < callsPerRep; i++) {
+            body();
+        }
+        double elapsedNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        nsPerOp[rep] = elapsedNs / (double)(callsPerRep * opsPerCall);
+    }
+
+    std::sort(nsPerOp, nsPerOp + repetitions);
+    double bestNs = nsPerOp[0];
+    double medianNs = nsPerOp[repetitions / 2];
+    printf("  %-52s %10.2f ns/op %10.2f median %14.0f ops/s\n", name, bestNs, medianNs,
+           bestNs > 0.0 ? 1e9 / bestNs : 0.0);
+    return bestNs;
+}
+
+#endif // BENCH_H
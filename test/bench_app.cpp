@@ -0,0 +1,71 @@
+/**
+ * @file bench_app.cpp
+ * @brief Benchmarks for App::canMsgReceived() on the per-frame path
+ */
+
+#include "bench.h"
+#include "App.h"
+#include "BatteryModel.h"
+#include "CanTxQueue.h"
+#include "VoltageByte.h"
+#include <string.h>
+
+namespace {
+
+CanTxQueue g_txQueue;
+BatteryModel g_batteryModel(BATTERY_PACK_AH_CAPACITY);
+App g_app(&g_txQueue, &g_batteryModel);
+
+/**
+ * @brief Build a frame as received on CAN1
+ */
+CAN_FRAME MakeFrame(uint32_t id) {
+    CAN_FRAME frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.ID = id;
+    frame.dlc = 8;
+    frame.rx_channel = 0;
+    return frame;
+}
+
+/**
+ * @brief Receive one frame, then take any response out of the TxQueue as ProcessCanTx() would
+ */
+inline void ReceiveAndDrain(CAN_FRAME& frame) {
+    g_app.canMsgReceived(frame);
+    CanTxQueue::Lane& lane = g_txQueue.lane(1);
+    if (lane.front() != nullptr) {
+        lane.release();
+    }
+}
+
+} // namespace
+
+/**
+ * @brief Time App::canMsgReceived() for 0x373, 0x374 and passthrough frames
+ *
+ * Each operation includes taking the forwarded frame back out of the
+ * TxQueue, so the queue never fills.
+ */
+void RunAppBenchmarks()
+{
+    // Bring the model out of its start-up state so 0x374 is forwarded
+    for (int i = 0; i < 50; i++) {
+        g_batteryModel.update(VoltageByte::fromVoltage(3.9f), -5.0f, 100);
+    }
+
+    CAN_FRAME msg373 = MakeFrame(0x373);
+    msg373.data[0] = 0xC0;
+    msg373.data[1] = 0xBE;
+    msg373.data[2] = 0x7F;
+    msg373.data[3] = 0x00;
+    msg373.data[4] = 0x0D;
+    msg373.data[5] = 0x48;
+    CAN_FRAME msg374 = MakeFrame(0x374);
+    CAN_FRAME passthrough = MakeFrame(0x123);
+
+    BenchSection("App::canMsgReceived(), per frame");
+    RunBenchmark("0x373 (model update + forward)", 1, [&msg373]() { ReceiveAndDrain(msg373); });
+    RunBenchmark("0x374 (SoC rewrite + forward)", 1, [&msg374]() { ReceiveAndDrain(msg374); });
+    RunBenchmark("passthrough (forward only)", 1, [&passthrough]() { ReceiveAndDrain(passthrough); });
+}
@@ -0,0 +1,41 @@
+/**
+ * @file bench_battery_model.cpp
+ * @brief Benchmarks for BatteryModel
+ */
+
+#include "bench.h"
+#include "App.h"
+#include "BatteryModel.h"
+#include "VoltageByte.h"
+
+namespace {
+
+BatteryModel g_model(BATTERY_PACK_AH_CAPACITY);
+float g_sum;
+
+} // namespace
+
+/**
+ * @brief Time BatteryModel::update() and BatteryModel::voltageToSoC2()
+ */
+void RunBatteryModelBenchmarks()
+{
+    BenchSection("BatteryModel, per call");
+
+    // Alternate between rest and load so both SoC2 paths are exercised
+    uint32_t call = 0;
+    RunBenchmark("update()", 1, [&call]() {
+        float current = (call++ & 0x100) ? -20.0f : 0.0f;
+        g_model.update(VoltageByte::fromVoltage(3.8f), current, 10);
+    });
+    DoNotOptimize(g_model.getSoC2());
+
+    // Sweep the whole VoltageByte range, through every segment of the curve
+    uint8_t value = 0;
+    RunBenchmark("voltageToSoC2(), all 256 inputs", 256, [&value]() {
+        for (int i = 0; i < 256; i++) {
+            g_sum += BatteryModel::voltageToSoC2(VoltageByte(value++));
+        }
+    });
+    DoNotOptimize(g_sum);
+}
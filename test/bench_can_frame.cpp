@@ -0,0 +1,127 @@
+/**
+ * @file bench_can_frame.cpp
+ * @brief Size and copy cost of CAN_FRAME against packed alternatives
+ *
+ * The alternatives keep ID, IDE, RTR and channel in one 32-bit word, with
+ * DLC in a byte of its own (all five fields need 36 bits). Each layout is
+ * timed copying a queue's worth of frames and decoding the routing fields
+ * the main loop looks at.
+ */
+
+#include "bench.h"
+#include "can_types.h"
+#include <string.h>
+
+namespace {
+
+const uint16_t FRAMES = QUEUE_CAPACITY;
+
+/**
+ * @brief Header word layout shared by the packed alternatives
+ *
+ * Bits 0-28 ID, bit 29 IDE, bit 30 RTR, bit 31 channel.
+ */
+inline uint32_t PackHeader(uint32_t id, bool ide, bool rtr, uint8_t channel) {
+    return (id & 0x1FFFFFFF) | (ide ? (1UL << 29) : 0) | (rtr ? (1UL << 30) : 0) | ((uint32_t)(channel & 1) << 31);
+}
+
+/**
+ * @brief Header word plus DLC, padded back to 16 bytes by alignment
+ */
+struct AlignedWordFrame {
+    uint32_t header;
+    uint8_t dlc;
+    uint8_t data[8];
+
+    uint32_t id() const { return header & 0x1FFFFFFF; }
+    bool ide() const { return (header >> 29) & 1; }
+    uint8_t channel() const { return header >> 31; }
+};
+
+#pragma pack(push, 1)
+/**
+ * @brief Header word plus DLC, packed to 13 bytes
+ */
+struct PackedWordFrame {
+    uint32_t header;
+    uint8_t dlc;
+    uint8_t data[8];
+
+    uint32_t id() const { return header & 0x1FFFFFFF; }
+    bool ide() const { return (header >> 29) & 1; }
+    uint8_t channel() const { return header >> 31; }
+};
+#pragma pack(pop)
+
+CAN_FRAME g_frames[FRAMES];
+CAN_FRAME g_framesCopy[FRAMES];
+AlignedWordFrame g_aligned[FRAMES];
+AlignedWordFrame g_alignedCopy[FRAMES];
+PackedWordFrame g_packed[FRAMES];
+PackedWordFrame g_packedCopy[FRAMES];
+uint32_t g_checksum;
+
+template<class FRAME>
+void CopyAll(const FRAME* from, FRAME* to) {
+    for (uint16_t i = 0; i < FRAMES; i++) {
+        to[i] = from[i];
+    }
+    DoNotOptimize(to[FRAMES - 1]);
+}
+
+void RouteCanFrame() {
+    for (uint16_t i = 0; i < FRAMES; i++) {
+        const CAN_FRAME& frame = g_frames[i];
+        g_checksum += frame.ID + (frame.ide ? 1 : 0) + frame.rx_channel + frame.dlc;
+    }
+}
+
+template<class FRAME>
+void RouteWordFrame(const FRAME* frames) {
+    for (uint16_t i = 0; i < FRAMES; i++) {
+        const FRAME& frame = frames[i];
+        g_checksum += frame.id() + (frame.ide() ? 1 : 0) + frame.channel() + frame.dlc;
+    }
+}
+
+} // namespace
+
+/**
+ * @brief Report CAN_FRAME layout sizes and per-frame copy/decode cost
+ */
+void RunCanFrameBenchmarks()
+{
+    for (uint16_t i = 0; i < FRAMES; i++) {
+        memset(&g_frames[i], 0, sizeof(CAN_FRAME));
+        g_frames[i].ID = 0x100 + i;
+        g_frames[i].dlc = 8;
+        g_frames[i].rx_channel = i & 1;
+        memset(&g_aligned[i], 0, sizeof(AlignedWordFrame));
+        g_aligned[i].header = PackHeader(0x100 + i, false, false, i & 1);
+        g_aligned[i].dlc = 8;
+        memset(&g_packed[i], 0, sizeof(PackedWordFrame));
+        g_packed[i].header = PackHeader(0x100 + i, false, false, i & 1);
+        g_packed[i].dlc = 8;
+    }
+
+    const char* sizeTitle = "CAN_FRAME layouts, size (bytes) and RAM for a QUEUE_CAPACITY queue";
+    if (BenchSelected(sizeTitle)) {
+        BenchSection(sizeTitle);
+        printf("  %-40s %6u %8u\n", "CAN_FRAME (ID, 4 flag bytes, data)", (unsigned)sizeof(CAN_FRAME),
+               (unsigned)(sizeof(CAN_FRAME) * QUEUE_CAPACITY));
+        printf("  %-40s %6u %8u\n", "header word + DLC, aligned", (unsigned)sizeof(AlignedWordFrame),
+               (unsigned)(sizeof(AlignedWordFrame) * QUEUE_CAPACITY));
+        printf("  %-40s %6u %8u\n", "header word + DLC, packed", (unsigned)sizeof(PackedWordFrame),
+               (unsigned)(sizeof(PackedWordFrame) * QUEUE_CAPACITY));
+    }
+
+    BenchSection("CAN_FRAME layouts, per frame");
+    RunBenchmark("copy, CAN_FRAME", FRAMES, []() { CopyAll(g_frames, g_framesCopy); });
+    RunBenchmark("copy, header word + DLC, aligned", FRAMES, []() { CopyAll(g_aligned, g_alignedCopy); });
+    RunBenchmark("copy, header word + DLC, packed", FRAMES, []() { CopyAll(g_packed, g_packedCopy); });
+    RunBenchmark("decode ID/IDE/channel/DLC, CAN_FRAME", FRAMES, RouteCanFrame);
+    RunBenchmark("decode ID/IDE/channel/DLC, aligned", FRAMES, []() { RouteWordFrame(g_aligned); });
+    RunBenchmark("decode ID/IDE/channel/DLC, packed", FRAMES, []() { RouteWordFrame(g_packed); });
+
+    DoNotOptimize(g_checksum);
+}
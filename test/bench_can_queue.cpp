@@ -0,0 +1,158 @@
+/**
+ * @file bench_can_queue.cpp
+ * @brief Benchmarks for the CAN queues: single operations and drain strategies
+ */
+
+#include "bench.h"
+#include "CanQueue.h"
+#include "SpscCanQueue.h"
+#include "CanRxQueue.h"
+#include "CanTxQueue.h"
+#include <string.h>
+
+namespace {
+
+const uint16_t DEPTHS[] = {1, 2, 4, 8, 16, 32, 64};
+
+SpscCanQueue<QUEUE_CAPACITY> g_queue;
+CAN_FRAME g_frame;
+uint32_t g_checksum;
+
+/**
+ * @brief Stand-in for App::canMsgReceived(), cheap but not removable
+ */
+inline void Consume(const CAN_FRAME& frame) {
+    g_checksum += frame.ID + frame.data[0];
+}
+
+/**
+ * @brief Fill the queue the way the RX ISR does, with reserve/commit
+ */
+inline void Fill(uint16_t depth) {
+    for (uint16_t i = 0; i < depth; i++) {
+        CAN_FRAME* slot = g_queue.reserve();
+        *slot = g_frame;
+        slot->ID = i;
+        g_queue.commit();
+    }
+}
+
+void DrainPerFramePop(uint16_t depth) {
+    Fill(depth);
+    CAN_FRAME frame;
+    while (g_queue.pop(&frame)) {
+        Consume(frame);
+    }
+}
+
+void DrainPerFrameInPlace(uint16_t depth) {
+    Fill(depth);
+    CAN_FRAME* frame;
+    while ((frame = g_queue.front()) != nullptr) {
+        Consume(*frame);
+        g_queue.release();
+    }
+}
+
+void DrainPopMany(uint16_t depth) {
+    Fill(depth);
+    CAN_FRAME frames[QUEUE_CAPACITY];
+    uint16_t count;
+    while ((count = g_queue.popMany(frames, QUEUE_CAPACITY)) > 0) {
+        for (uint16_t i = 0; i < count; i++) {
+            Consume(frames[i]);
+        }
+    }
+}
+
+void DrainSpan(uint16_t depth) {
+    Fill(depth);
+    CAN_FRAME* frames;
+    uint16_t count;
+    while ((count = g_queue.frontSpan(&frames)) > 0) {
+        for (uint16_t i = 0; i < count; i++) {
+            Consume(frames[i]);
+        }
+        g_queue.release(count);
+    }
+}
+
+void RunDrain(const char* strategy, void (*drain)(uint16_t)) {
+    char name[64];
+    for (size_t d = 0; d < sizeof(DEPTHS) / sizeof(DEPTHS[0]); d++) {
+        uint16_t depth = DEPTHS[d];
+        snprintf(name, sizeof(name), "%s, depth %u", strategy, depth);
+        RunBenchmark(name, depth, [depth, drain]() { drain(depth); });
+    }
+}
+
+/**
+ * @brief Time push, pop and peek of one queue type
+ *
+ * push is timed filling an empty queue, and pop draining a full one, so
+ * each includes the refill or drain of the other half.
+ */
+template<class QUEUE>
+void RunQueueOps(const char* type, QUEUE& queue) {
+    char name[64];
+    uint16_t capacity = queue.capacity();
+
+    snprintf(name, sizeof(name), "%s push() x capacity + clear()", type);
+    RunBenchmark(name, capacity, [&queue, capacity]() {
+        for (uint16_t i = 0; i < capacity; i++) {
+            g_frame.ID = i;
+            queue.push(g_frame);
+        }
+        queue.clear();
+    });
+
+    snprintf(name, sizeof(name), "%s push() + pop()", type);
+    RunBenchmark(name, 1, [&queue]() {
+        CAN_FRAME frame;
+        queue.push(g_frame);
+        if (queue.pop(&frame)) {
+            Consume(frame);
+        }
+    });
+
+    queue.push(g_frame);
+    snprintf(name, sizeof(name), "%s peek()", type);
+    RunBenchmark(name, 1, [&queue]() {
+        CAN_FRAME frame;
+        if (queue.peek(&frame)) {
+            Consume(frame);
+        }
+    });
+    queue.clear();
+}
+
+CanQueue<QUEUE_CAPACITY> g_canQueue;
+CanRxQueue g_rxQueue;
+CanTxQueue::Lane g_txLane;
+
+} // namespace
+
+/**
+ * @brief Compare per-frame and batched RxQueue drains at increasing depths
+ *
+ * Each operation is one frame filled with reserve/commit and then drained,
+ * so the figures are per-frame costs of the whole ISR-to-main-loop hop.
+ */
+void RunCanQueueBenchmarks()
+{
+    memset(&g_frame, 0, sizeof(g_frame));
+    g_frame.dlc = 8;
+
+    BenchSection("Queue operations, per frame");
+    RunQueueOps("CanQueue", g_canQueue);
+    RunQueueOps("CanRxQueue", g_rxQueue);
+    RunQueueOps("CanTxQueue::Lane", g_txLane);
+
+    BenchSection("SpscCanQueue fill + drain, per frame");
+    RunDrain("pop() per frame", DrainPerFramePop);
+    RunDrain("front()/release() per frame", DrainPerFrameInPlace);
+    RunDrain("popMany() batch", DrainPopMany);
+    RunDrain("frontSpan()/release(n) batch", DrainSpan);
+
+    DoNotOptimize(g_checksum);
+}
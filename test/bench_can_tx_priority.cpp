@@ -0,0 +1,213 @@
+/**
+ * @file bench_can_tx_priority.cpp
+ * @brief Worst-case TX queueing delay per CAN ID, FIFO vs priority TxQueue lane
+ *
+ * A TX lane, the main loop's mailbox loading and the bus are simulated in
+ * bit times against a fixed periodic message set, and the worst delay from
+ * queueing to the end of transmission is reported for each message. The
+ * raw push/pop cost of both queue types is timed as well.
+ */
+
+#include "bench.h"
+#include "CanQueue.h"
+#include "CanPriorityQueue.h"
+#include <string.h>
+
+namespace {
+
+const uint32_t FRAME_BITS = 130;        // 8 byte standard frame incl. typical stuffing
+const uint32_t SIM_BITS = 20000000;     // Simulated time, 40 s at 500 kbit/s
+const uint8_t TX_MAILBOXES = 3;         // bxCAN TX mailboxes per controller
+
+/**
+ * @brief A periodic message, or a burst of consecutive IDs sent together
+ */
+struct Message {
+    uint32_t id;        ///< First ID of the burst
+    uint32_t period;    ///< Period in bit times
+    uint32_t offset;    ///< First release time in bit times
+    uint8_t burst;      ///< Number of consecutive IDs released together
+    const char* name;
+};
+
+// Listed in release order for simultaneous releases: the bulk burst is
+// queued first, which is the worst case for a FIFO
+const Message MESSAGES[] = {
+    {0x6A0, 10000, 0, 24, "cell voltages (burst)"},
+    {0x700, 10000, 0,  1, "low priority status"},
+    {0x374,  5000, 0,  1, "0x374 rewrite"},
+    {0x373,  5000, 0,  1, "0x373 forward"},
+    {0x100,  2000, 0,  1, "control"},
+    {0x080,  1000, 0,  1, "time critical"},
+};
+const size_t MESSAGE_COUNT = sizeof(MESSAGES) / sizeof(MESSAGES[0]);
+
+/**
+ * @brief Worst-case results of one simulation run
+ */
+struct DelayResult {
+    uint32_t worst[MESSAGE_COUNT];  ///< Worst queue-to-bus-done delay in bit times
+    uint32_t dropped;               ///< Frames lost to a full queue
+};
+
+/**
+ * @brief Simulate one TX lane feeding one controller
+ *
+ * Each frame carries its release time and message index in its data bytes.
+ * Free mailboxes are loaded from the lane after every frame, as
+ * ProcessCanTx() does, and the controller sends the lowest ID held in its
+ * mailboxes, as bxCAN does with TransmitFifoPriority disabled.
+ */
+template<class QUEUE>
+void SimulateDelay(QUEUE& queue, DelayResult& result) {
+    CAN_FRAME mailbox[TX_MAILBOXES];
+    bool mailboxUsed[TX_MAILBOXES] = {};
+    uint32_t nextRelease[MESSAGE_COUNT];
+
+    memset(&result, 0, sizeof(result));
+    queue.clear();
+    for (size_t m = 0; m < MESSAGE_COUNT; m++) {
+        nextRelease[m] = MESSAGES[m].offset;
+    }
+
+    uint32_t now = 0;
+    while (now < SIM_BITS) {
+        // Queue every frame released up to now
+        for (size_t m = 0; m < MESSAGE_COUNT; m++) {
+            while (nextRelease[m] <= now) {
+                for (uint8_t b = 0; b < MESSAGES[m].burst; b++) {
+                    CAN_FRAME frame;
+                    memset(&frame, 0, sizeof(frame));
+                    frame.ID = MESSAGES[m].id + b;
+                    frame.dlc = 8;
+                    memcpy(&frame.data[0], &nextRelease[m], sizeof(uint32_t));
+                    frame.data[4] = (uint8_t)m;
+                    if (!queue.push(frame)) {
+                        result.dropped++;
+                    }
+                }
+                nextRelease[m] += MESSAGES[m].period;
+            }
+        }
+
+        // Load free mailboxes from the front of the lane
+        for (uint8_t i = 0; i < TX_MAILBOXES; i++) {
+            CAN_FRAME* frame = queue.front();
+            if (frame == nullptr) {
+                break;
+            }
+            if (!mailboxUsed[i]) {
+                mailbox[i] = *frame;
+                mailboxUsed[i] = true;
+                queue.release();
+            }
+        }
+
+        // The controller arbitrates between its own mailboxes by ID
+        int winner = -1;
+        for (uint8_t i = 0; i < TX_MAILBOXES; i++) {
+            if (mailboxUsed[i] && (winner < 0 || mailbox[i].ID < mailbox[winner].ID)) {
+                winner = i;
+            }
+        }
+
+        if (winner < 0) {
+            // Bus idle until the next release
+            uint32_t next = SIM_BITS;
+            for (size_t m = 0; m < MESSAGE_COUNT; m++) {
+                if (nextRelease[m] < next) {
+                    next = nextRelease[m];
+                }
+            }
+            now = next;
+            continue;
+        }
+
+        now += FRAME_BITS;
+        uint32_t released;
+        memcpy(&released, &mailbox[winner].data[0], sizeof(uint32_t));
+        uint8_t m = mailbox[winner].data[4];
+        if (now - released > result.worst[m]) {
+            result.worst[m] = now - released;
+        }
+        mailboxUsed[winner] = false;
+    }
+}
+
+CanQueue<QUEUE_CAPACITY> g_fifo;
+CanPriorityQueue<QUEUE_CAPACITY> g_priority;
+CAN_FRAME g_frame;
+uint32_t g_checksum;
+
+/**
+ * @brief Push depth frames with scattered IDs, then pop them all
+ */
+template<class QUEUE>
+void PushPop(QUEUE& queue, uint16_t depth) {
+    for (uint16_t i = 0; i < depth; i++) {
+        g_frame.ID = (i * 0x2B5) & 0x7FF;
+        queue.push(g_frame);
+    }
+
+    CAN_FRAME* frame;
+    while ((frame = queue.front()) != nullptr) {
+        g_checksum += frame->ID;
+        queue.release();
+    }
+}
+
+/**
+ * @brief Simulate FIFO and priority lanes and print the worst delay per ID
+ */
+void ReportDelay(const char* title) {
+    DelayResult fifo;
+    DelayResult priority;
+    SimulateDelay(g_fifo, fifo);
+    SimulateDelay(g_priority, priority);
+
+    BenchSection(title);
+    printf("  %-14s %-24s %7s %16s %16s\n", "ID", "message", "period", "FIFO", "priority");
+    for (size_t m = 0; m < MESSAGE_COUNT; m++) {
+        char id[16];
+        if (MESSAGES[m].burst > 1) {
+            snprintf(id, sizeof(id), "0x%03X-0x%03X", (unsigned)MESSAGES[m].id,
+                     (unsigned)(MESSAGES[m].id + MESSAGES[m].burst - 1));
+        } else {
+            snprintf(id, sizeof(id), "0x%03X", (unsigned)MESSAGES[m].id);
+        }
+        printf("  %-14s %-24s %7u %8u (%5.1f) %8u (%5.1f)\n", id, MESSAGES[m].name,
+               (unsigned)MESSAGES[m].period,
+               (unsigned)fifo.worst[m], (double)fifo.worst[m] / FRAME_BITS,
+               (unsigned)priority.worst[m], (double)priority.worst[m] / FRAME_BITS);
+    }
+    printf("  dropped frames: FIFO %u, priority %u\n", (unsigned)fifo.dropped, (unsigned)priority.dropped);
+}
+
+} // namespace
+
+/**
+ * @brief Report worst-case TX queueing delay per ID and queue operation cost
+ */
+void RunCanTxPriorityBenchmarks()
+{
+    const char* delayTitle = "TX lane worst-case delay, queued to sent (bit times, frames of 130 bits)";
+    if (BenchSelected(delayTitle)) {
+        ReportDelay(delayTitle);
+    }
+
+    memset(&g_frame, 0, sizeof(g_frame));
+    g_frame.dlc = 8;
+
+    BenchSection("TX lane push + front()/release(), per frame");
+    const uint16_t depths[] = {1, 8, 64};
+    char name[64];
+    for (size_t d = 0; d < sizeof(depths) / sizeof(depths[0]); d++) {
+        uint16_t depth = depths[d];
+        snprintf(name, sizeof(name), "CanQueue (FIFO), depth %u", depth);
+        RunBenchmark(name, depth, [depth]() { PushPop(g_fifo, depth); });
+        snprintf(name, sizeof(name), "CanPriorityQueue, depth %u", depth);
+        RunBenchmark(name, depth, [depth]() { PushPop(g_priority, depth); });
+    }
+
+    DoNotOptimize(g_checksum);
+}
@@ -0,0 +1,66 @@
+/**
+ * @file bench_main.cpp
+ * @brief Main entry point for the host benchmarks
+ *
+ * Usage: MIevM_Bench [--warmup-ms N] [--rep-ms N] [--reps N] [filter]
+ * Only benchmarks whose name contains filter are timed.
+ */
+
+#include "bench.h"
+#include <stdlib.h>
+
+BenchConfig g_benchConfig = {
+    100,        // warmupMs
+    50,         // repetitionMs
+    5,          // repetitions
+    nullptr,    // filter
+};
+
+// Benchmark groups, one per bench_[module_name].cpp
+void RunCanQueueBenchmarks();
+void RunCanTxPriorityBenchmarks();
+void RunCanFrameBenchmarks();
+void RunAppBenchmarks();
+void RunBatteryModelBenchmarks();
+
+/**
+ * @brief Print command line usage
+ */
+static void PrintUsage(const char* program)
+{
+    printf("Usage: %s [--warmup-ms N] [--rep-ms N] [--reps N] [filter]\n", program);
+    printf("  --warmup-ms N  time each benchmark runs before measuring (default %u)\n", g_benchConfig.warmupMs);
+    printf("  --rep-ms N     minimum duration of one timed repetition (default %u)\n", g_benchConfig.repetitionMs);
+    printf("  --reps N       timed repetitions, 1 to %u (default %u)\n", BENCH_MAX_REPETITIONS, g_benchConfig.repetitions);
+    printf("  filter         only time benchmarks whose name contains filter\n");
+}
+
+int main(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = (i + 1 < argc);
+        if (strcmp(argv[i], "--warmup-ms") == 0 && hasValue) {
+            g_benchConfig.warmupMs = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--rep-ms") == 0 && hasValue) {
+            g_benchConfig.repetitionMs = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--reps") == 0 && hasValue) {
+            g_benchConfig.repetitions = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (argv[i][0] != '-' && g_benchConfig.filter == nullptr) {
+            g_benchConfig.filter = argv[i];
+        } else {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    printf("MIevM host benchmarks (best and median of %u repetitions, %u ms warm-up)\n",
+           g_benchConfig.repetitions, g_benchConfig.warmupMs);
+
+    RunCanQueueBenchmarks();
+    RunCanTxPriorityBenchmarks();
+    RunCanFrameBenchmarks();
+    RunAppBenchmarks();
+    RunBatteryModelBenchmarks();
+
+    return 0;
+}
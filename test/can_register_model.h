@@ -0,0 +1,65 @@
+/**
+ * @file can_register_model.h
+ * @brief Host model of the bxCAN transmit registers, for the register-level TX path
+ *
+ * Has the member names of CAN_TypeDef that CanTxMailboxLoad() uses. Plain
+ * memory does not react to writes, so the controller's side is simulated
+ * by calling clock() after a load (a requested mailbox becomes pending)
+ * and complete() when a mailbox has been sent.
+ */
+
+#ifndef CAN_REGISTER_MODEL_H
+#define CAN_REGISTER_MODEL_H
+
+#include <stdint.h>
+#include "CanTxMailbox.h"
+
+/**
+ * @brief One transmit mailbox, as CAN_TxMailBox_TypeDef
+ */
+struct CanTxMailboxModel {
+    volatile uint32_t TIR;
+    volatile uint32_t TDTR;
+    volatile uint32_t TDLR;
+    volatile uint32_t TDHR;
+};
+
+/**
+ * @brief Transmit status and mailboxes of one controller, after reset
+ */
+struct CanRegisterModel {
+    volatile uint32_t TSR;
+    CanTxMailboxModel sTxMailBox[CAN_TX_MAILBOX_COUNT];
+
+    CanRegisterModel() : TSR(0) {
+        for (uint8_t i = 0; i < CAN_TX_MAILBOX_COUNT; i++) {
+            TSR |= CAN_TX_MAILBOX_TME0 << i;
+            sTxMailBox[i].TIR = 0;
+            sTxMailBox[i].TDTR = 0;
+            sTxMailBox[i].TDLR = 0;
+            sTxMailBox[i].TDHR = 0;
+        }
+    }
+
+    /**
+     * @brief Let the controller see new transmit requests: their mailboxes are no longer empty
+     */
+    void clock() {
+        for (uint8_t i = 0; i < CAN_TX_MAILBOX_COUNT; i++) {
+            if ((sTxMailBox[i].TIR & CAN_TX_MAILBOX_TXRQ) != 0) {
+                TSR &= ~(CAN_TX_MAILBOX_TME0 << i);
+            }
+        }
+    }
+
+    /**
+     * @brief Finish sending a mailbox: clear its request and mark it empty
+     * @param mailbox Mailbox number 0-2
+     */
+    void complete(uint8_t mailbox) {
+        sTxMailBox[mailbox].TIR &= ~CAN_TX_MAILBOX_TXRQ;
+        TSR |= CAN_TX_MAILBOX_TME0 << mailbox;
+    }
+};
+
+#endif // CAN_REGISTER_MODEL_H
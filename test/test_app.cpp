@@ -9,7 +9,9 @@
 #include "CanQueue.h"
 #include "can_types.h"
 #include "VoltageByte.h"
+#include "FrameTimestamp.h"
 #include <CanMessage374.h>
+#include <string.h>
 
 // Mock BatteryModel for testing
 class MockBatteryModel : public BatteryModel
@@ -37,14 +39,14 @@ void InitializeBatteryModel(MockBatteryModel *model)
 
 TEST_GROUP(App_CanMsgReceived)
 {
-    CanQueue<QUEUE_CAPACITY> *txQueue;
+    CanTxQueue *txQueue;
     App *app;
     MockBatteryModel *batteryModel;
 
     void setup()
     {
         batteryModel = new MockBatteryModel(BATTERY_PACK_AH_CAPACITY);
-        txQueue = new CanQueue<QUEUE_CAPACITY>();
+        txQueue = new CanTxQueue();
         app = new App(txQueue, batteryModel);
     }
 
@@ -150,6 +152,144 @@ TEST(App_CanMsgReceived, MessageAddedToTxQueue_Channel1To0)
     }
 }
 
+TEST(App_CanMsgReceived, FullTxQueueDropsFrameButUpdatesModel)
+{
+    // Fill the lane for channel 1, where frames received on channel 0 go,
+    // with IDs the frame under test cannot coalesce with
+    CAN_FRAME fill;
+    fill.ide = 0;
+    fill.rtr = 0;
+    fill.tx_channel = 1;
+    for (uint16_t i = 0; i < txQueue->lane(1).capacity(); i++)
+    {
+        fill.ID = 0x100 + i;
+        CHECK(txQueue->push(fill));
+    }
+
+    CAN_FRAME frame;
+    frame.ID = 0x373;
+    frame.dlc = 8;
+    frame.ide = 0;
+    frame.rtr = 0;
+    frame.rx_channel = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        frame.data[i] = 0x80;
+    }
+
+    // The model still sees the data even though it cannot be forwarded
+    mock().expectOneCall("update").onObject(batteryModel).ignoreOtherParameters();
+    app->canMsgReceived(frame);
+    mock().checkExpectations();
+
+    CHECK(txQueue->lane(1).isFull());
+    CHECK(txQueue->lane(0).isEmpty());
+    CAN_FRAME txFrame;
+    CHECK(txQueue->peek(&txFrame));
+    LONGS_EQUAL(0x100, txFrame.ID);
+}
+
+TEST(App_CanMsgReceived, FullTxQueueCoalescesSameId)
+{
+    CAN_FRAME fill;
+    memset(&fill, 0, sizeof(fill));
+    fill.tx_channel = 1;
+    for (uint16_t i = 0; i < txQueue->lane(1).capacity(); i++)
+    {
+        fill.ID = (i == 10) ? 0x555 : 0x100 + i;
+        fill.data[0] = 1;
+        CHECK(txQueue->push(fill));
+    }
+
+    // A fresher 0x555 replaces the queued one instead of being dropped
+    CAN_FRAME frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.ID = 0x555;
+    frame.dlc = 8;
+    frame.rx_channel = 0;
+    frame.data[0] = 2;
+    app->canMsgReceived(frame);
+
+    CAN_FRAME txFrame;
+    int found = 0;
+    while (txQueue->lane(1).pop(&txFrame))
+    {
+        if (txFrame.ID == 0x555)
+        {
+            LONGS_EQUAL(2, txFrame.data[0]);
+            found++;
+        }
+    }
+    LONGS_EQUAL(1, found);
+}
+
+#ifdef CAN_FRAME_TIMESTAMPS
+TEST(App_CanMsgReceived, ForwardedFrameKeepsReceiveTimestamp)
+{
+    CAN_FRAME frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.ID = 0x123;
+    frame.dlc = 8;
+    frame.rx_channel = 1;
+    frame.timestamp = 0x12345679;
+
+    app->canMsgReceived(frame);
+
+    CAN_FRAME txFrame;
+    CHECK(txQueue->lane(0).pop(&txFrame));
+    LONGS_EQUAL(0x12345679, txFrame.timestamp);
+}
+
+TEST(App_CanMsgReceived, ForwardingMovesTheFrameToItsNextStage)
+{
+    CAN_FRAME frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.ID = 0x123;
+    frame.dlc = 8;
+    frame.timestamp = 0x12345679;
+    frame.stage_time = CycleCounter::now() - 1000;
+
+    uint32_t before = CycleCounter::now();
+    app->canMsgReceived(frame);
+
+    CAN_FRAME txFrame = {};
+    CHECK(txQueue->lane(1).pop(&txFrame));
+    CHECK(txFrame.stage_time - before < 0x80000000UL);
+}
+#endif
+
+TEST(App_CanMsgReceived, BatchIsProcessedInOrder)
+{
+    CAN_FRAME frames[3];
+    for (int i = 0; i < 3; i++)
+    {
+        frames[i].ID = 0x500 + i;
+        frames[i].dlc = 1;
+        frames[i].ide = 0;
+        frames[i].rtr = 0;
+        frames[i].rx_channel = i & 1;
+        frames[i].data[0] = i;
+    }
+
+    app->canMsgsReceived(frames, 3);
+
+    // Frames received on channel 0 go to lane 1 and vice versa
+    LONGS_EQUAL(3, txQueue->length());
+    LONGS_EQUAL(1, txQueue->lane(0).length());
+    LONGS_EQUAL(2, txQueue->lane(1).length());
+    CAN_FRAME txFrame;
+    CHECK(txQueue->lane(0).pop(&txFrame));
+    LONGS_EQUAL(0x501, txFrame.ID);
+    LONGS_EQUAL(0, txFrame.tx_channel);
+    for (int i = 0; i < 3; i += 2)
+    {
+        CHECK(txQueue->lane(1).pop(&txFrame));
+        LONGS_EQUAL(0x500 + i, txFrame.ID);
+        LONGS_EQUAL(i, txFrame.data[0]);
+        LONGS_EQUAL(1, txFrame.tx_channel);
+    }
+}
+
 TEST(App_CanMsgReceived, Message373_not_modified)
 {
     // Create a CAN frame received on channel 1
@@ -505,3 +645,376 @@ TEST(App_CanMsgReceived, Message374IsNotForwardedUnlessModelInitialized)
     // Verify message was NOT added to tx queue
     CHECK(txQueue->isEmpty());
 }
+
+TEST_GROUP(App_Diagnostics)
+{
+    CanTxQueue *txQueue;
+    BatteryModel *batteryModel;
+    Diagnostics *diagnostics;
+    QueueStats rxStats;
+
+    void setup()
+    {
+        batteryModel = new BatteryModel(BATTERY_PACK_AH_CAPACITY);
+        txQueue = new CanTxQueue();
+        diagnostics = new Diagnostics();
+    }
+
+    void teardown()
+    {
+        delete diagnostics;
+        delete txQueue;
+        delete batteryModel;
+    }
+
+    // Count frames with a given ID queued on a channel
+    int countQueued(uint8_t channel, uint32_t id)
+    {
+        int count = 0;
+        CAN_FRAME frame;
+        while (txQueue->lane(channel).pop(&frame))
+        {
+            if (frame.ID == id)
+            {
+                count++;
+            }
+        }
+        return count;
+    }
+};
+
+TEST(App_Diagnostics, PagesSentWithHeartbeatOnBothChannels)
+{
+    diagnostics->setQueueStats(Diagnostics::QUEUE_RX, &rxStats);
+    App app(txQueue, batteryModel, diagnostics);
+
+    app.timeTickMs(999);
+    CHECK(txQueue->isEmpty());
+
+    // Both pages of the one registered queue, plus the pages the App
+    // registers itself (the scheduler, and the receive interval in
+    // CAN_HW_TIMESTAMPS builds)
+    int pages = diagnostics->pageCount();
+#ifdef CAN_HW_TIMESTAMPS
+    LONGS_EQUAL(4, pages);
+#else
+    LONGS_EQUAL(3, pages);
+#endif
+
+    app.timeTickMs(1);
+    LONGS_EQUAL(2 * (1 + pages), txQueue->length());
+    LONGS_EQUAL(1 + pages, txQueue->lane(0).length());
+
+    // Heartbeat first, then the pages.
+    // Frames the firmware creates carry no receive timestamp.
+    CAN_FRAME frame;
+    memset(&frame, 0, sizeof(frame));
+    CHECK(txQueue->lane(1).peek(&frame));
+    LONGS_EQUAL(0x720, frame.ID);
+#ifdef CAN_FRAME_TIMESTAMPS
+    LONGS_EQUAL(0, frame.timestamp);
+#endif
+    LONGS_EQUAL(pages, countQueued(0, Diagnostics::MESSAGE_ID));
+    LONGS_EQUAL(pages, countQueued(1, Diagnostics::MESSAGE_ID));
+}
+
+TEST(App_Diagnostics, HeartbeatEverySecondOfALongTick)
+{
+    App app(txQueue, batteryModel);
+
+    // A late tick covering several seconds sends each heartbeat it missed
+    app.timeTickMs(2500);
+    LONGS_EQUAL(2, countQueued(0, 0x720));
+    app.timeTickMs(499);
+    LONGS_EQUAL(0, countQueued(0, 0x720));
+    app.timeTickMs(1);
+    LONGS_EQUAL(1, countQueued(0, 0x720));
+}
+
+TEST(App_Diagnostics, HeartbeatCarriesCpuLoad)
+{
+    uint32_t cyclesPerMs = CycleCounter::frequencyHz() / 1000;
+    CpuProfile profile;
+    profile.update(0);
+    profile.addAwake(124 * cyclesPerMs);
+    profile.addAwake(cyclesPerMs * 3 / 4);
+    profile.update(1000);
+
+    App app(txQueue, batteryModel);
+    app.setCpuProfile(&profile);
+    app.timeTickMs(1000);
+
+    CAN_FRAME frame;
+    CHECK(txQueue->lane(0).pop(&frame));
+    LONGS_EQUAL(0x720, frame.ID);
+    // 124.75 ms awake of 1000 ms
+    LONGS_EQUAL(12, frame.data[2]);
+    // The longest pass, 124 ms, saturates
+    LONGS_EQUAL(0xFF, frame.data[3]);
+}
+
+TEST(App_Diagnostics, HeartbeatLoopTimeRoundsUp)
+{
+    uint32_t cyclesPerUs = CycleCounter::frequencyHz() / 1000000UL;
+    CpuProfile profile;
+    profile.update(0);
+    profile.addAwake(101 * cyclesPerUs);
+    profile.update(1000);
+
+    App app(txQueue, batteryModel);
+    app.setCpuProfile(&profile);
+    app.timeTickMs(1000);
+
+    CAN_FRAME frame;
+    CHECK(txQueue->lane(0).pop(&frame));
+    LONGS_EQUAL(0, frame.data[2]);
+    LONGS_EQUAL(2, frame.data[3]);
+}
+
+#ifdef CAN_FRAME_TIMESTAMPS
+TEST(App_Diagnostics, HistogramRequestAnsweredOnItsBus)
+{
+    App app(txQueue, batteryModel, diagnostics);
+
+    // Forward a stamped frame, so the App's own stage has a sample
+    CAN_FRAME frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.ID = 0x123;
+    frame.dlc = 8;
+    FrameStampReceived(&frame);
+    app.canMsgReceived(frame);
+    txQueue->lane(1).pop(&frame);
+
+    CAN_FRAME request;
+    memset(&request, 0, sizeof(request));
+    request.ID = Diagnostics::REQUEST_ID;
+    request.dlc = 1;
+    request.rx_channel = 1;
+    request.data[0] = Diagnostics::REQUEST_ALL_HISTOGRAMS;
+    app.canMsgReceived(request);
+
+    // Summary and one bucket frame of the only registered stage, on the
+    // requesting bus; the request itself is not forwarded
+    LONGS_EQUAL(0, txQueue->lane(0).length());
+    LONGS_EQUAL(2, txQueue->lane(1).length());
+    CHECK(txQueue->lane(1).pop(&frame));
+    LONGS_EQUAL(Diagnostics::MESSAGE_ID, frame.ID);
+    LONGS_EQUAL(Diagnostics::PAGE_HISTOGRAM + Diagnostics::HISTOGRAM_DISPATCH_TO_ENQUEUE, frame.data[0]);
+    LONGS_EQUAL(Diagnostics::HISTOGRAM_SUMMARY, frame.data[1]);
+}
+#else
+TEST(App_Diagnostics, HistogramRequestWithoutTimestampsIsNotAnswered)
+{
+    App app(txQueue, batteryModel, diagnostics);
+
+    // No stage is measured, so there is nothing to dump; the request
+    // itself is still not forwarded
+    CAN_FRAME request;
+    memset(&request, 0, sizeof(request));
+    request.ID = Diagnostics::REQUEST_ID;
+    request.dlc = 1;
+    request.data[0] = Diagnostics::REQUEST_ALL_HISTOGRAMS;
+    app.canMsgReceived(request);
+
+    CHECK(txQueue->isEmpty());
+}
+#endif
+
+TEST(App_Diagnostics, HistogramRequestForOneStage)
+{
+    LatencyHistogram mailbox;
+    diagnostics->setLatencyHistogram(Diagnostics::HISTOGRAM_ENQUEUE_TO_MAILBOX, &mailbox);
+    App app(txQueue, batteryModel, diagnostics);
+
+    CAN_FRAME request;
+    memset(&request, 0, sizeof(request));
+    request.ID = Diagnostics::REQUEST_ID;
+    request.dlc = 1;
+    request.data[0] = Diagnostics::PAGE_HISTOGRAM + Diagnostics::HISTOGRAM_ENQUEUE_TO_MAILBOX;
+    app.canMsgReceived(request);
+
+    CAN_FRAME frame;
+    LONGS_EQUAL(1, txQueue->lane(0).length());
+    CHECK(txQueue->lane(0).pop(&frame));
+    LONGS_EQUAL(0xB2, frame.data[0]);
+
+    // Unknown requests are ignored
+    request.data[0] = 0x10;
+    app.canMsgReceived(request);
+    CHECK(txQueue->isEmpty());
+}
+
+TEST(App_Diagnostics, HistogramDumpThatDoesNotFitIsLeftOut)
+{
+    LatencyHistogram mailbox;
+    diagnostics->setLatencyHistogram(Diagnostics::HISTOGRAM_ENQUEUE_TO_MAILBOX, &mailbox);
+    App app(txQueue, batteryModel, diagnostics);
+
+    // A full lane of queued 0x721 pages, which a dump frame would coalesce with
+    CAN_FRAME page;
+    memset(&page, 0, sizeof(page));
+    page.ID = Diagnostics::MESSAGE_ID;
+    page.dlc = 8;
+    page.data[0] = Diagnostics::PAGE_QUEUE_OCCUPANCY;
+    while (!txQueue->lane(0).isFull())
+    {
+        CHECK(txQueue->push(page));
+    }
+
+    CAN_FRAME request;
+    memset(&request, 0, sizeof(request));
+    request.ID = Diagnostics::REQUEST_ID;
+    request.dlc = 1;
+    request.data[0] = Diagnostics::REQUEST_ALL_HISTOGRAMS;
+    app.canMsgReceived(request);
+
+    CAN_FRAME frame;
+    int pages = 0;
+    while (txQueue->lane(0).pop(&frame))
+    {
+        LONGS_EQUAL(Diagnostics::PAGE_QUEUE_OCCUPANCY, frame.data[0]);
+        pages++;
+    }
+    LONGS_EQUAL(QUEUE_CAPACITY, pages);
+}
+
+TEST(App_Diagnostics, NoDiagnosticsOnlyHeartbeat)
+{
+    App app(txQueue, batteryModel);
+
+    app.timeTickMs(1000);
+    LONGS_EQUAL(2, txQueue->length());
+    LONGS_EQUAL(1, countQueued(0, 0x720));
+    LONGS_EQUAL(1, countQueued(1, 0x720));
+}
+
+TEST(App_Diagnostics, NoCpuProfileLoadBytesZero)
+{
+    App app(txQueue, batteryModel);
+
+    app.timeTickMs(1000);
+    CAN_FRAME frame;
+    CHECK(txQueue->lane(0).pop(&frame));
+    LONGS_EQUAL(0, frame.data[2]);
+    LONGS_EQUAL(0, frame.data[3]);
+}
+
+TEST_GROUP(App_HandledIds)
+{
+};
+
+TEST(App_HandledIds, ModelFramesAreHandled)
+{
+    CHECK(AppHandlesId(0x373));
+    CHECK(AppHandlesId(0x374));
+}
+
+TEST(App_HandledIds, OtherFramesArePassthrough)
+{
+    CHECK_FALSE(AppHandlesId(0x372));
+    CHECK_FALSE(AppHandlesId(0x720));
+    CHECK_FALSE(AppHandlesId(0x18DAF110));
+}
+
+#ifdef CAN_HW_TIMESTAMPS
+TEST_GROUP(App_HwTimestamps)
+{
+    CanTxQueue *txQueue;
+    MockBatteryModel *batteryModel;
+    Diagnostics *diagnostics;
+    App *app;
+
+    void setup()
+    {
+        batteryModel = new MockBatteryModel(BATTERY_PACK_AH_CAPACITY);
+        txQueue = new CanTxQueue();
+        diagnostics = new Diagnostics();
+        app = new App(txQueue, batteryModel, diagnostics);
+    }
+
+    void teardown()
+    {
+        delete app;
+        delete diagnostics;
+        delete txQueue;
+        delete batteryModel;
+        mock().clear();
+    }
+
+    // Receive a 0x373 frame with a hardware receive time, expecting the
+    // battery model to integrate deltaTMs
+    void receive373(uint32_t rxTime, uint32_t deltaTMs, uint8_t rxChannel = 0)
+    {
+        CAN_FRAME frame;
+        memset(&frame, 0, sizeof(frame));
+        frame.ID = CanMessage373::MESSAGE_ID;
+        frame.dlc = 8;
+        frame.rx_channel = rxChannel;
+        frame.rx_time = rxTime;
+
+        mock().expectOneCall("update").onObject(batteryModel).withParameter("deltaTMs", deltaTMs).ignoreOtherParameters();
+        app->canMsgReceived(frame);
+        mock().checkExpectations();
+    }
+};
+
+TEST(App_HwTimestamps, FirstFrameUsesNominalPeriod)
+{
+    receive373(123456, CanMessage373::RECURRANCE_MS);
+}
+
+TEST(App_HwTimestamps, IntervalFromHardwareTimestamps)
+{
+    receive373(0xFFFFF000, CanMessage373::RECURRANCE_MS);
+    // 12 ms later, across the 32-bit wrap
+    receive373(0xFFFFF000 + 12 * CAN_BITS_PER_MS, 12);
+}
+
+TEST(App_HwTimestamps, RemainderCarriedToNextInterval)
+{
+    // 9.5 ms intervals integrate as 9 ms, then 10 ms
+    uint32_t interval = 9 * CAN_BITS_PER_MS + CAN_BITS_PER_MS / 2;
+    receive373(0, CanMessage373::RECURRANCE_MS);
+    receive373(interval, 9);
+    receive373(2 * interval, 10);
+}
+
+TEST(App_HwTimestamps, GapUsesNominalPeriod)
+{
+    receive373(0, CanMessage373::RECURRANCE_MS);
+    receive373((App::MAX_373_INTERVAL_MS + 1) * CAN_BITS_PER_MS, CanMessage373::RECURRANCE_MS);
+    receive373((App::MAX_373_INTERVAL_MS + 11) * CAN_BITS_PER_MS, 10);
+}
+
+TEST(App_HwTimestamps, ZeroIntervalUsesNominalPeriod)
+{
+    receive373(5000, CanMessage373::RECURRANCE_MS);
+    receive373(5000, CanMessage373::RECURRANCE_MS);
+}
+
+TEST(App_HwTimestamps, ChannelChangeUsesNominalPeriod)
+{
+    // The controllers' receive times are unrelated
+    receive373(1000, CanMessage373::RECURRANCE_MS, 0);
+    receive373(1000 + 5 * CAN_BITS_PER_MS, CanMessage373::RECURRANCE_MS, 1);
+    receive373(1000 + 15 * CAN_BITS_PER_MS, 10, 1);
+    receive373(1000 + 20 * CAN_BITS_PER_MS, CanMessage373::RECURRANCE_MS, 0);
+}
+
+TEST(App_HwTimestamps, IntervalsReportedOnDiagnosticsPage)
+{
+    receive373(0, CanMessage373::RECURRANCE_MS);
+    receive373(5000, 10);
+    receive373(5500, 1);
+    // The receive interval page, then the scheduler page
+    LONGS_EQUAL(2, diagnostics->pageCount());
+
+    // Intervals of 10000 us and 1000 us
+    CAN_FRAME page;
+    CHECK(diagnostics->buildPage(0, &page));
+    LONGS_EQUAL(Diagnostics::PAGE_RX_INTERVAL, page.data[0]);
+    LONGS_EQUAL(1000, (page.data[1] << 8) | page.data[2]);
+    LONGS_EQUAL(5500, (page.data[3] << 8) | page.data[4]);
+    LONGS_EQUAL(10000, (page.data[5] << 16) | (page.data[6] << 8) | page.data[7]);
+}
+#endif
@@ -0,0 +1,152 @@
+/**
+ * @file test_can_error_monitor.cpp
+ * @brief Unit tests for CanErrorMonitor class
+ */
+
+#include "CppUTest/TestHarness.h"
+#include "CanErrorMonitor.h"
+
+// ESR value with the given flags and error counters
+static uint32_t Esr(uint32_t flags, uint8_t tec, uint8_t rec)
+{
+    return flags | ((uint32_t)tec << CAN_ERROR_ESR_TEC_SHIFT) | ((uint32_t)rec << CAN_ERROR_ESR_REC_SHIFT);
+}
+
+TEST_GROUP(CanErrorMonitor)
+{
+    CanErrorMonitor monitor;
+    uint32_t esr;
+
+    // Sample with the ESR holding the given value
+    void sample(uint32_t value, uint32_t elapsedMs, uint32_t nowMs)
+    {
+        esr = value;
+        monitor.sample(&esr, elapsedMs, nowMs);
+    }
+};
+
+TEST(CanErrorMonitor, StartsErrorActiveAndOnTheBus)
+{
+    LONGS_EQUAL(CanErrorMonitor::STATE_ACTIVE, monitor.state());
+    CHECK(monitor.onBus());
+    LONGS_EQUAL(0, monitor.busOffs());
+    LONGS_EQUAL(0, monitor.framesDropped());
+    LONGS_EQUAL(0, monitor.maxRecoveryMs());
+}
+
+TEST(CanErrorMonitor, StateIsTheWorstFlagSet)
+{
+    LONGS_EQUAL(CanErrorMonitor::STATE_ACTIVE, CanErrorMonitor::stateOf(0));
+    LONGS_EQUAL(CanErrorMonitor::STATE_WARNING, CanErrorMonitor::stateOf(CAN_ERROR_ESR_EWGF));
+    LONGS_EQUAL(CanErrorMonitor::STATE_PASSIVE,
+                CanErrorMonitor::stateOf(CAN_ERROR_ESR_EWGF | CAN_ERROR_ESR_EPVF));
+    LONGS_EQUAL(CanErrorMonitor::STATE_BUS_OFF,
+                CanErrorMonitor::stateOf(CAN_ERROR_ESR_EWGF | CAN_ERROR_ESR_EPVF | CAN_ERROR_ESR_BOFF));
+}
+
+TEST(CanErrorMonitor, CountsErrorsByLastErrorCode)
+{
+    monitor.onError(CanErrorMonitor::ERROR_ACK);
+    monitor.onError(CanErrorMonitor::ERROR_ACK);
+    monitor.onError(CanErrorMonitor::ERROR_CRC);
+
+    LONGS_EQUAL(2, monitor.errors(CanErrorMonitor::ERROR_ACK));
+    LONGS_EQUAL(1, monitor.errors(CanErrorMonitor::ERROR_CRC));
+    LONGS_EQUAL(0, monitor.errors(CanErrorMonitor::ERROR_STUFF));
+}
+
+TEST(CanErrorMonitor, NoErrorAndSoftwareCodesAreNotCounted)
+{
+    monitor.onError(CanErrorMonitor::ERROR_NONE);
+    monitor.onError(CanErrorMonitor::ERROR_SET_BY_SOFTWARE);
+
+    LONGS_EQUAL(0, monitor.errors(CanErrorMonitor::ERROR_NONE));
+    LONGS_EQUAL(0, monitor.errors(CanErrorMonitor::ERROR_SET_BY_SOFTWARE));
+}
+
+TEST(CanErrorMonitor, SampleKeepsTheCountersAndState)
+{
+    sample(Esr(CAN_ERROR_ESR_EWGF | CAN_ERROR_ESR_EPVF, 136, 3), 1, 1);
+
+    LONGS_EQUAL(CanErrorMonitor::STATE_PASSIVE, monitor.state());
+    LONGS_EQUAL(136, monitor.tec());
+    LONGS_EQUAL(3, monitor.rec());
+    LONGS_EQUAL(1, monitor.entries(CanErrorMonitor::STATE_PASSIVE));
+}
+
+TEST(CanErrorMonitor, TimeCountsInTheStateThePreviousSampleSaw)
+{
+    sample(0, 10, 10);
+    sample(Esr(CAN_ERROR_ESR_EWGF, 100, 0), 5, 15);
+    sample(Esr(CAN_ERROR_ESR_EWGF, 99, 0), 7, 22);
+    sample(0, 3, 25);
+
+    LONGS_EQUAL(15, monitor.timeInStateMs(CanErrorMonitor::STATE_ACTIVE));
+    LONGS_EQUAL(10, monitor.timeInStateMs(CanErrorMonitor::STATE_WARNING));
+    LONGS_EQUAL(1, monitor.entries(CanErrorMonitor::STATE_WARNING));
+    LONGS_EQUAL(1, monitor.entries(CanErrorMonitor::STATE_ACTIVE));
+}
+
+TEST(CanErrorMonitor, OffTheBusFromBusOffUntilRecovered)
+{
+    monitor.onBusOff(100, 3);
+    CHECK_FALSE(monitor.onBus());
+    LONGS_EQUAL(1, monitor.busOffs());
+    LONGS_EQUAL(3, monitor.framesDropped());
+
+    // Still recovering
+    sample(Esr(CAN_ERROR_ESR_EWGF | CAN_ERROR_ESR_EPVF | CAN_ERROR_ESR_BOFF, 248, 0), 1, 101);
+    CHECK_FALSE(monitor.onBus());
+    LONGS_EQUAL(CanErrorMonitor::STATE_BUS_OFF, monitor.state());
+
+    sample(0, 3, 104);
+    CHECK(monitor.onBus());
+    LONGS_EQUAL(CanErrorMonitor::STATE_ACTIVE, monitor.state());
+    LONGS_EQUAL(4, monitor.lastRecoveryMs());
+    LONGS_EQUAL(4, monitor.maxRecoveryMs());
+    LONGS_EQUAL(3, monitor.timeInStateMs(CanErrorMonitor::STATE_BUS_OFF));
+}
+
+TEST(CanErrorMonitor, EsrWithoutBusOffIsStaleUntilTheRecoveryCouldBeOver)
+{
+    // An ESR read before the bus-off does not show its recovery
+    monitor.onBusOff(50, 0);
+    sample(0, 1, 50);
+    sample(0, 1, 50 + CAN_BUS_OFF_RECOVERY_MIN_MS - 1);
+    CHECK_FALSE(monitor.onBus());
+    LONGS_EQUAL(0, monitor.lastRecoveryMs());
+
+    sample(0, 1, 50 + CAN_BUS_OFF_RECOVERY_MIN_MS);
+    CHECK(monitor.onBus());
+    LONGS_EQUAL(CAN_BUS_OFF_RECOVERY_MIN_MS, monitor.lastRecoveryMs());
+}
+
+TEST(CanErrorMonitor, RecoveryBetweenSamplesIsStillSeen)
+{
+    monitor.onBusOff(50, 0);
+    sample(0, 5, 55);
+
+    CHECK(monitor.onBus());
+    LONGS_EQUAL(5, monitor.lastRecoveryMs());
+}
+
+TEST(CanErrorMonitor, KeepsTheLongestRecovery)
+{
+    monitor.onBusOff(0, 0);
+    sample(0, 1, 20);
+    monitor.onBusOff(100, 0);
+    sample(0, 1, 105);
+
+    LONGS_EQUAL(5, monitor.lastRecoveryMs());
+    LONGS_EQUAL(20, monitor.maxRecoveryMs());
+    LONGS_EQUAL(2, monitor.busOffs());
+}
+
+TEST(CanErrorMonitor, DroppedFramesAddToAbortedOnes)
+{
+    monitor.onBusOff(0, 2);
+    monitor.onDropped(10);
+    monitor.onDropped(5);
+
+    LONGS_EQUAL(17, monitor.framesDropped());
+}
@@ -0,0 +1,64 @@
+/**
+ * @file test_can_filter_table.cpp
+ * @brief Unit tests for CanFilterTable class
+ */
+
+#include "CppUTest/TestHarness.h"
+#include "CanFilterTable.h"
+#include "App.h"
+
+TEST_GROUP(CanFilterTable)
+{
+};
+
+TEST(CanFilterTable, StdIdRegisterLayout)
+{
+    // STID in bits 31:21, IDE and RTR clear
+    LONGS_EQUAL(0x6E600000UL, CanFilterTable<1>::stdIdRegister(0x373));
+    LONGS_EQUAL(0xFFE00000UL, CanFilterTable<1>::stdIdRegister(0x7FF));
+    LONGS_EQUAL(0x00200000UL, CanFilterTable<1>::stdIdRegister(0x801));
+}
+
+TEST(CanFilterTable, TwoIdsPerListBankThenAcceptAll)
+{
+    const uint16_t ids[] = {0x100, 0x200, 0x300, 0x400};
+    CanFilterTable<4> table(ids);
+
+    LONGS_EQUAL(3, table.bankCount());
+    for (uint8_t i = 0; i < 2; i++)
+    {
+        CHECK(table.bank(i).listMode);
+        LONGS_EQUAL(1, table.bank(i).fifo);
+        LONGS_EQUAL(CanFilterTable<4>::stdIdRegister(ids[2 * i]), table.bank(i).fr1);
+        LONGS_EQUAL(CanFilterTable<4>::stdIdRegister(ids[2 * i + 1]), table.bank(i).fr2);
+    }
+
+    const CanFilterBank &all = table.bank(2);
+    CHECK_FALSE(all.listMode);
+    LONGS_EQUAL(0, all.fifo);
+    LONGS_EQUAL(0, all.fr1);
+    LONGS_EQUAL(0, all.fr2);
+}
+
+TEST(CanFilterTable, OddCountRepeatsLastId)
+{
+    const uint16_t ids[] = {0x100, 0x200, 0x300};
+    CanFilterTable<3> table(ids);
+
+    LONGS_EQUAL(3, table.bankCount());
+    LONGS_EQUAL(CanFilterTable<3>::stdIdRegister(0x300), table.bank(1).fr1);
+    LONGS_EQUAL(CanFilterTable<3>::stdIdRegister(0x300), table.bank(1).fr2);
+}
+
+TEST(CanFilterTable, AppHandledIdsGoToFifo1)
+{
+    CanFilterTable<APP_HANDLED_ID_COUNT> table(APP_HANDLED_IDS);
+
+    LONGS_EQUAL(3, table.bankCount());
+    LONGS_EQUAL(1, table.bank(0).fifo);
+    LONGS_EQUAL(CanFilterTable<APP_HANDLED_ID_COUNT>::stdIdRegister(0x373), table.bank(0).fr1);
+    LONGS_EQUAL(CanFilterTable<APP_HANDLED_ID_COUNT>::stdIdRegister(0x374), table.bank(0).fr2);
+    LONGS_EQUAL(1, table.bank(1).fifo);
+    LONGS_EQUAL(CanFilterTable<APP_HANDLED_ID_COUNT>::stdIdRegister(0x722), table.bank(1).fr1);
+    LONGS_EQUAL(0, table.bank(2).fifo);
+}
@@ -0,0 +1,125 @@
+/**
+ * @file test_can_lane_queue.cpp
+ * @brief Unit tests for CanLaneQueue class
+ */
+
+#include "CppUTest/TestHarness.h"
+#include "CanLaneQueue.h"
+#include "CanQueue.h"
+#include <string.h>
+
+TEST_GROUP(CanLaneQueue)
+{
+    CanLaneQueue<CanQueue<4>, 2> queue;
+    CAN_FRAME frame;
+
+    void setup()
+    {
+        memset(&frame, 0, sizeof(CAN_FRAME));
+        frame.dlc = 8;
+    }
+
+    void teardown()
+    {
+    }
+
+    void pushFrame(uint32_t id, uint8_t channel)
+    {
+        frame.ID = id;
+        frame.tx_channel = channel;
+        CHECK(queue.push(frame));
+    }
+};
+
+TEST(CanLaneQueue, Construction)
+{
+    CHECK(queue.isEmpty());
+    LONGS_EQUAL(0, queue.length());
+    LONGS_EQUAL(8, queue.capacity());
+    LONGS_EQUAL(2, queue.laneCount());
+}
+
+TEST(CanLaneQueue, PushRoutesByTxChannel)
+{
+    pushFrame(0x100, 0);
+    pushFrame(0x200, 1);
+    pushFrame(0x201, 1);
+
+    LONGS_EQUAL(3, queue.length());
+    LONGS_EQUAL(1, queue.lane(0).length());
+    LONGS_EQUAL(2, queue.lane(1).length());
+
+    CAN_FRAME popped;
+    memset(&popped, 0, sizeof(popped));
+    CHECK(queue.lane(1).pop(&popped));
+    LONGS_EQUAL(0x200, popped.ID);
+}
+
+TEST(CanLaneQueue, PushInvalidChannelFails)
+{
+    frame.tx_channel = 2;
+    CHECK_FALSE(queue.push(frame));
+    POINTERS_EQUAL(nullptr, queue.reserve(2));
+    CHECK(queue.isEmpty());
+}
+
+TEST(CanLaneQueue, FullLaneDoesNotBlockOtherLane)
+{
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        pushFrame(0x100 + i, 1);
+    }
+    CHECK(queue.lane(1).isFull());
+
+    frame.tx_channel = 1;
+    CHECK_FALSE(queue.push(frame));
+
+    // Lane 0 is unaffected by the full lane 1
+    pushFrame(0x300, 0);
+    CAN_FRAME *head = queue.lane(0).front();
+    CHECK(head != nullptr);
+    LONGS_EQUAL(0x300, head->ID);
+}
+
+TEST(CanLaneQueue, ReserveCommitOnLane)
+{
+    CAN_FRAME *slot = queue.reserve(1);
+    CHECK(slot != nullptr);
+    slot->ID = 0x555;
+    slot->tx_channel = 1;
+    CHECK(queue.isEmpty());
+
+    queue.commit(1);
+    LONGS_EQUAL(1, queue.lane(1).length());
+    LONGS_EQUAL(0, queue.lane(0).length());
+}
+
+TEST(CanLaneQueue, PopTakesLowestLaneFirst)
+{
+    pushFrame(0x200, 1);
+    pushFrame(0x100, 0);
+    pushFrame(0x101, 0);
+
+    CAN_FRAME popped;
+    memset(&popped, 0, sizeof(popped));
+    CHECK(queue.peek(&popped));
+    LONGS_EQUAL(0x100, popped.ID);
+
+    CHECK(queue.pop(&popped));
+    LONGS_EQUAL(0x100, popped.ID);
+    CHECK(queue.pop(&popped));
+    LONGS_EQUAL(0x101, popped.ID);
+    CHECK(queue.pop(&popped));
+    LONGS_EQUAL(0x200, popped.ID);
+    CHECK_FALSE(queue.pop(&popped));
+    CHECK(queue.isEmpty());
+}
+
+TEST(CanLaneQueue, Clear)
+{
+    pushFrame(0x100, 0);
+    pushFrame(0x200, 1);
+    queue.clear();
+    CHECK(queue.isEmpty());
+    LONGS_EQUAL(0, queue.length());
+}
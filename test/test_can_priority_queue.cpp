@@ -0,0 +1,342 @@
+/**
+ * @file test_can_priority_queue.cpp
+ * @brief Unit tests for CanPriorityQueue class
+ */
+
+#include "CppUTest/TestHarness.h"
+#include "CanPriorityQueue.h"
+#include <string.h>
+
+TEST_GROUP(CanPriorityQueue)
+{
+    CanPriorityQueue<16> queue;
+    CAN_FRAME frame;
+
+    void setup()
+    {
+        memset(&frame, 0, sizeof(CAN_FRAME));
+        frame.dlc = 8;
+    }
+
+    void teardown()
+    {
+    }
+
+    void pushFrame(uint32_t id, uint8_t tag)
+    {
+        frame.ID = id;
+        frame.data[0] = tag;
+        CHECK(queue.push(frame));
+    }
+};
+
+TEST(CanPriorityQueue, Construction)
+{
+    CHECK(queue.isEmpty());
+    CHECK_FALSE(queue.isFull());
+    LONGS_EQUAL(0, queue.length());
+    LONGS_EQUAL(16, queue.capacity());
+    LONGS_EQUAL(16, queue.available());
+    POINTERS_EQUAL(nullptr, queue.front());
+}
+
+TEST(CanPriorityQueue, PopsLowestIdFirst)
+{
+    pushFrame(0x700, 0);
+    pushFrame(0x123, 0);
+    pushFrame(0x374, 0);
+    pushFrame(0x001, 0);
+
+    const uint32_t expected[] = {0x001, 0x123, 0x374, 0x700};
+    CAN_FRAME popped;
+    memset(&popped, 0, sizeof(popped));
+    for (int i = 0; i < 4; i++)
+    {
+        CHECK(queue.pop(&popped));
+        LONGS_EQUAL(expected[i], popped.ID);
+    }
+    CHECK_FALSE(queue.pop(&popped));
+}
+
+TEST(CanPriorityQueue, EqualIdsKeepQueueOrder)
+{
+    pushFrame(0x200, 1);
+    pushFrame(0x100, 9);
+    pushFrame(0x200, 2);
+    pushFrame(0x200, 3);
+
+    CAN_FRAME popped;
+    memset(&popped, 0, sizeof(popped));
+    CHECK(queue.pop(&popped));
+    LONGS_EQUAL(0x100, popped.ID);
+    for (int i = 1; i <= 3; i++)
+    {
+        CHECK(queue.pop(&popped));
+        LONGS_EQUAL(0x200, popped.ID);
+        LONGS_EQUAL(i, popped.data[0]);
+    }
+}
+
+TEST(CanPriorityQueue, EqualIdsKeepQueueOrderAcrossSequenceWrap)
+{
+    // Run the 16-bit sequence counter close to wrapping
+    for (uint32_t i = 0; i < 65534; i++)
+    {
+        pushFrame(0x200, 0);
+        CHECK(queue.pop(nullptr));
+    }
+
+    for (int i = 1; i <= 4; i++)
+    {
+        pushFrame(0x200, i);
+    }
+
+    CAN_FRAME popped;
+    memset(&popped, 0, sizeof(popped));
+    for (int i = 1; i <= 4; i++)
+    {
+        CHECK(queue.pop(&popped));
+        LONGS_EQUAL(i, popped.data[0]);
+    }
+}
+
+TEST(CanPriorityQueue, HighPriorityOvertakesBacklog)
+{
+    for (int i = 0; i < 15; i++)
+    {
+        pushFrame(0x600 + i, 0);
+    }
+    pushFrame(0x080, 0);
+    CHECK(queue.isFull());
+
+    CAN_FRAME peeked;
+    memset(&peeked, 0, sizeof(peeked));
+    CHECK(queue.peek(&peeked));
+    LONGS_EQUAL(0x080, peeked.ID);
+    CHECK_FALSE(queue.push(frame));
+}
+
+TEST(CanPriorityQueue, ArbitrationKeyFollowsBusRules)
+{
+    CAN_FRAME stdData;
+    memset(&stdData, 0, sizeof(stdData));
+    stdData.ID = 0x123;
+
+    CAN_FRAME stdRemote = stdData;
+    stdRemote.rtr = 2;
+
+    // Extended frame sharing the standard frame's 11 base bits
+    CAN_FRAME extData = stdData;
+    extData.ide = 4;
+    extData.ID = (0x123UL << 18) | 0x00001;
+
+    // Extended frame with lower base bits beats a higher standard ID
+    CAN_FRAME extLow = extData;
+    extLow.ID = (0x122UL << 18) | 0x3FFFF;
+
+    typedef CanPriorityQueue<16> Queue;
+    CHECK(Queue::arbitrationKey(stdData) < Queue::arbitrationKey(stdRemote));
+    CHECK(Queue::arbitrationKey(stdRemote) < Queue::arbitrationKey(extData));
+    CHECK(Queue::arbitrationKey(extLow) < Queue::arbitrationKey(stdData));
+}
+
+TEST(CanPriorityQueue, ReserveCommitOrdersOnCommit)
+{
+    pushFrame(0x300, 0);
+
+    CAN_FRAME *slot = queue.reserve();
+    CHECK(slot != nullptr);
+    LONGS_EQUAL(1, queue.length());
+    slot->ID = 0x050;
+    slot->dlc = 8;
+    queue.commit();
+
+    CAN_FRAME *head = queue.front();
+    CHECK(head != nullptr);
+    LONGS_EQUAL(0x050, head->ID);
+    LONGS_EQUAL(2, queue.length());
+}
+
+TEST(CanPriorityQueue, FrontReleaseInPlace)
+{
+    pushFrame(0x400, 0);
+    pushFrame(0x200, 0);
+    pushFrame(0x300, 0);
+
+    CAN_FRAME *head = queue.front();
+    LONGS_EQUAL(0x200, head->ID);
+    queue.release();
+
+    head = queue.front();
+    LONGS_EQUAL(0x300, head->ID);
+    queue.release(2);
+    CHECK(queue.isEmpty());
+}
+
+TEST(CanPriorityQueue, SlotsAreReused)
+{
+    // Cycle many more frames than the pool holds through the queue
+    CAN_FRAME popped;
+    for (uint32_t i = 0; i < 200; i++)
+    {
+        pushFrame(0x7FF - (i % 50), (uint8_t)i);
+        if (queue.isFull())
+        {
+            uint32_t previous = 0;
+            while (queue.pop(&popped))
+            {
+                CHECK(popped.ID >= previous);
+                previous = popped.ID;
+            }
+        }
+    }
+    LONGS_EQUAL(200 % 16, queue.length());
+}
+
+TEST(CanPriorityQueue, Clear)
+{
+    pushFrame(0x100, 0);
+    pushFrame(0x200, 0);
+    queue.clear();
+
+    CHECK(queue.isEmpty());
+    LONGS_EQUAL(16, queue.available());
+    pushFrame(0x300, 0);
+    LONGS_EQUAL(0x300, queue.front()->ID);
+}
+
+TEST_GROUP(CanPriorityQueue_Overflow)
+{
+    CAN_FRAME frame;
+
+    void setup()
+    {
+        memset(&frame, 0, sizeof(CAN_FRAME));
+        frame.dlc = 8;
+    }
+
+    // Queue IDs 0x104, 0x103, 0x102, 0x101: oldest is the lowest priority
+    template<class QUEUE>
+    void fill(QUEUE &queue)
+    {
+        for (uint32_t i = 0; i < queue.capacity(); i++)
+        {
+            frame.ID = 0x104 - i;
+            frame.data[0] = (uint8_t)i;
+            CHECK(queue.push(frame));
+        }
+    }
+};
+
+TEST(CanPriorityQueue_Overflow, DropNewestRejectsFrame)
+{
+    CanPriorityQueue<4, QueueStats> queue;
+    fill(queue);
+
+    frame.ID = 0x001;
+    CHECK_FALSE(queue.push(frame));
+    POINTERS_EQUAL(nullptr, queue.reserve());
+    LONGS_EQUAL(2, queue.stats().drops());
+    LONGS_EQUAL(0x101, queue.front()->ID);
+}
+
+TEST(CanPriorityQueue_Overflow, DropOldestEvictsFirstQueued)
+{
+    CanPriorityQueue<4, QueueStats, CAN_QUEUE_DROP_OLDEST> queue;
+    fill(queue);
+
+    frame.ID = 0x050;
+    CHECK(queue.push(frame));
+
+    CAN_FRAME *slot = queue.reserve();
+    CHECK(slot != nullptr);
+    *slot = frame;
+    slot->ID = 0x700;
+    queue.commit();
+
+    LONGS_EQUAL(4, queue.length());
+    LONGS_EQUAL(2, queue.stats().drops());
+
+    // 0x104 and 0x103 were queued first and are gone
+    const uint32_t expected[] = {0x050, 0x101, 0x102, 0x700};
+    CAN_FRAME popped;
+    memset(&popped, 0, sizeof(popped));
+    for (int i = 0; i < 4; i++)
+    {
+        CHECK(queue.pop(&popped));
+        LONGS_EQUAL(expected[i], popped.ID);
+    }
+}
+
+TEST(CanPriorityQueue_Overflow, DropOldestKeepsHeapOrder)
+{
+    CanPriorityQueue<16, NoQueueStats, CAN_QUEUE_DROP_OLDEST> queue;
+    for (uint32_t i = 0; i < 200; i++)
+    {
+        frame.ID = (i * 0x2B5) & 0x7FF;
+        queue.push(frame);
+    }
+
+    CAN_FRAME popped;
+    uint32_t previous = 0;
+    while (queue.pop(&popped))
+    {
+        CHECK(popped.ID >= previous);
+        previous = popped.ID;
+    }
+}
+
+TEST(CanPriorityQueue_Overflow, CoalesceReplacesSameIdInPlace)
+{
+    CanPriorityQueue<4, QueueStats, CAN_QUEUE_COALESCE> queue;
+    fill(queue);
+
+    frame.ID = 0x103;
+    frame.data[0] = 0xAA;
+    CHECK(queue.push(frame));
+
+    CAN_FRAME *slot = queue.reserve();
+    *slot = frame;
+    slot->ID = 0x101;
+    slot->data[0] = 0xBB;
+    queue.commit();
+
+    frame.ID = 0x105;
+    CHECK_FALSE(queue.push(frame));
+
+    LONGS_EQUAL(4, queue.length());
+    LONGS_EQUAL(3, queue.stats().drops());
+
+    const uint8_t expected[] = {0xBB, 0x02, 0xAA, 0x00};
+    CAN_FRAME popped;
+    memset(&popped, 0, sizeof(popped));
+    for (int i = 0; i < 4; i++)
+    {
+        CHECK(queue.pop(&popped));
+        LONGS_EQUAL(0x101 + i, popped.ID);
+        LONGS_EQUAL(expected[i], popped.data[0]);
+    }
+}
+
+TEST(CanPriorityQueue_Overflow, CoalesceKeepsOrderOfEqualIds)
+{
+    CanPriorityQueue<4, NoQueueStats, CAN_QUEUE_COALESCE> queue;
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        frame.ID = 0x374;
+        frame.data[0] = i;
+        CHECK(queue.push(frame));
+    }
+
+    frame.data[0] = 9;
+    CHECK(queue.push(frame));
+
+    const uint8_t expected[] = {0, 1, 2, 9};
+    CAN_FRAME popped;
+    memset(&popped, 0, sizeof(popped));
+    for (int i = 0; i < 4; i++)
+    {
+        CHECK(queue.pop(&popped));
+        LONGS_EQUAL(expected[i], popped.data[0]);
+    }
+}
@@ -560,4 +560,282 @@ TEST(CanQueue_MemoryHandling, TakesCopyOfFrame)
     queue.pop(&popped);
     // Verify popped frame is unchanged
     LONGS_EQUAL(0x123, popped.ID);
-}
\ No newline at end of file
+}
+TEST_GROUP(CanQueue_InPlaceAccess)
+{
+    CanQueue<4> queue;
+
+    void setup()
+    {
+    }
+
+    void teardown()
+    {
+    }
+};
+
+TEST(CanQueue_InPlaceAccess, ReserveCommitAddsFrame)
+{
+    CAN_FRAME *slot = queue.reserve();
+    CHECK(slot != nullptr);
+    // Nothing is queued until the slot is committed
+    CHECK(queue.isEmpty());
+
+    slot->ID = 0x321;
+    slot->dlc = 2;
+    queue.commit();
+
+    LONGS_EQUAL(1, queue.length());
+    CAN_FRAME popped;
+    memset(&popped, 0, sizeof(popped));
+    CHECK(queue.pop(&popped));
+    LONGS_EQUAL(0x321, popped.ID);
+    LONGS_EQUAL(2, popped.dlc);
+}
+
+TEST(CanQueue_InPlaceAccess, AbandonedReservationIsReused)
+{
+    CAN_FRAME *first = queue.reserve();
+    CAN_FRAME *second = queue.reserve();
+    POINTERS_EQUAL(first, second);
+    CHECK(queue.isEmpty());
+}
+
+TEST(CanQueue_InPlaceAccess, ReserveFullQueue)
+{
+    CAN_FRAME frame;
+    frame.ID = 0x100;
+    for (int i = 0; i < 4; i++)
+    {
+        queue.push(frame);
+    }
+
+    POINTERS_EQUAL(nullptr, queue.reserve());
+}
+
+TEST(CanQueue_InPlaceAccess, FrontReleaseInOrder)
+{
+    CAN_FRAME frame;
+    for (uint32_t i = 0; i < 6; i++)
+    {
+        frame.ID = 0x200 + i;
+        queue.push(frame);
+        if (i >= 2)
+        {
+            // Keep the queue moving so front() wraps around the buffer
+            CAN_FRAME *head = queue.front();
+            CHECK(head != nullptr);
+            LONGS_EQUAL(0x200 + i - 2, head->ID);
+            queue.release();
+        }
+    }
+    LONGS_EQUAL(2, queue.length());
+}
+
+TEST(CanQueue_InPlaceAccess, FrontEmptyQueue)
+{
+    POINTERS_EQUAL(nullptr, queue.front());
+}
+
+TEST(CanQueue_InPlaceAccess, FrontCanModifyInPlace)
+{
+    CAN_FRAME frame;
+    frame.ID = 0x374;
+    frame.data[0] = 0x00;
+    queue.push(frame);
+
+    queue.front()->data[0] = 0xAB;
+
+    CAN_FRAME popped;
+    memset(&popped, 0, sizeof(popped));
+    CHECK(queue.pop(&popped));
+    LONGS_EQUAL(0xAB, popped.data[0]);
+}
+
+TEST(CanQueue_InPlaceAccess, FrontSpanStopsAtBufferEnd)
+{
+    CAN_FRAME frame;
+    // Start the queue two slots before the end of the buffer, then add 3
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        queue.push(frame);
+        queue.pop(nullptr);
+    }
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        frame.ID = 0x300 + i;
+        queue.push(frame);
+    }
+
+    CAN_FRAME *frames;
+    LONGS_EQUAL(2, queue.frontSpan(&frames));
+    LONGS_EQUAL(0x300, frames[0].ID);
+    LONGS_EQUAL(0x301, frames[1].ID);
+    queue.release(2);
+
+    LONGS_EQUAL(1, queue.frontSpan(&frames));
+    LONGS_EQUAL(0x302, frames[0].ID);
+    queue.release(1);
+
+    LONGS_EQUAL(0, queue.frontSpan(&frames));
+    POINTERS_EQUAL(nullptr, frames);
+    CHECK(queue.isEmpty());
+}
+
+TEST(CanQueue_InPlaceAccess, PopManyAcrossWrap)
+{
+    CAN_FRAME frame;
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        queue.push(frame);
+        queue.pop(nullptr);
+    }
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        frame.ID = 0x400 + i;
+        queue.push(frame);
+    }
+
+    CAN_FRAME out[8];
+    LONGS_EQUAL(3, queue.popMany(out, 3));
+    LONGS_EQUAL(1, queue.length());
+    LONGS_EQUAL(1, queue.popMany(out + 3, 8));
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        LONGS_EQUAL(0x400 + i, out[i].ID);
+    }
+    LONGS_EQUAL(0, queue.popMany(out, 8));
+}
+
+TEST_GROUP(CanQueue_Overflow)
+{
+    CAN_FRAME frame;
+
+    void setup()
+    {
+        memset(&frame, 0, sizeof(CAN_FRAME));
+        frame.dlc = 8;
+    }
+
+    template<class QUEUE>
+    void fill(QUEUE &queue)
+    {
+        for (uint32_t i = 0; i < queue.capacity(); i++)
+        {
+            frame.ID = 0x100 + i;
+            frame.data[0] = (uint8_t)i;
+            CHECK(queue.push(frame));
+        }
+    }
+};
+
+TEST(CanQueue_Overflow, DropNewestRejectsFrame)
+{
+    CanQueue<4, QueueStats, CAN_QUEUE_DROP_NEWEST> queue;
+    fill(queue);
+
+    frame.ID = 0x100;
+    CHECK_FALSE(queue.push(frame));
+    POINTERS_EQUAL(nullptr, queue.reserve());
+    LONGS_EQUAL(2, queue.stats().drops());
+
+    CAN_FRAME popped;
+    memset(&popped, 0, sizeof(popped));
+    CHECK(queue.pop(&popped));
+    LONGS_EQUAL(0, popped.data[0]);
+}
+
+TEST(CanQueue_Overflow, DropOldestEvictsFront)
+{
+    CanQueue<4, QueueStats, CAN_QUEUE_DROP_OLDEST> queue;
+    fill(queue);
+
+    frame.ID = 0x200;
+    CHECK(queue.push(frame));
+
+    // Also through reserve()/commit()
+    CAN_FRAME *slot = queue.reserve();
+    CHECK(slot != nullptr);
+    *slot = frame;
+    slot->ID = 0x201;
+    queue.commit();
+
+    LONGS_EQUAL(4, queue.length());
+    LONGS_EQUAL(2, queue.stats().drops());
+
+    const uint32_t expected[] = {0x102, 0x103, 0x200, 0x201};
+    CAN_FRAME popped;
+    memset(&popped, 0, sizeof(popped));
+    for (int i = 0; i < 4; i++)
+    {
+        CHECK(queue.pop(&popped));
+        LONGS_EQUAL(expected[i], popped.ID);
+    }
+}
+
+TEST(CanQueue_Overflow, CoalesceReplacesSameIdInPlace)
+{
+    CanQueue<4, QueueStats, CAN_QUEUE_COALESCE> queue;
+    fill(queue);
+
+    frame.ID = 0x101;
+    frame.data[0] = 0xAA;
+    CHECK(queue.push(frame));
+
+    CAN_FRAME *slot = queue.reserve();
+    *slot = frame;
+    slot->ID = 0x103;
+    slot->data[0] = 0xBB;
+    queue.commit();
+
+    LONGS_EQUAL(4, queue.length());
+    LONGS_EQUAL(2, queue.stats().drops());
+
+    const uint8_t expected[] = {0x00, 0xAA, 0x02, 0xBB};
+    CAN_FRAME popped;
+    memset(&popped, 0, sizeof(popped));
+    for (int i = 0; i < 4; i++)
+    {
+        CHECK(queue.pop(&popped));
+        LONGS_EQUAL(0x100 + i, popped.ID);
+        LONGS_EQUAL(expected[i], popped.data[0]);
+    }
+}
+
+TEST(CanQueue_Overflow, CoalesceReplacesNewestMatch)
+{
+    CanQueue<4, NoQueueStats, CAN_QUEUE_COALESCE> queue;
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        frame.ID = 0x373;
+        frame.data[0] = i;
+        CHECK(queue.push(frame));
+    }
+
+    frame.data[0] = 9;
+    CHECK(queue.push(frame));
+
+    const uint8_t expected[] = {0, 1, 2, 9};
+    CAN_FRAME popped;
+    memset(&popped, 0, sizeof(popped));
+    for (int i = 0; i < 4; i++)
+    {
+        CHECK(queue.pop(&popped));
+        LONGS_EQUAL(expected[i], popped.data[0]);
+    }
+}
+
+TEST(CanQueue_Overflow, CoalesceRequiresSameChannel)
+{
+    CanQueue<4, QueueStats, CAN_QUEUE_COALESCE> queue;
+    fill(queue);
+
+    frame.ID = 0x101;
+    frame.tx_channel = 1;
+    CHECK_FALSE(queue.push(frame));
+
+    frame.tx_channel = 0;
+    frame.ide = 4;
+    CHECK_FALSE(queue.push(frame));
+    LONGS_EQUAL(2, queue.stats().drops());
+}
@@ -0,0 +1,62 @@
+/**
+ * @file test_can_rx_mailbox.cpp
+ * @brief Unit tests for the register-level RX mailbox decoding
+ */
+
+#include "CppUTest/TestHarness.h"
+#include "CanRxMailbox.h"
+#include <string.h>
+
+TEST_GROUP(CanRxMailbox)
+{
+    CAN_FRAME frame;
+
+    void setup()
+    {
+        memset(&frame, 0xAA, sizeof(CAN_FRAME));
+    }
+};
+
+TEST(CanRxMailbox, StandardDataFrame)
+{
+    // STID 0x373 in bits 31:21, FMI and TIME in RDTR must be ignored
+    CanRxMailboxDecode(0x373UL << 21, 0x12340508UL, 0x44332211UL, 0x88776655UL, 1, &frame);
+
+    LONGS_EQUAL(0x373, frame.ID);
+    LONGS_EQUAL(0, frame.ide);
+    LONGS_EQUAL(0, frame.rtr);
+    LONGS_EQUAL(8, frame.dlc);
+    LONGS_EQUAL(1, frame.rx_channel);
+    const uint8_t expected[8] = {0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88};
+    MEMCMP_EQUAL(expected, frame.data, sizeof(expected));
+}
+
+TEST(CanRxMailbox, ExtendedRemoteFrame)
+{
+    uint32_t rir = (0x1ABCDEF0UL << 3) | CAN_RX_MAILBOX_IDE | CAN_RX_MAILBOX_RTR | 0x1;  // TXRQ bit is not part of the ID
+    CanRxMailboxDecode(rir, 0, 0, 0, 0, &frame);
+
+    LONGS_EQUAL(0x1ABCDEF0UL, frame.ID);
+    CHECK(frame.ide);
+    CHECK(frame.rtr);
+    LONGS_EQUAL(0, frame.dlc);
+    LONGS_EQUAL(0, frame.rx_channel);
+}
+
+TEST(CanRxMailbox, FlagsMatchHalEncoding)
+{
+    // HAL_CAN_GetRxMessage() reports IDE as CAN_ID_EXT (4) and RTR as
+    // CAN_RTR_REMOTE (2); both RX paths must fill frames the same way
+    CanRxMailboxDecode(CAN_RX_MAILBOX_IDE | CAN_RX_MAILBOX_RTR, 0, 0, 0, 0, &frame);
+    LONGS_EQUAL(4, frame.ide);
+    LONGS_EQUAL(2, frame.rtr);
+}
+
+#ifdef CAN_FRAME_TIMESTAMPS
+TEST(CanRxMailbox, TimestampUnchanged)
+{
+    frame.timestamp = 1234;
+    CanRxMailboxDecode(0, 0, 0, 0, 0, &frame);
+    LONGS_EQUAL(1234, frame.timestamp);
+}
+#endif
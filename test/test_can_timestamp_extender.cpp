@@ -0,0 +1,63 @@
+/**
+ * @file test_can_timestamp_extender.cpp
+ * @brief Unit tests for CanTimestampExtender class
+ */
+
+#include "CppUTest/TestHarness.h"
+#include "CanTimestampExtender.h"
+
+TEST_GROUP(CanTimestampExtender)
+{
+    CanTimestampExtender extender;
+};
+
+TEST(CanTimestampExtender, FirstSampleIsTakenAsIs)
+{
+    LONGS_EQUAL(0x1234, extender.extend(0x1234, 987654));
+}
+
+TEST(CanTimestampExtender, AccumulatesShortIntervals)
+{
+    extender.extend(1000, 0);
+    LONGS_EQUAL(6000, extender.extend(6000, 5000));
+    LONGS_EQUAL(11000, extender.extend(11000, 10000));
+}
+
+TEST(CanTimestampExtender, CarriesAcrossTimerWrap)
+{
+    extender.extend(65000, 0);
+    LONGS_EQUAL(65536 + 464, extender.extend(464, 1000));
+}
+
+TEST(CanTimestampExtender, AddsWholeTimerPeriodsFromCoarseClock)
+{
+    // Three whole periods and 100 bit times between frames
+    extender.extend(500, 0);
+    LONGS_EQUAL(500 + 3 * 65536 + 100, extender.extend(600, 3 * 65536 + 100));
+}
+
+TEST(CanTimestampExtender, ToleratesCoarseClockError)
+{
+    // The HAL tick is only accurate to a millisecond, 500 bit times
+    extender.extend(500, 1000);
+    LONGS_EQUAL(500 + 65536 + 100, extender.extend(600, 1000 + 65536 + 100 - 500));
+    LONGS_EQUAL(500 + 2 * 65536 + 200, extender.extend(700, 1000 + 2 * 65536 + 200 + 500));
+}
+
+TEST(CanTimestampExtender, CoarseClockBehindSampleAddsNoPeriod)
+{
+    // A tick that has not advanced yet while the timer has
+    extender.extend(100, 2000);
+    LONGS_EQUAL(400, extender.extend(400, 2000));
+}
+
+TEST(CanTimestampExtender, ExtendedTimeWraps)
+{
+    extender.extend(0xFF00, 0);
+    uint32_t t = 0xFF00;
+    for (int i = 0; i < 65536; i++)
+    {
+        t = extender.extend(0xFF00, (uint32_t)(i + 1) * 65536);
+    }
+    LONGS_EQUAL(0xFF00, t);
+}
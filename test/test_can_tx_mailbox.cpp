@@ -0,0 +1,104 @@
+/**
+ * @file test_can_tx_mailbox.cpp
+ * @brief Unit tests for the register-level TX mailbox loading
+ */
+
+#include "CppUTest/TestHarness.h"
+#include "CanTxMailbox.h"
+#include "CanRxMailbox.h"
+#include "can_register_model.h"
+#include <string.h>
+
+TEST_GROUP(CanTxMailbox)
+{
+    CanRegisterModel can;
+    CAN_FRAME frame;
+
+    void setup()
+    {
+        memset(&frame, 0, sizeof(CAN_FRAME));
+        frame.ID = 0x374;
+        frame.dlc = 8;
+        for (uint8_t i = 0; i < 8; i++)
+        {
+            frame.data[i] = 0x11 * (i + 1);
+        }
+    }
+};
+
+TEST(CanTxMailbox, LowestFreeFromTmeBits)
+{
+    LONGS_EQUAL(0, CanTxMailboxLowestFree(0x1C000000UL));
+    LONGS_EQUAL(1, CanTxMailboxLowestFree(0x18000000UL));
+    LONGS_EQUAL(2, CanTxMailboxLowestFree(0x10000000UL));
+    LONGS_EQUAL(-1, CanTxMailboxLowestFree(0x03FFFFFFUL));
+}
+
+TEST(CanTxMailbox, StandardDataFrame)
+{
+    LONGS_EQUAL(0, CanTxMailboxLoad(&can, frame));
+
+    LONGS_EQUAL((0x374UL << 21) | CAN_TX_MAILBOX_TXRQ, can.sTxMailBox[0].TIR);
+    LONGS_EQUAL(8, can.sTxMailBox[0].TDTR);
+    LONGS_EQUAL(0x44332211UL, can.sTxMailBox[0].TDLR);
+    LONGS_EQUAL(0x88776655UL, can.sTxMailBox[0].TDHR);
+}
+
+TEST(CanTxMailbox, ExtendedRemoteFrame)
+{
+    frame.ID = 0x18DAF110;
+    frame.ide = 4;  // CAN_ID_EXT
+    frame.rtr = 2;  // CAN_RTR_REMOTE
+    frame.dlc = 0;
+    CanTxMailboxLoad(&can, frame);
+
+    LONGS_EQUAL((0x18DAF110UL << 3) | CAN_TX_MAILBOX_IDE | CAN_TX_MAILBOX_RTR | CAN_TX_MAILBOX_TXRQ,
+                can.sTxMailBox[0].TIR);
+    LONGS_EQUAL(0, can.sTxMailBox[0].TDTR);
+}
+
+TEST(CanTxMailbox, TransmitGlobalTimeStaysOff)
+{
+    // TGT is bit 8 of TDTR; the DLC field is only four bits wide
+    frame.dlc = 0xFF;
+    CanTxMailboxLoad(&can, frame);
+    LONGS_EQUAL(0x0F, can.sTxMailBox[0].TDTR);
+}
+
+TEST(CanTxMailbox, FillsMailboxesLowestFirst)
+{
+    for (uint8_t i = 0; i < CAN_TX_MAILBOX_COUNT; i++)
+    {
+        frame.ID = 0x100 + i;
+        LONGS_EQUAL(i, CanTxMailboxLoad(&can, frame));
+        can.clock();
+    }
+    LONGS_EQUAL(-1, CanTxMailboxLoad(&can, frame));
+
+    // A completed mailbox is reused, others left alone
+    can.complete(1);
+    frame.ID = 0x200;
+    LONGS_EQUAL(1, CanTxMailboxLoad(&can, frame));
+    LONGS_EQUAL((0x100UL << 21) | CAN_TX_MAILBOX_TXRQ, can.sTxMailBox[0].TIR);
+    LONGS_EQUAL((0x200UL << 21) | CAN_TX_MAILBOX_TXRQ, can.sTxMailBox[1].TIR);
+    LONGS_EQUAL((0x102UL << 21) | CAN_TX_MAILBOX_TXRQ, can.sTxMailBox[2].TIR);
+}
+
+TEST(CanTxMailbox, RoundTripsThroughRxDecoding)
+{
+    // TIxR and RIxR share their layout apart from TXRQ
+    frame.ID = 0x1ABCDEF;
+    frame.ide = 4;
+    frame.dlc = 5;
+    CanTxMailboxLoad(&can, frame);
+
+    CAN_FRAME received;
+    memset(&received, 0, sizeof(CAN_FRAME));
+    CanRxMailboxDecode(can.sTxMailBox[0].TIR & ~CAN_TX_MAILBOX_TXRQ, can.sTxMailBox[0].TDTR,
+                       can.sTxMailBox[0].TDLR, can.sTxMailBox[0].TDHR, 0, &received);
+    LONGS_EQUAL(frame.ID, received.ID);
+    LONGS_EQUAL(frame.ide, received.ide);
+    LONGS_EQUAL(frame.rtr, received.rtr);
+    LONGS_EQUAL(frame.dlc, received.dlc);
+    MEMCMP_EQUAL(frame.data, received.data, 8);
+}
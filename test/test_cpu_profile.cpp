@@ -0,0 +1,89 @@
+/**
+ * @file test_cpu_profile.cpp
+ * @brief Unit tests for CpuProfile class
+ */
+
+#include "CppUTest/TestHarness.h"
+#include "CpuProfile.h"
+
+TEST_GROUP(CpuProfile)
+{
+    CpuProfile profile;
+    uint32_t cyclesPerMs;
+
+    void setup()
+    {
+        cyclesPerMs = CycleCounter::frequencyHz() / 1000;
+    }
+};
+
+TEST(CpuProfile, ZeroBeforeFirstWindow)
+{
+    profile.update(0);
+    profile.addAwake(200 * cyclesPerMs);
+    profile.add(CpuProfile::SECTION_PROCESS_RX, 100 * cyclesPerMs);
+    profile.update(CpuProfile::WINDOW_MS - 1);
+    LONGS_EQUAL(0, profile.loadPermille());
+    LONGS_EQUAL(0, profile.maxAwakeCycles());
+    LONGS_EQUAL(0, profile.sectionPermille(CpuProfile::SECTION_PROCESS_RX));
+}
+
+TEST(CpuProfile, LoadIsTimeAwake)
+{
+    profile.update(0);
+    profile.addAwake(100 * cyclesPerMs);
+    profile.addAwake(150 * cyclesPerMs);
+    profile.update(1000);
+    LONGS_EQUAL(250, profile.loadPermille());
+    LONGS_EQUAL(750, profile.idle().idlePermille());
+}
+
+TEST(CpuProfile, LongestAwakeSpanOfTheLastWindow)
+{
+    profile.update(0);
+    profile.addAwake(3 * cyclesPerMs);
+    profile.addAwake(7 * cyclesPerMs);
+    profile.addAwake(5 * cyclesPerMs);
+    profile.update(1000);
+    UNSIGNED_LONGS_EQUAL(7 * cyclesPerMs, profile.maxAwakeCycles());
+
+    profile.addAwake(2 * cyclesPerMs);
+    profile.update(2000);
+    UNSIGNED_LONGS_EQUAL(2 * cyclesPerMs, profile.maxAwakeCycles());
+}
+
+TEST(CpuProfile, SectionSharesOfTheWindow)
+{
+    profile.update(0);
+    profile.add(CpuProfile::SECTION_RX_ISR_FIFO0, 20 * cyclesPerMs);
+    profile.add(CpuProfile::SECTION_RX_ISR_FIFO0, 30 * cyclesPerMs);
+    profile.add(CpuProfile::SECTION_PROCESS_TX, 125 * cyclesPerMs);
+    profile.update(1000);
+    LONGS_EQUAL(50, profile.sectionPermille(CpuProfile::SECTION_RX_ISR_FIFO0));
+    LONGS_EQUAL(0, profile.sectionPermille(CpuProfile::SECTION_RX_ISR_FIFO1));
+    LONGS_EQUAL(125, profile.sectionPermille(CpuProfile::SECTION_PROCESS_TX));
+
+    // Each window starts afresh
+    profile.add(CpuProfile::SECTION_PROCESS_TX, 10 * cyclesPerMs);
+    profile.update(2000);
+    LONGS_EQUAL(0, profile.sectionPermille(CpuProfile::SECTION_RX_ISR_FIFO0));
+    LONGS_EQUAL(10, profile.sectionPermille(CpuProfile::SECTION_PROCESS_TX));
+}
+
+TEST(CpuProfile, LateUpdateSpreadsOverTheLongerWindow)
+{
+    profile.update(0);
+    profile.add(CpuProfile::SECTION_PROCESS_TICK, 100 * cyclesPerMs);
+    profile.update(2000);
+    LONGS_EQUAL(50, profile.sectionPermille(CpuProfile::SECTION_PROCESS_TICK));
+}
+
+TEST(CpuProfile, SectionTotalsWrap)
+{
+    // Totals are free running; a window only looks at their growth
+    profile.add(CpuProfile::SECTION_PROCESS_RX, 0xFFFFFFFFUL - 10 * cyclesPerMs);
+    profile.update(0);
+    profile.add(CpuProfile::SECTION_PROCESS_RX, 40 * cyclesPerMs);
+    profile.update(1000);
+    LONGS_EQUAL(40, profile.sectionPermille(CpuProfile::SECTION_PROCESS_RX));
+}
@@ -0,0 +1,469 @@
+/**
+ * @file test_diagnostics.cpp
+ * @brief Unit tests for Diagnostics class
+ */
+
+#include "CppUTest/TestHarness.h"
+#include "Diagnostics.h"
+#include "CycleCounter.h"
+#include <string.h>
+
+TEST_GROUP(Diagnostics)
+{
+    Diagnostics diagnostics;
+    QueueStats rxStats;
+    QueueStats txStats;
+    CAN_FRAME frame;
+
+    void setup()
+    {
+        memset(&frame, 0, sizeof(CAN_FRAME));
+    }
+};
+
+TEST(Diagnostics, NoSourcesNoPages)
+{
+    LONGS_EQUAL(0, diagnostics.pageCount());
+    CHECK_FALSE(diagnostics.buildPage(0, &frame));
+}
+
+TEST(Diagnostics, TwoPagesPerRegisteredQueue)
+{
+    diagnostics.setQueueStats(Diagnostics::QUEUE_RX, &rxStats);
+    diagnostics.setQueueStats(Diagnostics::QUEUE_TX_CAN2, &txStats);
+    LONGS_EQUAL(4, diagnostics.pageCount());
+
+    CHECK(diagnostics.buildPage(0, &frame));
+    LONGS_EQUAL(Diagnostics::MESSAGE_ID, frame.ID);
+    LONGS_EQUAL(8, frame.dlc);
+    LONGS_EQUAL(0x10, frame.data[0]);
+    CHECK(diagnostics.buildPage(1, &frame));
+    LONGS_EQUAL(0x20, frame.data[0]);
+    CHECK(diagnostics.buildPage(2, &frame));
+    LONGS_EQUAL(0x12, frame.data[0]);
+    CHECK(diagnostics.buildPage(3, &frame));
+    LONGS_EQUAL(0x22, frame.data[0]);
+    CHECK_FALSE(diagnostics.buildPage(4, &frame));
+}
+
+TEST(Diagnostics, QueueOccupancyPage)
+{
+    rxStats.onPush(1);
+    rxStats.onPush(55);
+    rxStats.sample(50, 0x01020304);
+    diagnostics.setQueueStats(Diagnostics::QUEUE_RX, &rxStats);
+
+    CHECK(diagnostics.buildPage(0, &frame));
+    LONGS_EQUAL(0x10, frame.data[0]);
+    LONGS_EQUAL(55, frame.data[1]);
+    LONGS_EQUAL(50, frame.data[2]);
+    LONGS_EQUAL(QUEUE_STATS_DEPTH_THRESHOLD, frame.data[3]);
+    LONGS_EQUAL(0x01, frame.data[4]);
+    LONGS_EQUAL(0x02, frame.data[5]);
+    LONGS_EQUAL(0x03, frame.data[6]);
+    LONGS_EQUAL(0x04, frame.data[7]);
+}
+
+TEST(Diagnostics, QueueTrafficPage)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        txStats.onDrop();
+    }
+    for (int i = 0; i < 0x102; i++)
+    {
+        txStats.onPush(1);
+    }
+    diagnostics.setQueueStats(Diagnostics::QUEUE_TX_CAN1, &txStats);
+
+    CHECK(diagnostics.buildPage(1, &frame));
+    LONGS_EQUAL(0x21, frame.data[0]);
+    LONGS_EQUAL(0, frame.data[1]);
+    LONGS_EQUAL(0, frame.data[2]);
+    LONGS_EQUAL(3, frame.data[3]);
+    LONGS_EQUAL(0, frame.data[4]);
+    LONGS_EQUAL(0, frame.data[5]);
+    LONGS_EQUAL(0x01, frame.data[6]);
+    LONGS_EQUAL(0x02, frame.data[7]);
+}
+
+TEST(Diagnostics, UnregisteredQueueIsSkipped)
+{
+    diagnostics.setQueueStats(Diagnostics::QUEUE_RX, &rxStats);
+    diagnostics.setQueueStats(Diagnostics::QUEUE_RX, nullptr);
+    LONGS_EQUAL(0, diagnostics.pageCount());
+}
+
+TEST(Diagnostics, LatencyPageInMicroseconds)
+{
+    LatencyStats latency;
+    uint32_t cyclesPerUs = CycleCounter::frequencyHz() / 1000000UL;
+    latency.record(10 * cyclesPerUs);
+    latency.record(30 * cyclesPerUs);
+    latency.record(0x20000 * cyclesPerUs);
+    diagnostics.setQueueStats(Diagnostics::QUEUE_RX, &rxStats);
+    diagnostics.setLatencyStats(1, &latency);
+    LONGS_EQUAL(3, diagnostics.pageCount());
+
+    // Latency pages follow the queue pages
+    CHECK(diagnostics.buildPage(2, &frame));
+    LONGS_EQUAL(0x31, frame.data[0]);
+    LONGS_EQUAL(0, frame.data[1]);
+    LONGS_EQUAL(10, frame.data[2]);
+    // Mean of 43704 us
+    LONGS_EQUAL(0xAA, frame.data[3]);
+    LONGS_EQUAL(0xB8, frame.data[4]);
+    LONGS_EQUAL(0x02, frame.data[5]);
+    LONGS_EQUAL(0x00, frame.data[6]);
+    LONGS_EQUAL(0x00, frame.data[7]);
+}
+
+TEST(Diagnostics, RxFifoPage)
+{
+    RxFifoStats fifoStats;
+    fifoStats.onIrq(1);
+    fifoStats.onIrq(3);
+    diagnostics.setLatencyStats(0, nullptr);
+    diagnostics.setRxFifoStats(1, 1, &fifoStats);
+    diagnostics.setRxFifoStats(2, 0, &fifoStats);
+    diagnostics.setRxFifoStats(0, 2, &fifoStats);
+    LONGS_EQUAL(1, diagnostics.pageCount());
+
+    CHECK(diagnostics.buildPage(0, &frame));
+    LONGS_EQUAL(0x43, frame.data[0]);
+    LONGS_EQUAL(3, frame.data[1]);
+    LONGS_EQUAL(0, frame.data[2]);
+    LONGS_EQUAL(0, frame.data[3]);
+    LONGS_EQUAL(2, frame.data[4]);
+    LONGS_EQUAL(0, frame.data[5]);
+    LONGS_EQUAL(0, frame.data[6]);
+    LONGS_EQUAL(4, frame.data[7]);
+}
+
+TEST(Diagnostics, CutThroughPageFollowsRxFifoPages)
+{
+    RxFifoStats fifoStats;
+    fifoStats.onIrq(2);
+    fifoStats.onCutThrough();
+    fifoStats.onCutThrough();
+    diagnostics.setRxFifoStats(0, 0, &fifoStats);
+    diagnostics.setCutThroughStats(1, &fifoStats);
+    diagnostics.setCutThroughStats(2, &fifoStats);
+    LONGS_EQUAL(2, diagnostics.pageCount());
+
+    CHECK(diagnostics.buildPage(1, &frame));
+    LONGS_EQUAL(0x51, frame.data[0]);
+    LONGS_EQUAL(0, frame.data[1]);
+    LONGS_EQUAL(0, frame.data[2]);
+    LONGS_EQUAL(0, frame.data[3]);
+    LONGS_EQUAL(2, frame.data[4]);
+    LONGS_EQUAL(0, frame.data[5]);
+}
+
+TEST(Diagnostics, RxIntervalPageInMicroseconds)
+{
+    LatencyStats interval;
+    interval.record(4900);
+    interval.record(5100);
+    interval.record(0x1000000);
+    diagnostics.setRxFifoStats(0, 1, nullptr);
+    diagnostics.setQueueStats(Diagnostics::QUEUE_RX, &rxStats);
+    diagnostics.setRxIntervalStats(&interval);
+    LONGS_EQUAL(3, diagnostics.pageCount());
+
+    // Last page, converted from bit times at 500 kbit/s
+    CHECK(diagnostics.buildPage(2, &frame));
+    LONGS_EQUAL(0x60, frame.data[0]);
+    LONGS_EQUAL(9800, (frame.data[1] << 8) | frame.data[2]);
+    LONGS_EQUAL(0xFFFF, (frame.data[3] << 8) | frame.data[4]);
+    LONGS_EQUAL(0xFFFFFF, (frame.data[5] << 16) | (frame.data[6] << 8) | frame.data[7]);
+    CHECK_FALSE(diagnostics.buildPage(3, &frame));
+}
+
+TEST(Diagnostics, RxLossPageFollowsRxIntervalPage)
+{
+    LatencyStats interval;
+    RxFifoStats fifoStats;
+    fifoStats.onFull();
+    fifoStats.onFull();
+    fifoStats.onOverrun(300, 10);
+    fifoStats.onOverrun(7, 20);
+    diagnostics.setRxIntervalStats(&interval);
+    diagnostics.setRxLossStats(1, 1, &fifoStats);
+    diagnostics.setRxLossStats(2, 0, &fifoStats);
+    LONGS_EQUAL(2, diagnostics.pageCount());
+
+    CHECK(diagnostics.buildPage(1, &frame));
+    LONGS_EQUAL(0x73, frame.data[0]);
+    LONGS_EQUAL(2, (frame.data[1] << 8) | frame.data[2]);
+    LONGS_EQUAL(2, (frame.data[3] << 8) | frame.data[4]);
+    // Most recent depth first, saturating, none for the third
+    LONGS_EQUAL(7, frame.data[5]);
+    LONGS_EQUAL(0xFE, frame.data[6]);
+    LONGS_EQUAL(0xFF, frame.data[7]);
+}
+
+TEST(Diagnostics, MainLoopPageBeforeScheduler)
+{
+    IdleStats idle;
+    idle.update(0);
+    idle.addBusy(100 * (CycleCounter::frequencyHz() / 1000));
+    idle.update(1000);
+    LatencyStats wake;
+    uint32_t cyclesPerUs = CycleCounter::frequencyHz() / 1000000UL;
+    wake.record(4 * cyclesPerUs);
+    wake.record(8 * cyclesPerUs);
+    RxFifoStats fifoStats;
+    diagnostics.setRxLossStats(0, 0, &fifoStats);
+    diagnostics.setMainLoopStats(&idle, &wake);
+    LONGS_EQUAL(2, diagnostics.pageCount());
+
+    CHECK(diagnostics.buildPage(1, &frame));
+    LONGS_EQUAL(0x80, frame.data[0]);
+    LONGS_EQUAL(900, (frame.data[1] << 8) | frame.data[2]);
+    LONGS_EQUAL(6, (frame.data[3] << 8) | frame.data[4]);
+    LONGS_EQUAL(8, (frame.data[5] << 16) | (frame.data[6] << 8) | frame.data[7]);
+    CHECK_FALSE(diagnostics.buildPage(2, &frame));
+}
+
+TEST(Diagnostics, SchedulerPageIsLast)
+{
+    IdleStats idle;
+    LatencyStats cost;
+    cost.record(0x1234000);
+    cost.record(0x1234567);
+    diagnostics.setMainLoopStats(&idle, nullptr);
+    diagnostics.setSchedulerStats(&cost);
+    LONGS_EQUAL(2, diagnostics.pageCount());
+
+    CHECK(diagnostics.buildPage(0, &frame));
+    LONGS_EQUAL(0x80, frame.data[0]);
+    CHECK(diagnostics.buildPage(1, &frame));
+    LONGS_EQUAL(0x90, frame.data[0]);
+    // Mean saturates at 24 bits, the maximum has all 32
+    LONGS_EQUAL(0xFFFFFF, (frame.data[1] << 16) | (frame.data[2] << 8) | frame.data[3]);
+    LONGS_EQUAL(0x1234567, ((uint32_t)frame.data[4] << 24) | (frame.data[5] << 16) | (frame.data[6] << 8) | frame.data[7]);
+    CHECK_FALSE(diagnostics.buildPage(2, &frame));
+}
+
+TEST(Diagnostics, CpuProfilePagesAreLast)
+{
+    uint32_t cyclesPerMs = CycleCounter::frequencyHz() / 1000;
+    CpuProfile profile;
+    profile.update(0);
+    profile.addAwake(40 * cyclesPerMs);
+    profile.addAwake(cyclesPerMs / 4);
+    profile.add(CpuProfile::SECTION_RX_ISR_FIFO0, 10 * cyclesPerMs);
+    profile.add(CpuProfile::SECTION_RX_ISR_FIFO1, 5 * cyclesPerMs);
+    profile.add(CpuProfile::SECTION_PROCESS_RX, 20 * cyclesPerMs);
+    profile.add(CpuProfile::SECTION_PROCESS_TX, 8 * cyclesPerMs);
+    profile.add(CpuProfile::SECTION_PROCESS_TICK, 300 * cyclesPerMs);
+    profile.update(1000);
+
+    LatencyStats cost;
+    diagnostics.setSchedulerStats(&cost);
+    diagnostics.setCpuProfile(&profile);
+    LONGS_EQUAL(3, diagnostics.pageCount());
+
+    CHECK(diagnostics.buildPage(1, &frame));
+    LONGS_EQUAL(0xA0, frame.data[0]);
+    LONGS_EQUAL(40, (frame.data[1] << 8) | frame.data[2]);
+    LONGS_EQUAL(40000, (frame.data[3] << 16) | (frame.data[4] << 8) | frame.data[5]);
+
+    CHECK(diagnostics.buildPage(2, &frame));
+    LONGS_EQUAL(0xA1, frame.data[0]);
+    LONGS_EQUAL(15, (frame.data[1] << 8) | frame.data[2]);
+    LONGS_EQUAL(20, (frame.data[3] << 8) | frame.data[4]);
+    LONGS_EQUAL(8, (frame.data[5] << 8) | frame.data[6]);
+    LONGS_EQUAL(0xFF, frame.data[7]);
+    CHECK_FALSE(diagnostics.buildPage(3, &frame));
+}
+
+TEST(Diagnostics, StallPagesAreLast)
+{
+    uint32_t cyclesPerUs = CycleCounter::frequencyHz() / 1000000UL;
+    uint32_t budget = LoopMonitor::STAGE_BUDGET_MS * 1000 * cyclesPerUs;
+    LoopMonitor::Record record;
+    // Power-on RAM content
+    memset(&record, 0xA5, sizeof(record));
+    LoopMonitor previous;
+    previous.start(&record, false, 0);
+    previous.endStage(LoopMonitor::STAGE_TICK, budget + 2000 * cyclesPerUs);
+    previous.beginStage(LoopMonitor::STAGE_TX);
+
+    LoopMonitor monitor;
+    monitor.start(&record, true, 0);
+    monitor.endStage(LoopMonitor::STAGE_RX, budget + 1000 * cyclesPerUs);
+    monitor.iterationDone(9000 * cyclesPerUs);
+
+    CpuProfile profile;
+    diagnostics.setCpuProfile(&profile);
+    diagnostics.setLoopMonitor(&monitor);
+    LONGS_EQUAL(4, diagnostics.pageCount());
+
+    CHECK(diagnostics.buildPage(2, &frame));
+    LONGS_EQUAL(0xC0, frame.data[0]);
+    LONGS_EQUAL(0x03, frame.data[1]);
+    LONGS_EQUAL(LoopMonitor::STAGE_TX, frame.data[2]);
+    LONGS_EQUAL(LoopMonitor::STAGE_TICK, frame.data[3]);
+    LONGS_EQUAL(7000, ((uint32_t)frame.data[4] << 24) | (frame.data[5] << 16) | (frame.data[6] << 8) | frame.data[7]);
+
+    CHECK(diagnostics.buildPage(3, &frame));
+    LONGS_EQUAL(0xC1, frame.data[0]);
+    LONGS_EQUAL(LoopMonitor::STAGE_RX, frame.data[1]);
+    LONGS_EQUAL(6000, (frame.data[2] << 16) | (frame.data[3] << 8) | frame.data[4]);
+    LONGS_EQUAL(9000, (frame.data[5] << 16) | (frame.data[6] << 8) | frame.data[7]);
+    CHECK_FALSE(diagnostics.buildPage(4, &frame));
+}
+
+TEST(Diagnostics, StallPageWithoutARecord)
+{
+    LoopMonitor::Record record;
+    // Power-on RAM content
+    memset(&record, 0xA5, sizeof(record));
+    LoopMonitor monitor;
+    monitor.start(&record, false, 0);
+    diagnostics.setLoopMonitor(&monitor);
+
+    CHECK(diagnostics.buildPage(0, &frame));
+    LONGS_EQUAL(0xC0, frame.data[0]);
+    LONGS_EQUAL(0, frame.data[1]);
+    LONGS_EQUAL(0xFF, frame.data[2]);
+    LONGS_EQUAL(0xFF, frame.data[3]);
+    LONGS_EQUAL(0, frame.data[7]);
+}
+
+TEST(Diagnostics, BusErrorPagesAreLast)
+{
+    // CAN2 only: two ACK errors and a CRC error, 2.5 s error passive, then
+    // a bus-off with one frame aborted in a mailbox, back on the bus 300 ms
+    // later, and 4 frames dropped from the lane meanwhile
+    CanErrorMonitor monitor;
+    monitor.onError(CanErrorMonitor::ERROR_ACK);
+    monitor.onError(CanErrorMonitor::ERROR_ACK);
+    monitor.onError(CanErrorMonitor::ERROR_CRC);
+    uint32_t esr = CAN_ERROR_ESR_EWGF | CAN_ERROR_ESR_EPVF;
+    monitor.sample(&esr, 0, 0);
+    monitor.onBusOff(2500, 1);
+    monitor.onDropped(4);
+    esr = CAN_ERROR_ESR_BOFF;
+    monitor.sample(&esr, 2500, 2500);
+    esr = (100UL << CAN_ERROR_ESR_TEC_SHIFT) | (7UL << CAN_ERROR_ESR_REC_SHIFT) | CAN_ERROR_ESR_EWGF;
+    monitor.sample(&esr, 300, 2800);
+
+    LoopMonitor loopMonitor;
+    diagnostics.setLoopMonitor(&loopMonitor);
+    diagnostics.setCanErrorMonitor(1, &monitor);
+    LONGS_EQUAL(6, diagnostics.pageCount());
+
+    CHECK(diagnostics.buildPage(2, &frame));
+    LONGS_EQUAL(0xD1, frame.data[0]);
+    LONGS_EQUAL(CanErrorMonitor::STATE_WARNING, frame.data[1]);
+    LONGS_EQUAL(100, frame.data[2]);
+    LONGS_EQUAL(7, frame.data[3]);
+    LONGS_EQUAL(1, (frame.data[4] << 8) | frame.data[5]);
+    LONGS_EQUAL(5, (frame.data[6] << 8) | frame.data[7]);
+
+    CHECK(diagnostics.buildPage(3, &frame));
+    LONGS_EQUAL(0xD3, frame.data[0]);
+    LONGS_EQUAL(0, (frame.data[1] << 8) | frame.data[2]);
+    LONGS_EQUAL(0, (frame.data[3] << 8) | frame.data[4]);
+    LONGS_EQUAL(2, (frame.data[5] << 8) | frame.data[6]);
+    LONGS_EQUAL(0, frame.data[7]);
+
+    CHECK(diagnostics.buildPage(4, &frame));
+    LONGS_EQUAL(0xD5, frame.data[0]);
+    LONGS_EQUAL(0, (frame.data[1] << 8) | frame.data[2]);
+    LONGS_EQUAL(0, (frame.data[3] << 8) | frame.data[4]);
+    LONGS_EQUAL(1, (frame.data[5] << 8) | frame.data[6]);
+
+    CHECK(diagnostics.buildPage(5, &frame));
+    LONGS_EQUAL(0xD7, frame.data[0]);
+    LONGS_EQUAL(0, (frame.data[1] << 8) | frame.data[2]);
+    LONGS_EQUAL(2, (frame.data[3] << 8) | frame.data[4]);
+    LONGS_EQUAL(0, (frame.data[5] << 8) | frame.data[6]);
+    LONGS_EQUAL(0xFF, frame.data[7]);
+    CHECK_FALSE(diagnostics.buildPage(6, &frame));
+}
+
+TEST(Diagnostics, HistogramsAreNotHeartbeatPages)
+{
+    LatencyHistogram histogram;
+    histogram.record(100);
+    diagnostics.setLatencyHistogram(Diagnostics::HISTOGRAM_RX_TO_DISPATCH, &histogram);
+    LONGS_EQUAL(0, diagnostics.pageCount());
+    LONGS_EQUAL(0, diagnostics.histogramFrameCount(Diagnostics::HISTOGRAM_DISPATCH_TO_ENQUEUE));
+}
+
+TEST(Diagnostics, EmptyHistogramDumpIsASummary)
+{
+    LatencyHistogram histogram;
+    diagnostics.setLatencyHistogram(Diagnostics::HISTOGRAM_ENQUEUE_TO_MAILBOX, &histogram);
+    LONGS_EQUAL(1, diagnostics.histogramFrameCount(Diagnostics::HISTOGRAM_ENQUEUE_TO_MAILBOX));
+
+    CHECK(diagnostics.buildHistogramFrame(Diagnostics::HISTOGRAM_ENQUEUE_TO_MAILBOX, 0, &frame));
+    LONGS_EQUAL(0x721, frame.ID);
+    LONGS_EQUAL(0xB2, frame.data[0]);
+    LONGS_EQUAL(0xFF, frame.data[1]);
+    LONGS_EQUAL(0, frame.data[4]);
+    LONGS_EQUAL(0, frame.data[7]);
+    CHECK_FALSE(diagnostics.buildHistogramFrame(Diagnostics::HISTOGRAM_ENQUEUE_TO_MAILBOX, 1, &frame));
+}
+
+TEST(Diagnostics, HistogramDumpCoversNonEmptyBuckets)
+{
+    uint32_t cyclesPerUs = CycleCounter::frequencyHz() / 1000000UL;
+    LatencyHistogram histogram;
+    // Buckets b and b + 3, so two bucket frames
+    uint8_t low = LatencyHistogram::bucketOf(3 * cyclesPerUs);
+    for (int i = 0; i < 999; i++)
+    {
+        histogram.record(3 * cyclesPerUs);
+    }
+    histogram.record(LatencyHistogram::bucketUpperBound(low + 3));
+    diagnostics.setLatencyHistogram(Diagnostics::HISTOGRAM_DISPATCH_TO_ENQUEUE, &histogram);
+    LONGS_EQUAL(3, diagnostics.histogramFrameCount(Diagnostics::HISTOGRAM_DISPATCH_TO_ENQUEUE));
+
+    CHECK(diagnostics.buildHistogramFrame(Diagnostics::HISTOGRAM_DISPATCH_TO_ENQUEUE, 0, &frame));
+    LONGS_EQUAL(0xB1, frame.data[0]);
+    LONGS_EQUAL(0xFF, frame.data[1]);
+    uint32_t p99 = (frame.data[2] << 16) | (frame.data[3] << 8) | frame.data[4];
+    uint32_t p999 = (frame.data[5] << 16) | (frame.data[6] << 8) | frame.data[7];
+    LONGS_EQUAL(CycleCounter::toMicros(LatencyHistogram::bucketUpperBound(low)), p99);
+    LONGS_EQUAL(p99, p999);
+
+    CHECK(diagnostics.buildHistogramFrame(Diagnostics::HISTOGRAM_DISPATCH_TO_ENQUEUE, 1, &frame));
+    LONGS_EQUAL(0xB1, frame.data[0]);
+    LONGS_EQUAL(low, frame.data[1]);
+    LONGS_EQUAL(999, (frame.data[2] << 16) | (frame.data[3] << 8) | frame.data[4]);
+    LONGS_EQUAL(0, (frame.data[5] << 16) | (frame.data[6] << 8) | frame.data[7]);
+
+    CHECK(diagnostics.buildHistogramFrame(Diagnostics::HISTOGRAM_DISPATCH_TO_ENQUEUE, 2, &frame));
+    LONGS_EQUAL(low + 2, frame.data[1]);
+    LONGS_EQUAL(0, (frame.data[2] << 16) | (frame.data[3] << 8) | frame.data[4]);
+    LONGS_EQUAL(1, (frame.data[5] << 16) | (frame.data[6] << 8) | frame.data[7]);
+}
+
+TEST(Diagnostics, HistogramDumpOfTheTopBucket)
+{
+    LatencyHistogram histogram;
+    histogram.record(0xFFFFFFFFUL);
+    diagnostics.setLatencyHistogram(Diagnostics::HISTOGRAM_RX_TO_DISPATCH, &histogram);
+    LONGS_EQUAL(2, diagnostics.histogramFrameCount(Diagnostics::HISTOGRAM_RX_TO_DISPATCH));
+
+    CHECK(diagnostics.buildHistogramFrame(Diagnostics::HISTOGRAM_RX_TO_DISPATCH, 1, &frame));
+    LONGS_EQUAL(32, frame.data[1]);
+    LONGS_EQUAL(1, (frame.data[2] << 16) | (frame.data[3] << 8) | frame.data[4]);
+    LONGS_EQUAL(0, frame.data[7]);
+}
+
+#ifdef CAN_FRAME_TIMESTAMPS
+TEST(Diagnostics, PagesCarryNoTimestamp)
+{
+    diagnostics.setQueueStats(Diagnostics::QUEUE_RX, &rxStats);
+    frame.timestamp = 1234;
+    CHECK(diagnostics.buildPage(0, &frame));
+    LONGS_EQUAL(0, frame.timestamp);
+}
+#endif
+
@@ -0,0 +1,65 @@
+/**
+ * @file test_idle_stats.cpp
+ * @brief Unit tests for IdleStats class
+ */
+
+#include "CppUTest/TestHarness.h"
+#include "IdleStats.h"
+
+TEST_GROUP(IdleStats)
+{
+    IdleStats stats;
+    uint32_t cyclesPerMs;
+
+    void setup()
+    {
+        cyclesPerMs = CycleCounter::frequencyHz() / 1000;
+    }
+};
+
+TEST(IdleStats, ZeroBeforeFirstWindow)
+{
+    stats.update(100);
+    stats.addBusy(10 * cyclesPerMs);
+    stats.update(100 + IdleStats::WINDOW_MS - 1);
+    LONGS_EQUAL(0, stats.idlePermille());
+}
+
+TEST(IdleStats, IdleIsTheRestOfTheWindow)
+{
+    stats.update(0);
+    stats.addBusy(100 * cyclesPerMs);
+    stats.addBusy(150 * cyclesPerMs);
+    stats.update(1000);
+    LONGS_EQUAL(750, stats.idlePermille());
+}
+
+TEST(IdleStats, EachWindowStartsAfresh)
+{
+    stats.update(0);
+    stats.addBusy(500 * cyclesPerMs);
+    stats.update(1000);
+    LONGS_EQUAL(500, stats.idlePermille());
+
+    stats.addBusy(100 * cyclesPerMs);
+    stats.update(1500);
+    LONGS_EQUAL(500, stats.idlePermille());
+    stats.update(2000);
+    LONGS_EQUAL(900, stats.idlePermille());
+}
+
+TEST(IdleStats, LateUpdateUsesTheWholeWindow)
+{
+    stats.update(0);
+    stats.addBusy(1000 * cyclesPerMs);
+    stats.update(2000);
+    LONGS_EQUAL(500, stats.idlePermille());
+}
+
+TEST(IdleStats, NeverAsleepIsZero)
+{
+    stats.update(0);
+    stats.addBusy(1001 * cyclesPerMs);
+    stats.update(1000);
+    LONGS_EQUAL(0, stats.idlePermille());
+}
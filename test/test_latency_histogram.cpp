@@ -0,0 +1,87 @@
+/**
+ * @file test_latency_histogram.cpp
+ * @brief Unit tests for LatencyHistogram class
+ */
+
+#include "CppUTest/TestHarness.h"
+#include "LatencyHistogram.h"
+
+TEST_GROUP(LatencyHistogram)
+{
+    LatencyHistogram histogram;
+};
+
+TEST(LatencyHistogram, EmptyHasNoSamples)
+{
+    LONGS_EQUAL(0, histogram.count());
+    LONGS_EQUAL(0, histogram.percentile(990));
+}
+
+TEST(LatencyHistogram, BucketIsTheNumberOfSignificantBits)
+{
+    LONGS_EQUAL(0, LatencyHistogram::bucketOf(0));
+    LONGS_EQUAL(1, LatencyHistogram::bucketOf(1));
+    LONGS_EQUAL(2, LatencyHistogram::bucketOf(2));
+    LONGS_EQUAL(2, LatencyHistogram::bucketOf(3));
+    LONGS_EQUAL(3, LatencyHistogram::bucketOf(4));
+    LONGS_EQUAL(11, LatencyHistogram::bucketOf(1024));
+    LONGS_EQUAL(32, LatencyHistogram::bucketOf(0xFFFFFFFFUL));
+}
+
+TEST(LatencyHistogram, BucketUpperBounds)
+{
+    UNSIGNED_LONGS_EQUAL(0, LatencyHistogram::bucketUpperBound(0));
+    UNSIGNED_LONGS_EQUAL(1, LatencyHistogram::bucketUpperBound(1));
+    UNSIGNED_LONGS_EQUAL(1023, LatencyHistogram::bucketUpperBound(10));
+    UNSIGNED_LONGS_EQUAL(0xFFFFFFFFUL, LatencyHistogram::bucketUpperBound(32));
+}
+
+TEST(LatencyHistogram, RecordCountsInItsBucket)
+{
+    histogram.record(0);
+    histogram.record(5);
+    histogram.record(7);
+    histogram.record(8);
+    LONGS_EQUAL(4, histogram.count());
+    LONGS_EQUAL(1, histogram.bucket(0));
+    LONGS_EQUAL(2, histogram.bucket(3));
+    LONGS_EQUAL(1, histogram.bucket(4));
+}
+
+TEST(LatencyHistogram, PercentilesFindTheTail)
+{
+    // 990 fast samples, 9 slower, 1 very slow
+    for (int i = 0; i < 990; i++)
+    {
+        histogram.record(100);
+    }
+    for (int i = 0; i < 9; i++)
+    {
+        histogram.record(1000);
+    }
+    histogram.record(100000);
+
+    UNSIGNED_LONGS_EQUAL(127, histogram.percentile(500));
+    UNSIGNED_LONGS_EQUAL(127, histogram.percentile(990));
+    UNSIGNED_LONGS_EQUAL(1023, histogram.percentile(999));
+    UNSIGNED_LONGS_EQUAL(131071, histogram.percentile(1000));
+}
+
+TEST(LatencyHistogram, PercentileRoundsTheRankUp)
+{
+    // With 10 samples p99 needs all 10, not 9
+    for (int i = 0; i < 9; i++)
+    {
+        histogram.record(10);
+    }
+    histogram.record(5000);
+    UNSIGNED_LONGS_EQUAL(8191, histogram.percentile(990));
+    UNSIGNED_LONGS_EQUAL(15, histogram.percentile(900));
+}
+
+TEST(LatencyHistogram, ResetDiscardsSamples)
+{
+    histogram.record(42);
+    histogram.reset();
+    LONGS_EQUAL(0, histogram.count());
+}
@@ -0,0 +1,90 @@
+/**
+ * @file test_latency_stats.cpp
+ * @brief Unit tests for LatencyStats class and frame timestamps
+ */
+
+#include "CppUTest/TestHarness.h"
+#include "LatencyStats.h"
+#include "FrameTimestamp.h"
+#include <string.h>
+
+TEST_GROUP(LatencyStats)
+{
+    LatencyStats stats;
+};
+
+TEST(LatencyStats, EmptyIsZero)
+{
+    LONGS_EQUAL(0, stats.count());
+    LONGS_EQUAL(0, stats.min());
+    LONGS_EQUAL(0, stats.max());
+    LONGS_EQUAL(0, stats.mean());
+}
+
+TEST(LatencyStats, MinMeanMax)
+{
+    stats.record(300);
+    stats.record(100);
+    stats.record(200);
+
+    LONGS_EQUAL(3, stats.count());
+    LONGS_EQUAL(100, stats.min());
+    LONGS_EQUAL(300, stats.max());
+    LONGS_EQUAL(200, stats.mean());
+}
+
+TEST(LatencyStats, MeanDoesNotOverflow)
+{
+    stats.record(0xF0000000UL);
+    stats.record(0xF0000000UL);
+    LONGS_EQUAL(0xF0000000UL, stats.mean());
+}
+
+TEST(LatencyStats, Reset)
+{
+    stats.record(50);
+    stats.reset();
+    LONGS_EQUAL(0, stats.count());
+    stats.record(70);
+    LONGS_EQUAL(70, stats.min());
+}
+
+TEST_GROUP(FrameTimestamp)
+{
+    CAN_FRAME frame;
+
+    void setup()
+    {
+        memset(&frame, 0, sizeof(CAN_FRAME));
+    }
+};
+
+TEST(FrameTimestamp, ClearedFrameHasNoLatency)
+{
+    uint32_t cycles = 123;
+    FrameClearStamp(&frame);
+    CHECK_FALSE(FrameLatency(&frame, &cycles));
+    LONGS_EQUAL(123, cycles);
+}
+
+#ifdef CAN_FRAME_TIMESTAMPS
+TEST(FrameTimestamp, StampedFrameMeasuresElapsedTime)
+{
+    FrameStampReceived(&frame);
+    CHECK(frame.timestamp != 0);
+
+    // Pretend the frame was received 5 us ago
+    frame.timestamp -= 5 * (CycleCounter::frequencyHz() / 1000000UL);
+    uint32_t cycles = 0;
+    CHECK(FrameLatency(&frame, &cycles));
+    CHECK(CycleCounter::toMicros(cycles) >= 5);
+}
+#else
+TEST(FrameTimestamp, NoLatencyWithoutTimestamps)
+{
+    uint32_t cycles = 123;
+    FrameStampReceived(&frame);
+    CHECK_FALSE(FrameLatency(&frame, &cycles));
+    LONGS_EQUAL(123, cycles);
+}
+#endif
@@ -0,0 +1,121 @@
+/**
+ * @file test_loop_monitor.cpp
+ * @brief Unit tests for LoopMonitor class
+ */
+
+#include "CppUTest/TestHarness.h"
+#include "LoopMonitor.h"
+#include <string.h>
+
+TEST_GROUP(LoopMonitor)
+{
+    LoopMonitor monitor;
+    LoopMonitor::Record record;
+    uint32_t budget;
+
+    void setup()
+    {
+        // Power-on RAM content
+        memset(&record, 0xA5, sizeof(record));
+        budget = LoopMonitor::STAGE_BUDGET_MS * (CycleCounter::frequencyHz() / 1000);
+    }
+};
+
+TEST(LoopMonitor, PowerOnLeavesNoPreviousRecord)
+{
+    monitor.start(&record, false, 0);
+    CHECK_FALSE(monitor.previous().valid);
+    CHECK_FALSE(monitor.previous().watchdogReset);
+    LONGS_EQUAL(LoopMonitor::STAGE_NONE, monitor.worstStage());
+}
+
+TEST(LoopMonitor, StagesWithinBudgetAreHealthy)
+{
+    monitor.start(&record, false, 0);
+    monitor.beginStage(LoopMonitor::STAGE_RX);
+    monitor.endStage(LoopMonitor::STAGE_RX, budget);
+    CHECK_FALSE(monitor.feedDue(LoopMonitor::CHECK_INTERVAL_MS - 1));
+    CHECK(monitor.feedDue(LoopMonitor::CHECK_INTERVAL_MS));
+    LONGS_EQUAL(0, monitor.overruns(LoopMonitor::STAGE_RX));
+    UNSIGNED_LONGS_EQUAL(budget, monitor.maxStageCycles(LoopMonitor::STAGE_RX));
+    LONGS_EQUAL(LoopMonitor::STAGE_NONE, monitor.worstStage());
+}
+
+TEST(LoopMonitor, OverrunWithholdsOneRefresh)
+{
+    monitor.start(&record, false, 0);
+    monitor.beginStage(LoopMonitor::STAGE_TICK);
+    monitor.endStage(LoopMonitor::STAGE_TICK, budget + 1);
+    CHECK_FALSE(monitor.feedDue(LoopMonitor::CHECK_INTERVAL_MS));
+    LONGS_EQUAL(1, monitor.missedFeeds());
+
+    // The next interval starts healthy again
+    CHECK(monitor.feedDue(2 * LoopMonitor::CHECK_INTERVAL_MS));
+    LONGS_EQUAL(1, monitor.overruns(LoopMonitor::STAGE_TICK));
+}
+
+TEST(LoopMonitor, LongWaitForAStageIsUnhealthy)
+{
+    monitor.start(&record, false, 0);
+    monitor.stageWaiting(LoopMonitor::STAGE_TX, budget);
+    CHECK(monitor.feedDue(LoopMonitor::CHECK_INTERVAL_MS));
+    monitor.stageWaiting(LoopMonitor::STAGE_TX, budget + 1);
+    CHECK_FALSE(monitor.feedDue(2 * LoopMonitor::CHECK_INTERVAL_MS));
+}
+
+TEST(LoopMonitor, WorstOverrunKept)
+{
+    monitor.start(&record, false, 0);
+    monitor.endStage(LoopMonitor::STAGE_RX, budget + 10);
+    monitor.endStage(LoopMonitor::STAGE_TX, budget + 30);
+    monitor.endStage(LoopMonitor::STAGE_RX, budget + 20);
+    LONGS_EQUAL(LoopMonitor::STAGE_TX, monitor.worstStage());
+    UNSIGNED_LONGS_EQUAL(budget + 30, monitor.worstCycles());
+    LONGS_EQUAL(2, monitor.overruns(LoopMonitor::STAGE_RX));
+}
+
+TEST(LoopMonitor, RecordSurvivesAReset)
+{
+    monitor.start(&record, false, 0);
+    monitor.endStage(LoopMonitor::STAGE_TX, budget + 30);
+    // Hung in the RX stage until the watchdog reset
+    monitor.beginStage(LoopMonitor::STAGE_RX);
+
+    LoopMonitor next;
+    next.start(&record, true, 0);
+    CHECK(next.previous().valid);
+    CHECK(next.previous().watchdogReset);
+    LONGS_EQUAL(LoopMonitor::STAGE_RX, next.previous().activeStage);
+    LONGS_EQUAL(LoopMonitor::STAGE_TX, next.previous().worstStage);
+    UNSIGNED_LONGS_EQUAL(budget + 30, next.previous().worstCycles);
+
+    // The new run starts a clean record
+    LONGS_EQUAL(LoopMonitor::STAGE_NONE, next.worstStage());
+    LONGS_EQUAL(LoopMonitor::STAGE_NONE, record.activeStage);
+}
+
+TEST(LoopMonitor, CorruptRecordIsIgnored)
+{
+    monitor.start(&record, false, 0);
+    monitor.endStage(LoopMonitor::STAGE_TX, budget + 30);
+    record.worstCycles ^= 0x100;
+
+    LoopMonitor next;
+    next.start(&record, false, 0);
+    CHECK_FALSE(next.previous().valid);
+}
+
+TEST(LoopMonitor, LongestIteration)
+{
+    monitor.iterationDone(300);
+    monitor.iterationDone(700);
+    monitor.iterationDone(500);
+    UNSIGNED_LONGS_EQUAL(700, monitor.maxIterationCycles());
+}
+
+TEST(LoopMonitor, StagesSafeBeforeStart)
+{
+    monitor.beginStage(LoopMonitor::STAGE_RX);
+    monitor.endStage(LoopMonitor::STAGE_RX, 0xFFFFFFFFUL);
+    LONGS_EQUAL(0, monitor.overruns(LoopMonitor::STAGE_RX));
+}
@@ -0,0 +1,85 @@
+/**
+ * @file test_main_loop_events.cpp
+ * @brief Unit tests for MainLoopEvents class
+ */
+
+#include "CppUTest/TestHarness.h"
+#include "MainLoopEvents.h"
+
+TEST_GROUP(MainLoopEvents)
+{
+    MainLoopEvents events;
+};
+
+TEST(MainLoopEvents, NothingPendingAtStart)
+{
+    uint32_t waited;
+    CHECK_FALSE(events.anyPending());
+    CHECK_FALSE(events.take(MainLoopEvents::EVENT_CAN_RX));
+    CHECK_FALSE(events.waitedSince(CycleCounter::now(), &waited));
+}
+
+TEST(MainLoopEvents, TakeClearsOnlyThatEvent)
+{
+    events.signal(MainLoopEvents::EVENT_CAN_RX);
+    events.signal(MainLoopEvents::EVENT_TICK);
+    CHECK(events.anyPending());
+
+    CHECK(events.take(MainLoopEvents::EVENT_CAN_RX));
+    CHECK_FALSE(events.take(MainLoopEvents::EVENT_CAN_RX));
+    CHECK_FALSE(events.take(MainLoopEvents::EVENT_CAN_TX));
+    CHECK(events.anyPending());
+
+    CHECK(events.take(MainLoopEvents::EVENT_TICK));
+    CHECK_FALSE(events.anyPending());
+}
+
+TEST(MainLoopEvents, RepeatedSignalsAreOneEvent)
+{
+    events.signal(MainLoopEvents::EVENT_CAN_TX);
+    events.signal(MainLoopEvents::EVENT_CAN_TX);
+    CHECK(events.take(MainLoopEvents::EVENT_CAN_TX));
+    CHECK_FALSE(events.anyPending());
+}
+
+TEST(MainLoopEvents, SignalAfterTakeIsKept)
+{
+    // Work signalled while the loop handles the previous event runs again
+    events.signal(MainLoopEvents::EVENT_CAN_RX);
+    CHECK(events.take(MainLoopEvents::EVENT_CAN_RX));
+    events.signal(MainLoopEvents::EVENT_CAN_RX);
+    CHECK(events.anyPending());
+}
+
+TEST(MainLoopEvents, WaitIsFromTheOldestFirstSignal)
+{
+    uint32_t first = CycleCounter::now();
+    events.signal(MainLoopEvents::EVENT_TICK);
+    uint32_t second = CycleCounter::now();
+    events.signal(MainLoopEvents::EVENT_CAN_RX);
+    // A repeat does not restart the wait
+    events.signal(MainLoopEvents::EVENT_TICK);
+    uint32_t now = CycleCounter::now();
+
+    uint32_t waited;
+    CHECK(events.waitedSince(now, &waited));
+    CHECK(waited <= now - first);
+    CHECK(waited >= now - second);
+
+    events.take(MainLoopEvents::EVENT_TICK);
+    CHECK(events.waitedSince(now, &waited));
+    CHECK(waited <= now - second);
+}
+
+TEST(MainLoopEvents, WaitOfOneEvent)
+{
+    uint32_t waited;
+    events.signal(MainLoopEvents::EVENT_TICK);
+    uint32_t before = CycleCounter::now();
+    events.signal(MainLoopEvents::EVENT_CAN_RX);
+    uint32_t now = CycleCounter::now();
+
+    CHECK_FALSE(events.waitedSince(MainLoopEvents::EVENT_CAN_TX, now, &waited));
+    CHECK(events.waitedSince(MainLoopEvents::EVENT_CAN_RX, now, &waited));
+    CHECK(waited <= now - before);
+}
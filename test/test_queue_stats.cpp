@@ -0,0 +1,120 @@
+/**
+ * @file test_queue_stats.cpp
+ * @brief Unit tests for the QueueStats policy and its use by the CAN queues
+ */
+
+#include "CppUTest/TestHarness.h"
+#include "QueueStats.h"
+#include "CanQueue.h"
+#include "SpscCanQueue.h"
+#include "CanPriorityQueue.h"
+#include <string.h>
+
+TEST_GROUP(QueueStats)
+{
+    QueueStats stats;
+};
+
+TEST(QueueStats, StartsAtZero)
+{
+    LONGS_EQUAL(0, stats.highWater());
+    LONGS_EQUAL(0, stats.depth());
+    LONGS_EQUAL(0, stats.pushes());
+    LONGS_EQUAL(0, stats.drops());
+    LONGS_EQUAL(0, stats.msAboveThreshold());
+}
+
+TEST(QueueStats, HighWaterOnlyRises)
+{
+    stats.onPush(3);
+    stats.onPush(7);
+    stats.onPush(2);
+
+    LONGS_EQUAL(7, stats.highWater());
+    LONGS_EQUAL(3, stats.pushes());
+}
+
+TEST(QueueStats, SampleCountsTimeAtOrAboveThreshold)
+{
+    stats.sample(QUEUE_STATS_DEPTH_THRESHOLD - 1, 5);
+    LONGS_EQUAL(0, stats.msAboveThreshold());
+
+    stats.sample(QUEUE_STATS_DEPTH_THRESHOLD, 3);
+    stats.sample(QUEUE_STATS_DEPTH_THRESHOLD + 1, 4);
+    LONGS_EQUAL(7, stats.msAboveThreshold());
+    LONGS_EQUAL(QUEUE_STATS_DEPTH_THRESHOLD + 1, stats.depth());
+}
+
+TEST(QueueStats, QueueStatsOfCompiledOutIsNull)
+{
+    NoQueueStats none;
+    POINTERS_EQUAL(nullptr, queueStatsOf(none));
+    POINTERS_EQUAL(&stats, queueStatsOf(stats));
+}
+
+TEST_GROUP(QueueStats_Queues)
+{
+    CAN_FRAME frame;
+
+    void setup()
+    {
+        memset(&frame, 0, sizeof(CAN_FRAME));
+        frame.ID = 0x123;
+        frame.dlc = 8;
+    }
+
+    // Push 6 frames into a queue of 4, pop 3, push 1 with reserve/commit
+    template<class QUEUE>
+    void exercise(QUEUE &queue)
+    {
+        for (int i = 0; i < 6; i++)
+        {
+            queue.push(frame);
+        }
+        for (int i = 0; i < 3; i++)
+        {
+            queue.pop(nullptr);
+        }
+        CAN_FRAME *slot = queue.reserve();
+        *slot = frame;
+        queue.commit();
+
+        const QueueStats &stats = queue.stats();
+        LONGS_EQUAL(5, stats.pushes());
+        LONGS_EQUAL(2, stats.drops());
+        LONGS_EQUAL(4, stats.highWater());
+
+        // A failed reserve() is a drop too
+        queue.push(frame);
+        queue.push(frame);
+        POINTERS_EQUAL(nullptr, queue.reserve());
+        LONGS_EQUAL(7, stats.pushes());
+        LONGS_EQUAL(3, stats.drops());
+
+        queue.sampleStats(10);
+        LONGS_EQUAL(4, stats.depth());
+    }
+};
+
+TEST(QueueStats_Queues, CanQueue)
+{
+    CanQueue<4, QueueStats> queue;
+    exercise(queue);
+}
+
+TEST(QueueStats_Queues, SpscCanQueue)
+{
+    SpscCanQueue<4, QueueStats> queue;
+    exercise(queue);
+}
+
+TEST(QueueStats_Queues, CanPriorityQueue)
+{
+    CanPriorityQueue<4, QueueStats> queue;
+    exercise(queue);
+}
+
+TEST(QueueStats_Queues, NoStatsAddsNoStorage)
+{
+    CHECK(sizeof(CanQueue<4, NoQueueStats>) < sizeof(CanQueue<4, QueueStats>));
+}
@@ -0,0 +1,104 @@
+/**
+ * @file test_rx_fifo_stats.cpp
+ * @brief Unit tests for RxFifoStats class
+ */
+
+#include "CppUTest/TestHarness.h"
+#include "RxFifoStats.h"
+#include <string.h>
+
+TEST_GROUP(RxFifoStats)
+{
+    RxFifoStats stats;
+};
+
+TEST(RxFifoStats, EmptyIsZero)
+{
+    LONGS_EQUAL(0, stats.irqs());
+    LONGS_EQUAL(0, stats.frames());
+    LONGS_EQUAL(0, stats.maxFramesPerIrq());
+    LONGS_EQUAL(0, stats.cutThroughs());
+    LONGS_EQUAL(0, stats.overruns());
+    LONGS_EQUAL(0, stats.fulls());
+}
+
+TEST(RxFifoStats, CountsInterruptsAndFrames)
+{
+    stats.onIrq(1);
+    stats.onIrq(3);
+    stats.onIrq(2);
+
+    LONGS_EQUAL(3, stats.irqs());
+    LONGS_EQUAL(6, stats.frames());
+    LONGS_EQUAL(3, stats.maxFramesPerIrq());
+}
+
+TEST(RxFifoStats, EmptyInterruptCountsNoFrames)
+{
+    // A pending interrupt can find the FIFO already drained by the previous one
+    stats.onIrq(2);
+    stats.onIrq(0);
+
+    LONGS_EQUAL(2, stats.irqs());
+    LONGS_EQUAL(2, stats.frames());
+    LONGS_EQUAL(2, stats.maxFramesPerIrq());
+}
+
+TEST(RxFifoStats, CountsCutThroughSeparately)
+{
+    stats.onCutThrough();
+    stats.onIrq(2);
+
+    LONGS_EQUAL(1, stats.cutThroughs());
+    LONGS_EQUAL(2, stats.frames());
+}
+
+TEST(RxFifoStats, CountsOverrunsAndFullSeparately)
+{
+    stats.onFull();
+    stats.onFull();
+    stats.onOverrun(5, 100);
+
+    LONGS_EQUAL(1, stats.overruns());
+    LONGS_EQUAL(2, stats.fulls());
+}
+
+TEST(RxFifoStats, NoOverrunNoHistory)
+{
+    RxFifoStats::Overrun overrun;
+    CHECK_FALSE(stats.recentOverrun(0, &overrun));
+}
+
+TEST(RxFifoStats, KeepsRecentOverrunsMostRecentFirst)
+{
+    stats.onOverrun(1, 100);
+    stats.onOverrun(64, 250);
+
+    RxFifoStats::Overrun overrun;
+    memset(&overrun, 0, sizeof(overrun));
+    CHECK(stats.recentOverrun(0, &overrun));
+    LONGS_EQUAL(64, overrun.queueDepth);
+    LONGS_EQUAL(250, overrun.timeMs);
+    CHECK(stats.recentOverrun(1, &overrun));
+    LONGS_EQUAL(1, overrun.queueDepth);
+    LONGS_EQUAL(100, overrun.timeMs);
+    CHECK_FALSE(stats.recentOverrun(2, &overrun));
+}
+
+TEST(RxFifoStats, OverrunHistoryKeepsTheLastFew)
+{
+    for (uint16_t i = 0; i < 10; i++)
+    {
+        stats.onOverrun(i, i * 10);
+    }
+
+    RxFifoStats::Overrun overrun;
+    memset(&overrun, 0, sizeof(overrun));
+    for (uint8_t age = 0; age < RxFifoStats::OVERRUN_HISTORY; age++)
+    {
+        CHECK(stats.recentOverrun(age, &overrun));
+        LONGS_EQUAL(9 - age, overrun.queueDepth);
+    }
+    CHECK_FALSE(stats.recentOverrun(RxFifoStats::OVERRUN_HISTORY, &overrun));
+    LONGS_EQUAL(10, stats.overruns());
+}
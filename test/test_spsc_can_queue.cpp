@@ -0,0 +1,443 @@
+/**
+ * @file test_spsc_can_queue.cpp
+ * @brief Unit tests for SpscCanQueue class
+ */
+
+#include "CppUTest/TestHarness.h"
+#include "SpscCanQueue.h"
+#include <string.h>
+#include <thread>
+
+/**
+ * @brief Build a frame whose contents are derived from a sequence number,
+ * so a consumer can check both ordering and data integrity.
+ */
+static CAN_FRAME MakeSequenceFrame(uint32_t sequence)
+{
+    CAN_FRAME frame;
+    memset(&frame, 0, sizeof(CAN_FRAME));
+    frame.ID = sequence & 0x7FF;
+    frame.dlc = 8;
+    frame.rx_channel = sequence & 1;
+    for (int i = 0; i < 4; i++)
+    {
+        frame.data[i] = (sequence >> (8 * i)) & 0xFF;
+        frame.data[i + 4] = ~frame.data[i] & 0xFF;
+    }
+    return frame;
+}
+
+/**
+ * @brief Check a frame produced by MakeSequenceFrame()
+ */
+static void CheckSequenceFrame(uint32_t sequence, const CAN_FRAME &frame)
+{
+    LONGS_EQUAL(sequence & 0x7FF, frame.ID);
+    LONGS_EQUAL(8, frame.dlc);
+    LONGS_EQUAL(sequence & 1, frame.rx_channel);
+    for (int i = 0; i < 4; i++)
+    {
+        LONGS_EQUAL((sequence >> (8 * i)) & 0xFF, frame.data[i]);
+        LONGS_EQUAL(~frame.data[i] & 0xFF, frame.data[i + 4]);
+    }
+}
+
+TEST_GROUP(SpscCanQueue_BasicOperations)
+{
+    SpscCanQueue<16> queue;
+    CAN_FRAME frame;
+
+    void setup()
+    {
+        memset(&frame, 0, sizeof(CAN_FRAME));
+        frame.ID = 0x123;
+        frame.dlc = 8;
+    }
+
+    void teardown()
+    {
+    }
+};
+
+TEST(SpscCanQueue_BasicOperations, DefaultConstructor)
+{
+    CHECK(queue.isEmpty());
+    CHECK_FALSE(queue.isFull());
+    LONGS_EQUAL(0, queue.length());
+    LONGS_EQUAL(16, queue.capacity());
+    LONGS_EQUAL(16, queue.available());
+}
+
+TEST(SpscCanQueue_BasicOperations, PushPopOneFrame)
+{
+    CHECK(queue.push(frame));
+    LONGS_EQUAL(1, queue.length());
+    LONGS_EQUAL(15, queue.available());
+
+    CAN_FRAME popped;
+    memset(&popped, 0, sizeof(popped));
+    CHECK(queue.pop(&popped));
+    CHECK(queue.isEmpty());
+    LONGS_EQUAL(0x123, popped.ID);
+    LONGS_EQUAL(8, popped.dlc);
+}
+
+TEST(SpscCanQueue_BasicOperations, PopEmptyQueue)
+{
+    CAN_FRAME popped;
+    CHECK_FALSE(queue.pop(&popped));
+    CHECK_FALSE(queue.peek(&popped));
+}
+
+TEST(SpscCanQueue_BasicOperations, PeekDoesNotRemove)
+{
+    queue.push(frame);
+
+    CAN_FRAME peeked;
+    memset(&peeked, 0, sizeof(peeked));
+    CHECK(queue.peek(&peeked));
+    LONGS_EQUAL(0x123, peeked.ID);
+    LONGS_EQUAL(1, queue.length());
+}
+
+TEST(SpscCanQueue_BasicOperations, PopWithNullPointer)
+{
+    queue.push(frame);
+    CHECK(queue.pop(nullptr));
+    CHECK(queue.isEmpty());
+}
+
+TEST(SpscCanQueue_BasicOperations, FillToCapacity)
+{
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        CHECK(queue.push(MakeSequenceFrame(i)));
+    }
+    CHECK(queue.isFull());
+    LONGS_EQUAL(16, queue.length());
+    LONGS_EQUAL(0, queue.available());
+    CHECK_FALSE(queue.push(frame));
+
+    CAN_FRAME popped;
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        CHECK(queue.pop(&popped));
+        CheckSequenceFrame(i, popped);
+    }
+    CHECK(queue.isEmpty());
+}
+
+TEST(SpscCanQueue_BasicOperations, WrapAroundLength)
+{
+    CAN_FRAME popped;
+    // Move the indices near the end of the buffer, then wrap
+    for (uint32_t i = 0; i < 12; i++)
+    {
+        queue.push(frame);
+        queue.pop(&popped);
+    }
+    for (uint32_t i = 0; i < 10; i++)
+    {
+        CHECK(queue.push(MakeSequenceFrame(i)));
+        LONGS_EQUAL(i + 1, queue.length());
+    }
+    for (uint32_t i = 0; i < 10; i++)
+    {
+        CHECK(queue.pop(&popped));
+        CheckSequenceFrame(i, popped);
+    }
+}
+
+TEST(SpscCanQueue_BasicOperations, Clear)
+{
+    queue.push(frame);
+    queue.push(frame);
+    queue.clear();
+    CHECK(queue.isEmpty());
+    LONGS_EQUAL(16, queue.available());
+    CHECK(queue.push(frame));
+}
+
+TEST(SpscCanQueue_BasicOperations, ReserveCommit)
+{
+    CAN_FRAME *slot = queue.reserve();
+    CHECK(slot != nullptr);
+    CHECK(queue.isEmpty());
+
+    *slot = MakeSequenceFrame(42);
+    queue.commit();
+
+    LONGS_EQUAL(1, queue.length());
+    CAN_FRAME *head = queue.front();
+    CHECK(head != nullptr);
+    CheckSequenceFrame(42, *head);
+    queue.release();
+    CHECK(queue.isEmpty());
+    POINTERS_EQUAL(nullptr, queue.front());
+}
+
+TEST(SpscCanQueue_BasicOperations, ReserveFullQueue)
+{
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        queue.push(frame);
+    }
+    POINTERS_EQUAL(nullptr, queue.reserve());
+
+    // Releasing one frame frees exactly one slot
+    queue.front();
+    queue.release();
+    CHECK(queue.reserve() != nullptr);
+}
+
+TEST(SpscCanQueue_BasicOperations, FrontSpanStopsAtBufferEnd)
+{
+    // 17 slots: start 3 before the end of the buffer, then add 5 frames
+    for (uint32_t i = 0; i < 14; i++)
+    {
+        queue.push(frame);
+        queue.pop(nullptr);
+    }
+    for (uint32_t i = 0; i < 5; i++)
+    {
+        queue.push(MakeSequenceFrame(i));
+    }
+
+    CAN_FRAME *frames;
+    LONGS_EQUAL(3, queue.frontSpan(&frames));
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        CheckSequenceFrame(i, frames[i]);
+    }
+    queue.release(3);
+
+    LONGS_EQUAL(2, queue.frontSpan(&frames));
+    CheckSequenceFrame(3, frames[0]);
+    CheckSequenceFrame(4, frames[1]);
+    queue.release(2);
+
+    LONGS_EQUAL(0, queue.frontSpan(&frames));
+    POINTERS_EQUAL(nullptr, frames);
+}
+
+TEST(SpscCanQueue_BasicOperations, PopManyAcrossWrap)
+{
+    for (uint32_t i = 0; i < 14; i++)
+    {
+        queue.push(frame);
+        queue.pop(nullptr);
+    }
+    for (uint32_t i = 0; i < 10; i++)
+    {
+        queue.push(MakeSequenceFrame(i));
+    }
+
+    CAN_FRAME out[16];
+    LONGS_EQUAL(6, queue.popMany(out, 6));
+    LONGS_EQUAL(4, queue.popMany(out + 6, 16));
+    for (uint32_t i = 0; i < 10; i++)
+    {
+        CheckSequenceFrame(i, out[i]);
+    }
+    CHECK(queue.isEmpty());
+    LONGS_EQUAL(0, queue.popMany(out, 16));
+}
+
+TEST_GROUP(SpscCanQueue_Stress)
+{
+    uint32_t rngState;
+
+    void setup()
+    {
+        rngState = 12345;
+    }
+
+    void teardown()
+    {
+    }
+
+    // Small LCG so interleavings are varied but reproducible
+    uint32_t nextRandom()
+    {
+        rngState = rngState * 1103515245u + 12345u;
+        return (rngState >> 16) & 0x7FFF;
+    }
+};
+
+TEST(SpscCanQueue_Stress, SimulatedIsrBurstsInterleavedWithPops)
+{
+    // Simulate the CAN RX ISR delivering bursts of frames at random points
+    // of the main loop's drain, including bursts that overflow the queue.
+    SpscCanQueue<8> queue;
+    uint32_t produced = 0;
+    uint32_t consumed = 0;
+    uint32_t dropped = 0;
+    uint32_t expected = 0;
+    CAN_FRAME frame;
+
+    for (int step = 0; step < 20000; step++)
+    {
+        uint32_t burst = nextRandom() % 5;
+        for (uint32_t i = 0; i < burst; i++)
+        {
+            if (queue.push(MakeSequenceFrame(produced)))
+            {
+                produced++;
+            }
+            else
+            {
+                // A full queue drops the new frame; the sequence carries on
+                // from the next frame the ISR manages to store.
+                dropped++;
+            }
+        }
+
+        uint32_t pops = nextRandom() % 4;
+        for (uint32_t i = 0; i < pops; i++)
+        {
+            if (!queue.pop(&frame))
+            {
+                CHECK(queue.isEmpty());
+                break;
+            }
+            CheckSequenceFrame(expected, frame);
+            expected++;
+            consumed++;
+        }
+        CHECK(queue.length() <= queue.capacity());
+        LONGS_EQUAL(produced - consumed, queue.length());
+    }
+
+    while (queue.pop(&frame))
+    {
+        CheckSequenceFrame(expected, frame);
+        expected++;
+        consumed++;
+    }
+
+    LONGS_EQUAL(produced, consumed);
+    CHECK(dropped > 0);
+}
+
+TEST(SpscCanQueue_Stress, SimulatedIsrReservesInterleavedWithInPlaceConsumer)
+{
+    // As above, but using the zero-copy reserve/commit and front/release
+    // paths the CAN RX ISR and main loop use.
+    SpscCanQueue<8> queue;
+    uint32_t produced = 0;
+    uint32_t expected = 0;
+
+    for (int step = 0; step < 20000; step++)
+    {
+        uint32_t burst = nextRandom() % 5;
+        for (uint32_t i = 0; i < burst; i++)
+        {
+            CAN_FRAME *slot = queue.reserve();
+            if (slot != nullptr)
+            {
+                *slot = MakeSequenceFrame(produced++);
+                queue.commit();
+            }
+        }
+
+        uint32_t releases = nextRandom() % 4;
+        for (uint32_t i = 0; i < releases; i++)
+        {
+            CAN_FRAME *head = queue.front();
+            if (head == nullptr)
+            {
+                break;
+            }
+            CheckSequenceFrame(expected++, *head);
+            queue.release();
+        }
+        LONGS_EQUAL(produced - expected, queue.length());
+    }
+}
+
+TEST(SpscCanQueue_Stress, SimulatedIsrBurstsInterleavedWithBatchDrain)
+{
+    // As above, with the consumer draining whole spans like ProcessCanRx()
+    SpscCanQueue<8> queue;
+    uint32_t produced = 0;
+    uint32_t expected = 0;
+
+    for (int step = 0; step < 20000; step++)
+    {
+        uint32_t burst = nextRandom() % 9;
+        for (uint32_t i = 0; i < burst; i++)
+        {
+            if (queue.push(MakeSequenceFrame(produced)))
+            {
+                produced++;
+            }
+        }
+
+        if (nextRandom() % 2)
+        {
+            CAN_FRAME *frames;
+            uint16_t count = queue.frontSpan(&frames);
+            for (uint16_t i = 0; i < count; i++)
+            {
+                CheckSequenceFrame(expected++, frames[i]);
+            }
+            queue.release(count);
+        }
+        else
+        {
+            CAN_FRAME frames[3];
+            uint16_t count = queue.popMany(frames, 3);
+            for (uint16_t i = 0; i < count; i++)
+            {
+                CheckSequenceFrame(expected++, frames[i]);
+            }
+        }
+        LONGS_EQUAL(produced - expected, queue.length());
+    }
+}
+
+TEST(SpscCanQueue_Stress, ConcurrentProducerAndConsumerThreads)
+{
+    // A real producer thread stands in for the ISR; every frame must arrive
+    // exactly once, in order, with intact contents.
+    static SpscCanQueue<16> queue;
+    const uint32_t FRAME_COUNT = 50000;
+    queue.clear();
+
+    std::thread producer([&]() {
+        for (uint32_t sequence = 0; sequence < FRAME_COUNT;)
+        {
+            if (queue.push(MakeSequenceFrame(sequence)))
+            {
+                sequence++;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    CAN_FRAME frame;
+    uint32_t errors = 0;
+    for (uint32_t expected = 0; expected < FRAME_COUNT;)
+    {
+        if (queue.pop(&frame))
+        {
+            CAN_FRAME reference = MakeSequenceFrame(expected);
+            if (memcmp(&reference, &frame, sizeof(CAN_FRAME)) != 0)
+            {
+                errors++;
+            }
+            expected++;
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+
+    LONGS_EQUAL(0, errors);
+    CHECK(queue.isEmpty());
+}
@@ -0,0 +1,221 @@
+/**
+ * @file test_timer_wheel.cpp
+ * @brief Unit tests for TimerWheel class
+ */
+
+#include "CppUTest/TestHarness.h"
+#include "TimerWheel.h"
+#include <string.h>
+
+typedef TimerWheel<16, 4> TestWheel;
+
+// Counts its runs and remembers the wheel time of the last one
+struct TaskLog {
+    TestWheel* wheel;
+    int runs;
+    uint32_t lastMs;
+};
+
+static void LogRun(void* context)
+{
+    TaskLog* log = static_cast<TaskLog*>(context);
+    log->runs++;
+    log->lastMs = log->wheel->nowMs();
+}
+
+TEST_GROUP(TimerWheel)
+{
+    TestWheel wheel;
+    TaskLog a;
+    TaskLog b;
+
+    void setup()
+    {
+        a = TaskLog{&wheel, 0, 0};
+        b = TaskLog{&wheel, 0, 0};
+    }
+};
+
+TEST(TimerWheel, FirstRunAfterPhaseThenEveryPeriod)
+{
+    wheel.add(10, 3, LogRun, &a);
+    wheel.advance(2);
+    LONGS_EQUAL(0, a.runs);
+    wheel.advance(1);
+    LONGS_EQUAL(1, a.runs);
+    LONGS_EQUAL(3, a.lastMs);
+    wheel.advance(9);
+    LONGS_EQUAL(1, a.runs);
+    wheel.advance(1);
+    LONGS_EQUAL(2, a.runs);
+    LONGS_EQUAL(13, a.lastMs);
+}
+
+TEST(TimerWheel, ZeroPhaseWaitsOnePeriod)
+{
+    wheel.add(5, 0, LogRun, &a);
+    wheel.advance(4);
+    LONGS_EQUAL(0, a.runs);
+    wheel.advance(1);
+    LONGS_EQUAL(1, a.runs);
+}
+
+TEST(TimerWheel, PeriodLongerThanTheWheel)
+{
+    // Passes its slot twice before it is due
+    wheel.add(40, 0, LogRun, &a);
+    wheel.advance(39);
+    LONGS_EQUAL(0, a.runs);
+    wheel.advance(1);
+    LONGS_EQUAL(1, a.runs);
+    wheel.advance(40);
+    LONGS_EQUAL(2, a.runs);
+    LONGS_EQUAL(80, a.lastMs);
+}
+
+TEST(TimerWheel, PeriodOfAWholeTurnRunsOncePerTurn)
+{
+    // Goes back into the slot being emptied
+    wheel.add(16, 0, LogRun, &a);
+    wheel.advance(16);
+    LONGS_EQUAL(1, a.runs);
+    wheel.advance(16);
+    LONGS_EQUAL(2, a.runs);
+}
+
+TEST(TimerWheel, LongAdvanceRunsEveryDueTime)
+{
+    wheel.add(3, 0, LogRun, &a);
+    wheel.add(7, 0, LogRun, &b);
+    wheel.advance(21);
+    LONGS_EQUAL(7, a.runs);
+    LONGS_EQUAL(3, b.runs);
+    LONGS_EQUAL(21, a.lastMs);
+    LONGS_EQUAL(21, b.lastMs);
+}
+
+TEST(TimerWheel, OneShotRunsOnceAndFreesItsEntry)
+{
+    wheel.add(0, 5, LogRun, &a);
+    LONGS_EQUAL(1, wheel.taskCount());
+    wheel.advance(100);
+    LONGS_EQUAL(1, a.runs);
+    LONGS_EQUAL(5, a.lastMs);
+    LONGS_EQUAL(0, wheel.taskCount());
+}
+
+TEST(TimerWheel, TaskThatNeverRunsIsRefused)
+{
+    LONGS_EQUAL(TestWheel::NO_TASK, wheel.add(0, 0, LogRun, &a));
+    LONGS_EQUAL(TestWheel::NO_TASK, wheel.add(10, 0, nullptr, &a));
+    LONGS_EQUAL(0, wheel.taskCount());
+}
+
+TEST(TimerWheel, FullTableRefusesMore)
+{
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        CHECK(wheel.add(10, 0, LogRun, &a) != TestWheel::NO_TASK);
+    }
+    LONGS_EQUAL(TestWheel::NO_TASK, wheel.add(10, 0, LogRun, &b));
+    LONGS_EQUAL(4, wheel.taskCount());
+}
+
+TEST(TimerWheel, CancelledTaskDoesNotRun)
+{
+    uint8_t first = wheel.add(5, 0, LogRun, &a);
+    wheel.add(5, 0, LogRun, &b);
+    wheel.cancel(first);
+    LONGS_EQUAL(1, wheel.taskCount());
+    wheel.advance(5);
+    LONGS_EQUAL(0, a.runs);
+    LONGS_EQUAL(1, b.runs);
+
+    // Its entry is free again
+    CHECK(wheel.add(5, 0, LogRun, &a) != TestWheel::NO_TASK);
+    wheel.advance(5);
+    LONGS_EQUAL(1, a.runs);
+    LONGS_EQUAL(2, b.runs);
+}
+
+// Cancels the task given as context
+struct Canceller {
+    TestWheel* wheel;
+    uint8_t task;
+};
+
+static void CancelTask(void* context)
+{
+    Canceller* canceller = static_cast<Canceller*>(context);
+    canceller->wheel->cancel(canceller->task);
+}
+
+// Appends its tag to a shared run order
+struct OrderLog {
+    char* order;
+    char tag;
+};
+
+static void LogOrder(void* context)
+{
+    OrderLog* log = static_cast<OrderLog*>(context);
+    size_t length = strlen(log->order);
+    log->order[length] = log->tag;
+    log->order[length + 1] = '\0';
+}
+
+TEST(TimerWheel, TaskCancelledByAnotherDueInTheSameTickDoesNotRun)
+{
+    Canceller canceller = {&wheel, TestWheel::NO_TASK};
+    wheel.add(5, 0, CancelTask, &canceller);
+    canceller.task = wheel.add(5, 0, LogRun, &a);
+    wheel.add(0, 5, LogRun, &b);
+    LONGS_EQUAL(3, wheel.taskCount());
+
+    wheel.advance(5);
+    LONGS_EQUAL(0, a.runs);
+    LONGS_EQUAL(1, b.runs);
+    LONGS_EQUAL(1, wheel.taskCount());
+
+    // The freed entry is not on any list, so reusing it leaves the wheel intact
+    canceller.task = TestWheel::NO_TASK;
+    CHECK(wheel.add(5, 0, LogRun, &a) != TestWheel::NO_TASK);
+    wheel.advance(5);
+    LONGS_EQUAL(1, a.runs);
+    LONGS_EQUAL(1, b.runs);
+    LONGS_EQUAL(2, wheel.taskCount());
+}
+
+TEST(TimerWheel, OneShotCancelledInTheSameTickIsFreedOnce)
+{
+    Canceller canceller = {&wheel, TestWheel::NO_TASK};
+    wheel.add(0, 5, CancelTask, &canceller);
+    canceller.task = wheel.add(0, 5, LogRun, &a);
+
+    wheel.advance(5);
+    LONGS_EQUAL(0, a.runs);
+    LONGS_EQUAL(0, wheel.taskCount());
+}
+
+TEST(TimerWheel, TasksDueTogetherRunInTheOrderAdded)
+{
+    char order[8] = "";
+    OrderLog first = {order, '1'};
+    OrderLog second = {order, '2'};
+    OrderLog third = {order, '3'};
+    wheel.add(4, 0, LogOrder, &first);
+    wheel.add(4, 0, LogOrder, &second);
+    wheel.add(4, 0, LogOrder, &third);
+
+    wheel.advance(8);
+    STRCMP_EQUAL("123123", order);
+}
+
+TEST(TimerWheel, CostRecordedPerAdvance)
+{
+    wheel.add(1, 0, LogRun, &a);
+    wheel.advance(1);
+    wheel.advance(3);
+    LONGS_EQUAL(2, wheel.cost().count());
+    LONGS_EQUAL(4, a.runs);
+}